@@ -0,0 +1,78 @@
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+#include <posixpp/buffered_reader.h>
+#include <pppbase/find_byte.h>
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include <catch2/catch.hpp>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace {
+
+//! A file full of log-like lines that's removed when this is destroyed.
+class line_file {
+ public:
+   explicit line_file(unsigned nlines)
+        : path_{::std::filesystem::temp_directory_path()
+                / "posixpp_bench_lines"}
+   {
+      ::std::ofstream out{path_};
+      for (unsigned i = 0; i < nlines; ++i) {
+         out << "2021-06-01T12:00:00Z host" << i % 17
+             << " service[" << i << "]: message number " << i * 7919 << '\n';
+      }
+   }
+   ~line_file() {
+      ::std::filesystem::remove(path_);
+   }
+   ::std::filesystem::path const &path() const { return path_; }
+
+ private:
+   ::std::filesystem::path path_;
+};
+
+} // namespace
+
+TEST_CASE("Read every line of a file", "[buffered_reader][benchmark]")
+{
+   line_file const file{200000};
+   BENCHMARK("posixpp::buffered_reader") {
+      using ::posixpp::fdflags;
+      auto fd{::posixpp::open(file.path().c_str(), fdflags::rdonly).result()};
+      auto reader{::posixpp::buffered_reader::create(fd).result()};
+      ::std::size_t total = 0;
+      for (auto line = reader.read_line().result();
+           !line.empty();
+           line = reader.read_line().result())
+      {
+         total += line.size();
+      }
+      return total;
+   };
+   BENCHMARK("std::getline on a std::ifstream") {
+      ::std::ifstream in{file.path()};
+      ::std::string line;
+      ::std::size_t total = 0;
+      while (::std::getline(in, line)) {
+         total += line.size() + 1;
+      }
+      return total;
+   };
+}
+
+TEST_CASE("Find a byte in a short buffer", "[buffered_reader][benchmark]")
+{
+   char buf[80];
+   ::std::memset(buf, 'x', sizeof(buf));
+   buf[sizeof(buf) - 1] = '\n';
+   char const *volatile start = buf;
+   BENCHMARK("pppbase::find_byte") {
+      return ::pppbase::find_byte(start, start + sizeof(buf), '\n');
+   };
+   BENCHMARK("std::memchr") {
+      return ::std::memchr(start, '\n', sizeof(buf));
+   };
+}
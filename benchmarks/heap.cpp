@@ -0,0 +1,87 @@
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+#include <posixpp/heap.h>
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include <catch2/catch.hpp>
+#include <cstdint>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace {
+
+/**
+ * \brief Each thread keeps 512 slots, and over and over frees a random one
+ * and fills it again with a random size from 16 to 1024 bytes. Each thread
+ * calls `finish` when it's done.
+ */
+template <typename Alloc, typename Free, typename Finish>
+unsigned long churn(unsigned nthreads, unsigned per_thread,
+                    Alloc alloc, Free free, Finish finish)
+{
+   ::std::vector<::std::thread> threads;
+   threads.reserve(nthreads);
+   for (unsigned t = 0; t < nthreads; ++t) {
+      threads.emplace_back([=]() {
+         void *slots[512] = {};
+         ::std::uint32_t rand = 2463534242U + t;
+         for (unsigned i = 0; i < per_thread; ++i) {
+            rand ^= rand << 13;
+            rand ^= rand >> 17;
+            rand ^= rand << 5;
+            void *&slot = slots[rand % 512];
+            free(slot);
+            slot = alloc(16 + (rand >> 9) % 1009);
+         }
+         for (void *slot : slots) {
+            free(slot);
+         }
+         finish();
+      });
+   }
+   for (auto &thread : threads) {
+      thread.join();
+   }
+   return nthreads * per_thread;
+}
+
+} // namespace
+
+TEST_CASE("Allocate and free one small object", "[heap][benchmark]")
+{
+   // Returning whether it worked, worked out before the free, keeps the pair
+   // from being optimized away.
+   BENCHMARK("posixpp::heap") {
+      void *const obj = ::posixpp::heap::allocate(64);
+      bool const allocated = obj != nullptr;
+      ::posixpp::heap::deallocate(obj);
+      return allocated;
+   };
+   BENCHMARK("malloc") {
+      void *const obj = ::std::malloc(64);
+      bool const allocated = obj != nullptr;
+      ::std::free(obj);
+      return allocated;
+   };
+}
+
+TEST_CASE("8 threads churning through allocations", "[heap][benchmark]")
+{
+   constexpr unsigned nthreads = 8;
+   constexpr unsigned per_thread = 100000;
+   BENCHMARK("posixpp::heap") {
+      return churn(nthreads, per_thread,
+                   [](::std::size_t size) {
+                      return ::posixpp::heap::allocate(size);
+                   },
+                   [](void *ptr) { ::posixpp::heap::deallocate(ptr); },
+                   [] { ::posixpp::heap::flush_thread_cache(); });
+   };
+   BENCHMARK("malloc") {
+      return churn(nthreads, per_thread,
+                   [](::std::size_t size) { return ::std::malloc(size); },
+                   [](void *ptr) { ::std::free(ptr); },
+                   [] {});
+   };
+}
@@ -0,0 +1,6 @@
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+#define CATCH_CONFIG_MAIN
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include <catch2/catch.hpp>
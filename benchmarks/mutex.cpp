@@ -0,0 +1,64 @@
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+#include <posixpp/mutex.h>
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include <catch2/catch.hpp>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+template <typename Mutex>
+unsigned long contended_increments(unsigned nthreads, unsigned per_thread)
+{
+   Mutex m;
+   unsigned long counter = 0;
+   ::std::vector<::std::thread> threads;
+   threads.reserve(nthreads);
+   for (unsigned t = 0; t < nthreads; ++t) {
+      threads.emplace_back([&m, &counter, per_thread]() {
+         for (unsigned i = 0; i < per_thread; ++i) {
+            ::std::lock_guard<Mutex> lock{m};
+            ++counter;
+         }
+      });
+   }
+   for (auto &thread : threads) {
+      thread.join();
+   }
+   return counter;
+}
+
+} // namespace
+
+TEST_CASE("Uncontended lock and unlock", "[mutex][benchmark]")
+{
+   BENCHMARK_ADVANCED("posixpp::mutex")(Catch::Benchmark::Chronometer meter) {
+      ::posixpp::mutex m;
+      meter.measure([&m] {
+         m.lock();
+         return m.unlock();
+      });
+   };
+   BENCHMARK_ADVANCED("std::mutex")(Catch::Benchmark::Chronometer meter) {
+      ::std::mutex m;
+      meter.measure([&m] {
+         m.lock();
+         m.unlock();
+      });
+   };
+}
+
+TEST_CASE("16 threads contending for one lock", "[mutex][benchmark]")
+{
+   constexpr unsigned nthreads = 16;
+   constexpr unsigned per_thread = 10000;
+   BENCHMARK("posixpp::mutex") {
+      return contended_increments<::posixpp::mutex>(nthreads, per_thread);
+   };
+   BENCHMARK("std::mutex") {
+      return contended_increments<::std::mutex>(nthreads, per_thread);
+   };
+}
@@ -0,0 +1,104 @@
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+#include <posixpp/ring_queue.h>
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include <catch2/catch.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr unsigned producer_counts[] = {1, 2, 4};
+constexpr unsigned total_items = 100000;
+
+//! The obvious queue to compare with, a deque under a mutex.
+class locked_queue {
+ public:
+   bool try_push(unsigned item) {
+      {
+         ::std::lock_guard<::std::mutex> lock{m_};
+         items_.push_back(item);
+      }
+      nonempty_.notify_one();
+      return true;
+   }
+
+   ::posixpp::expected<void> pop(unsigned &out) {
+      ::std::unique_lock<::std::mutex> lock{m_};
+      nonempty_.wait(lock, [this]() { return !items_.empty(); });
+      out = items_.front();
+      items_.pop_front();
+      return {};
+   }
+
+ private:
+   ::std::mutex m_;
+   ::std::condition_variable nonempty_;
+   ::std::deque<unsigned> items_;
+};
+
+//! `nproducers` threads push `total_items` between them to this thread.
+template <typename Queue>
+unsigned long stream(unsigned nproducers)
+{
+   Queue q;
+   ::std::atomic<bool> failed = false;
+   unsigned const each = total_items / nproducers;
+   ::std::vector<::std::thread> producers;
+   for (unsigned p = 0; p < nproducers; ++p) {
+      producers.emplace_back([&q, &failed, each]() {
+         for (unsigned i = 0; i < each; ++i) {
+            while (!q.try_push(i)) {
+               // Nobody will make room if the consumer gave up.
+               if (failed.load(::std::memory_order_relaxed)) {
+                  return;
+               }
+               ::std::this_thread::yield();
+            }
+         }
+      });
+   }
+   unsigned long sum = 0;
+   for (unsigned i = 0; i < each * nproducers; ++i) {
+      unsigned item = 0;
+      if (q.pop(item).has_error()) {
+         failed.store(true, ::std::memory_order_relaxed);
+         break;
+      }
+      sum += item;
+   }
+   for (auto &producer : producers) {
+      producer.join();
+   }
+   if (failed.load(::std::memory_order_relaxed)) {
+      FAIL("Waiting for an item to pop failed.");
+   }
+   return sum;
+}
+
+} // namespace
+
+TEST_CASE("Streaming items to one consumer", "[ring_queue][benchmark]")
+{
+   using ::posixpp::futex_wakeup;
+   BENCHMARK("posixpp::spsc_queue") {
+      return stream<::posixpp::spsc_queue<unsigned, 1024, futex_wakeup>>(1);
+   };
+   for (unsigned nproducers : producer_counts) {
+      auto const suffix = ", " + ::std::to_string(nproducers) + " producers";
+      BENCHMARK("posixpp::mpsc_queue" + suffix) {
+         return stream<::posixpp::mpsc_queue<unsigned, 1024, futex_wakeup>>(
+              nproducers
+         );
+      };
+      BENCHMARK("std::mutex and std::deque" + suffix) {
+         return stream<locked_queue>(nproducers);
+      };
+   }
+}
@@ -0,0 +1,150 @@
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+#include <posixpp/barrier.h>
+#include <posixpp/latch.h>
+#include <posixpp/semaphore.h>
+#include <posixpp/shared_mutex.h>
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include <catch2/catch.hpp>
+#include <barrier>
+#include <latch>
+#include <mutex>
+#include <semaphore>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr unsigned thread_counts[] = {1, 2, 4, 8, 16};
+
+//! Run `body(thread_number)` on `nthreads` threads and wait for them.
+template <typename Body>
+void on_threads(unsigned nthreads, Body body)
+{
+   ::std::vector<::std::thread> threads;
+   threads.reserve(nthreads);
+   for (unsigned t = 0; t < nthreads; ++t) {
+      threads.emplace_back(body, t);
+   }
+   for (auto &thread : threads) {
+      thread.join();
+   }
+}
+
+::std::string threads_name(char const *what, unsigned nthreads)
+{
+   return ::std::string{what} + ", " + ::std::to_string(nthreads)
+          + " threads";
+}
+
+template <typename Latch>
+void latch_round(unsigned nthreads)
+{
+   Latch done{static_cast<::std::ptrdiff_t>(nthreads)};
+   on_threads(nthreads, [&done](unsigned) {
+      static_cast<void>(done.arrive_and_wait());
+   });
+}
+
+template <typename Barrier>
+void barrier_phases(unsigned nthreads, unsigned nphases)
+{
+   Barrier sync{static_cast<::std::ptrdiff_t>(nthreads)};
+   on_threads(nthreads, [&sync, nphases](unsigned) {
+      for (unsigned i = 0; i < nphases; ++i) {
+         static_cast<void>(sync.arrive_and_wait());
+      }
+   });
+}
+
+//! Every thread takes and gives back one of half as many slots as threads.
+template <typename Semaphore>
+void semaphore_churn(unsigned nthreads, unsigned per_thread)
+{
+   Semaphore slots{static_cast<::std::ptrdiff_t>((nthreads + 1) / 2)};
+   on_threads(nthreads, [&slots, per_thread](unsigned) {
+      for (unsigned i = 0; i < per_thread; ++i) {
+         static_cast<void>(slots.acquire());
+         static_cast<void>(slots.release());
+      }
+   });
+}
+
+//! Mostly reads, with one write in 64.
+template <typename SharedMutex>
+unsigned long read_mostly(unsigned nthreads, unsigned per_thread)
+{
+   SharedMutex m;
+   unsigned long value = 0;
+   on_threads(nthreads, [&m, &value, per_thread](unsigned t) {
+      unsigned long sum = 0;
+      for (unsigned i = 0; i < per_thread; ++i) {
+         if ((i + t) % 64 == 0) {
+            ::std::lock_guard<SharedMutex> lock{m};
+            ++value;
+         } else {
+            ::std::shared_lock<SharedMutex> lock{m};
+            sum += value;
+         }
+      }
+      static_cast<void>(sum);
+   });
+   return value;
+}
+
+} // namespace
+
+TEST_CASE("Threads meeting at a latch", "[latch][benchmark]")
+{
+   for (unsigned nthreads : thread_counts) {
+      BENCHMARK(threads_name("posixpp::latch", nthreads)) {
+         latch_round<::posixpp::latch>(nthreads);
+      };
+      BENCHMARK(threads_name("std::latch", nthreads)) {
+         latch_round<::std::latch>(nthreads);
+      };
+   }
+}
+
+TEST_CASE("1000 barrier phases", "[barrier][benchmark]")
+{
+   constexpr unsigned nphases = 1000;
+   for (unsigned nthreads : thread_counts) {
+      BENCHMARK(threads_name("posixpp::barrier", nthreads)) {
+         barrier_phases<::posixpp::barrier<>>(nthreads, nphases);
+      };
+      BENCHMARK(threads_name("std::barrier", nthreads)) {
+         barrier_phases<::std::barrier<>>(nthreads, nphases);
+      };
+   }
+}
+
+TEST_CASE("Threads contending for semaphore slots", "[semaphore][benchmark]")
+{
+   constexpr unsigned per_thread = 10000;
+   for (unsigned nthreads : thread_counts) {
+      BENCHMARK(threads_name("posixpp::counting_semaphore", nthreads)) {
+         semaphore_churn<::posixpp::counting_semaphore<>>(nthreads,
+                                                          per_thread);
+      };
+      BENCHMARK(threads_name("std::counting_semaphore", nthreads)) {
+         semaphore_churn<::std::counting_semaphore<>>(nthreads, per_thread);
+      };
+   }
+}
+
+TEST_CASE("Read-mostly shared_mutex", "[shared_mutex][benchmark]")
+{
+   constexpr unsigned per_thread = 10000;
+   for (unsigned nthreads : thread_counts) {
+      BENCHMARK(threads_name("posixpp::shared_mutex", nthreads)) {
+         return read_mostly<::posixpp::shared_mutex>(nthreads, per_thread);
+      };
+      BENCHMARK(threads_name("std::shared_mutex", nthreads)) {
+         return read_mostly<::std::shared_mutex>(nthreads, per_thread);
+      };
+   }
+}
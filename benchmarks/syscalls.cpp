@@ -0,0 +1,161 @@
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+// The basic file descriptor calls, compared against the glibc wrappers for the
+// same system calls. Most of the time is spent in the kernel, so the
+// differences are small, but they're what's left once the kernel's share is
+// the same, and a regression in the inline assembly would show up here first.
+
+#include <posixpp/fd.h>
+#include <posixpp/simpleio.h>
+#include <posixpp/transfer.h>
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include <catch2/catch.hpp>
+#include <fcntl.h>
+#include <unistd.h>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <utility>
+
+namespace {
+
+namespace fs = ::std::filesystem;
+
+//! A small file on tmpfs (if there is one), removed afterwards.
+class tmpfs_file {
+ public:
+   tmpfs_file()
+        : path_{(fs::is_directory("/dev/shm") ? fs::path{"/dev/shm"}
+                                              : fs::temp_directory_path())
+                / "posixpp_bench_syscalls"}
+   {
+      ::std::ofstream out{path_, ::std::ios::binary};
+      out << ::std::string(4096, 'x');
+   }
+   ~tmpfs_file() { fs::remove(path_); }
+
+   [[nodiscard]] char const *c_str() const noexcept { return path_.c_str(); }
+
+ private:
+   fs::path path_;
+};
+
+::posixpp::fd open_devnull()
+{
+   return ::posixpp::open("/dev/null", ::posixpp::fdflags::rdwr).result();
+}
+
+} // namespace
+
+TEST_CASE("read and write on /dev/null", "[syscalls][benchmark]")
+{
+   auto const devnull{open_devnull()};
+   int const rawfd = devnull.as_fd();
+   char buf[64] = {};
+   BENCHMARK("posixpp::read") {
+      return ::posixpp::read(devnull, buf, sizeof(buf)).result();
+   };
+   BENCHMARK("glibc read") {
+      return ::read(rawfd, buf, sizeof(buf));
+   };
+   BENCHMARK("posixpp::write") {
+      return ::posixpp::write(devnull, buf, sizeof(buf)).result();
+   };
+   BENCHMARK("glibc write") {
+      return ::write(rawfd, buf, sizeof(buf));
+   };
+}
+
+TEST_CASE("write then read 64 bytes through a pipe", "[syscalls][benchmark]")
+{
+   auto const p{::posixpp::pipe().result()};
+   int const rawread = p.read_end.as_fd();
+   int const rawwrite = p.write_end.as_fd();
+   char buf[64] = {};
+   BENCHMARK("posixpp::write and posixpp::read") {
+      (void)::posixpp::write(p.write_end, buf, sizeof(buf)).result();
+      return ::posixpp::read(p.read_end, buf, sizeof(buf)).result();
+   };
+   BENCHMARK("glibc write and read") {
+      (void)::write(rawwrite, buf, sizeof(buf));
+      return ::read(rawread, buf, sizeof(buf));
+   };
+}
+
+TEST_CASE("Read 4K at offset 0 of a tmpfs file", "[syscalls][benchmark]")
+{
+   tmpfs_file const file;
+   auto const posixfd{
+        ::posixpp::open(file.c_str(), ::posixpp::fdflags::rdonly).result()
+   };
+   int const rawfd = posixfd.as_fd();
+   static char buf[4096];
+   BENCHMARK("posixpp::pread") {
+      return ::posixpp::pread(posixfd, buf, sizeof(buf), 0).result();
+   };
+   BENCHMARK("glibc pread") {
+      return ::pread(rawfd, buf, sizeof(buf), 0);
+   };
+}
+
+TEST_CASE("Open and close a tmpfs file", "[syscalls][benchmark]")
+{
+   tmpfs_file const file;
+   BENCHMARK("posixpp::open and fd::close") {
+      auto newfd{
+           ::posixpp::open(file.c_str(), ::posixpp::fdflags::rdonly).result()
+      };
+      return newfd.close().has_error();
+   };
+   BENCHMARK("posixpp::open and ~fd") {
+      auto newfd{
+           ::posixpp::open(file.c_str(), ::posixpp::fdflags::rdonly).result()
+      };
+      return newfd.as_fd();
+   };
+   BENCHMARK("glibc open and close") {
+      int const newfd = ::open(file.c_str(), O_RDONLY);
+      return ::close(newfd);
+   };
+}
+
+TEST_CASE("dup and close", "[syscalls][benchmark]")
+{
+   auto const devnull{open_devnull()};
+   int const rawfd = devnull.as_fd();
+   BENCHMARK("fd::dup and ~fd") {
+      return devnull.dup().result().as_fd();
+   };
+   BENCHMARK("glibc dup and close") {
+      return ::close(::dup(rawfd));
+   };
+}
+
+TEST_CASE("Moving and destroying fds", "[syscalls][benchmark]")
+{
+   // None of these make a system call, they show what the bookkeeping in fd
+   // costs compared to a plain int.
+   BENCHMARK_ADVANCED("fd move construct and destroy")(
+        Catch::Benchmark::Chronometer meter)
+   {
+      ::posixpp::fd held{open_devnull()};
+      meter.measure([&held] {
+         ::posixpp::fd moved{::std::move(held)};
+         held = ::std::move(moved);
+         return held.as_fd();
+      });
+   };
+   BENCHMARK_ADVANCED("int copy")(Catch::Benchmark::Chronometer meter) {
+      int held = 3;
+      meter.measure([&held] {
+         int moved = ::std::exchange(held, -1);
+         held = moved;
+         return held;
+      });
+   };
+   BENCHMARK("Destroy an invalid fd") {
+      ::posixpp::fd invalid;
+      return invalid.is_valid();
+   };
+}
@@ -0,0 +1,26 @@
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+#include <posixpp/thread.h>
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include <catch2/catch.hpp>
+#include <atomic>
+#include <thread>
+
+TEST_CASE("Start and join a thread", "[thread][benchmark]")
+{
+   ::std::atomic<int> counter = 0;
+   BENCHMARK("posixpp::thread") {
+      auto thr = ::posixpp::thread::create([&counter]() noexcept {
+         counter.fetch_add(1, ::std::memory_order_relaxed);
+      });
+      return thr.result().join().has_error();
+   };
+   BENCHMARK("std::thread") {
+      ::std::thread thr{[&counter]() noexcept {
+         counter.fetch_add(1, ::std::memory_order_relaxed);
+      }};
+      thr.join();
+      return thr.joinable();
+   };
+}
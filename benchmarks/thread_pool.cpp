@@ -0,0 +1,111 @@
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+#include <posixpp/thread_pool.h>
+#include <posixpp/auxv.h>
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include <catch2/catch.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+extern "C" char **environ;
+
+namespace {
+
+//! Forks all the way down to tiny jobs, to measure the per-job overhead.
+long parallel_fib(long n)
+{
+   if (n < 12) {
+      long a = 0, b = 1;
+      for (long i = 0; i < n; ++i) {
+         b = ::std::exchange(a, b) + b;
+      }
+      return a;
+   }
+   long x, y;
+   ::posixpp::thread_pool::fork_join([&x, n] { x = parallel_fib(n - 1); },
+                                     [&y, n] { y = parallel_fib(n - 2); });
+   return x + y;
+}
+
+void parallel_sort(int *begin, int *end)
+{
+   if (end - begin < 4096) {
+      ::std::sort(begin, end);
+      return;
+   }
+   int const pivot = begin[(end - begin) / 2];
+   int *const mid1 = ::std::partition(begin, end,
+                                      [pivot](int v) { return v < pivot; });
+   int *const mid2 = ::std::partition(mid1, end,
+                                      [pivot](int v) { return v == pivot; });
+   ::posixpp::thread_pool::fork_join([begin, mid1] { parallel_sort(begin, mid1); },
+                                     [mid2, end] { parallel_sort(mid2, end); });
+}
+
+::std::vector<int> shuffled(::std::size_t n)
+{
+   ::std::vector<int> values(n);
+   ::std::uint32_t rand = 2463534242U;
+   for (int &v : values) {
+      rand ^= rand << 13;
+      rand ^= rand >> 17;
+      rand ^= rand << 5;
+      v = static_cast<int>(rand);
+   }
+   return values;
+}
+
+//! Run `func` on `pool` and wait for it.
+template <typename Func>
+void run_on(::posixpp::thread_pool &pool, Func func)
+{
+   static_cast<void>(pool.submit(func));
+   static_cast<void>(pool.wait());
+}
+
+} // namespace
+
+TEST_CASE("Parallel fib(30) with fork_join", "[thread_pool][benchmark]")
+{
+   ::posixpp::init_auxv(environ);
+   for (unsigned nworkers : {1U, 2U, 4U, 8U}) {
+      auto pool{::posixpp::thread_pool::create(nworkers).result()};
+      BENCHMARK("posixpp::thread_pool, " + ::std::to_string(nworkers)
+                + " workers")
+      {
+         long result = 0;
+         run_on(pool, [&result]() noexcept { result = parallel_fib(30); });
+         return result;
+      };
+   }
+   BENCHMARK("Serial") {
+      return parallel_fib(30);
+   };
+}
+
+TEST_CASE("Parallel sort of 1M ints with fork_join", "[thread_pool][benchmark]")
+{
+   ::posixpp::init_auxv(environ);
+   auto const input = shuffled(1024 * 1024);
+   for (unsigned nworkers : {1U, 2U, 4U, 8U}) {
+      auto pool{::posixpp::thread_pool::create(nworkers).result()};
+      BENCHMARK_ADVANCED("posixpp::thread_pool, " + ::std::to_string(nworkers)
+                         + " workers")(Catch::Benchmark::Chronometer meter)
+      {
+         auto values = input;
+         meter.measure([&pool, &values] {
+            run_on(pool, [&values]() noexcept {
+               parallel_sort(values.data(), values.data() + values.size());
+            });
+         });
+      };
+   }
+   BENCHMARK_ADVANCED("std::sort")(Catch::Benchmark::Chronometer meter) {
+      auto values = input;
+      meter.measure([&values] {
+         ::std::sort(values.begin(), values.end());
+      });
+   };
+}
@@ -0,0 +1,91 @@
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+#include <posixpp/timer_wheel.h>
+#include <posixpp/auxv.h>
+#include <posixpp/clock.h>
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include <catch2/catch.hpp>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <vector>
+
+extern "C" char **environ;
+
+namespace {
+
+constexpr unsigned connections = 1'000'000;
+
+class counting_timer final : public ::posixpp::timer {
+ public:
+   void on_expire() noexcept override { ++*fired; }
+   unsigned *fired = nullptr;
+};
+
+//! Timeouts from 1 to 30000 ticks, like 30 seconds of 1ms ticks.
+::std::vector<::std::uint64_t> make_timeouts()
+{
+   ::std::mt19937 rng{42};
+   ::std::vector<::std::uint64_t> timeouts(connections);
+   for (auto &timeout : timeouts) {
+      timeout = 1 + rng() % 30000;
+   }
+   return timeouts;
+}
+
+} // namespace
+
+TEST_CASE("A million connection timeouts", "[timer_wheel][benchmark]")
+{
+   // Scheduling reads the clock, so read it the cheap way.
+   ::posixpp::init_auxv(environ);
+   static_cast<void>(::posixpp::init_vdso());
+   auto const timeouts = make_timeouts();
+   // Every connection sets a timeout, half of them see activity and push
+   // theirs back, a quarter close, and then the rest all time out.
+   BENCHMARK_ADVANCED("posixpp::timer_wheel")(
+        Catch::Benchmark::Chronometer meter)
+   {
+      auto wheel{::posixpp::timer_wheel::create().result()};
+      ::std::vector<counting_timer> timers(connections);
+      unsigned fired = 0;
+      meter.measure([&]() {
+         for (unsigned i = 0; i < connections; ++i) {
+            timers[i].fired = &fired;
+            static_cast<void>(wheel.schedule(timers[i], timeouts[i]));
+         }
+         for (unsigned i = 0; i < connections; i += 2) {
+            static_cast<void>(wheel.schedule(timers[i], timeouts[i] + 1000));
+         }
+         for (unsigned i = 0; i < connections; i += 4) {
+            timers[i].cancel();
+         }
+         return wheel.advance(wheel.now() + 40000);
+      });
+   };
+   BENCHMARK_ADVANCED("std::multimap")(Catch::Benchmark::Chronometer meter)
+   {
+      using map_t = ::std::multimap<::std::uint64_t, unsigned>;
+      map_t deadlines;
+      ::std::vector<map_t::iterator> where(connections);
+      meter.measure([&]() {
+         for (unsigned i = 0; i < connections; ++i) {
+            where[i] = deadlines.emplace(timeouts[i], i);
+         }
+         for (unsigned i = 0; i < connections; i += 2) {
+            deadlines.erase(where[i]);
+            where[i] = deadlines.emplace(timeouts[i] + 1000, i);
+         }
+         for (unsigned i = 0; i < connections; i += 4) {
+            deadlines.erase(where[i]);
+         }
+         unsigned fired = 0;
+         while (!deadlines.empty()) {
+            deadlines.erase(deadlines.begin());
+            ++fired;
+         }
+         return fired;
+      });
+   };
+}
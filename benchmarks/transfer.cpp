@@ -0,0 +1,114 @@
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+#include <posixpp/transfer.h>
+#include <posixpp/simpleio.h>
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include <catch2/catch.hpp>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace {
+
+namespace fs = ::std::filesystem;
+
+constexpr ::std::size_t file_size = 32 * 1024 * 1024;
+
+//! A source file on tmpfs (if there is one) and a path to copy it to.
+class tmpfs_files {
+ public:
+   tmpfs_files()
+        : dir_{fs::is_directory("/dev/shm") ? fs::path{"/dev/shm"}
+                                            : fs::temp_directory_path()},
+          src_{dir_ / "posixpp_bench_src"}, dst_{dir_ / "posixpp_bench_dst"}
+   {
+      ::std::ofstream out{src_, ::std::ios::binary};
+      ::std::string const block(64 * 1024, 'x');
+      for (::std::size_t done = 0; done < file_size; done += block.size()) {
+         out << block;
+      }
+   }
+   ~tmpfs_files() {
+      fs::remove(src_);
+      fs::remove(dst_);
+   }
+
+   ::posixpp::fd open_src() const {
+      return ::posixpp::open(src_.c_str(), ::posixpp::fdflags::rdonly).result();
+   }
+   ::posixpp::fd open_dst() const {
+      using of = ::posixpp::openflags;
+      using fdf = ::posixpp::fdflags;
+      return ::posixpp::open(dst_.c_str(), of::creat | of::trunc | fdf::wronly,
+                             ::posixpp::modeflags::irwall).result();
+   }
+
+ private:
+   fs::path dir_, src_, dst_;
+};
+
+} // namespace
+
+TEST_CASE("Copy a file on tmpfs", "[transfer][benchmark]")
+{
+   tmpfs_files const files;
+   BENCHMARK("read and write") {
+      auto src{files.open_src()};
+      auto dst{files.open_dst()};
+      static char buf[64 * 1024];
+      ::std::size_t total = 0;
+      for (::std::size_t n;
+           (n = ::posixpp::read(src, buf, sizeof(buf)).result()) > 0; )
+      {
+         total += ::posixpp::write(dst, buf, n).result();
+      }
+      return total;
+   };
+   BENCHMARK("sendfile") {
+      auto src{files.open_src()};
+      auto dst{files.open_dst()};
+      ::std::size_t total = 0;
+      for (::std::size_t n;
+           (n = ::posixpp::sendfile(dst, src, file_size).result()) > 0; )
+      {
+         total += n;
+      }
+      return total;
+   };
+   BENCHMARK("splice through a pipe") {
+      auto src{files.open_src()};
+      auto dst{files.open_dst()};
+      auto p{::posixpp::pipe().result()};
+      ::std::size_t total = 0;
+      for (::std::size_t n;
+           (n = ::posixpp::splice(src, nullptr, p.write_end, nullptr,
+                                  64 * 1024).result()) > 0; )
+      {
+         while (n > 0) {
+            auto const out = ::posixpp::splice(p.read_end, nullptr,
+                                               dst, nullptr, n).result();
+            n -= out;
+            total += out;
+         }
+      }
+      return total;
+   };
+   BENCHMARK("copy_file_range") {
+      auto src{files.open_src()};
+      auto dst{files.open_dst()};
+      ::std::size_t total = 0;
+      for (::std::size_t n;
+           (n = ::posixpp::copy_file_range(src, nullptr, dst, nullptr,
+                                           file_size).result()) > 0; )
+      {
+         total += n;
+      }
+      return total;
+   };
+   BENCHMARK("posixpp::transfer") {
+      auto src{files.open_src()};
+      auto dst{files.open_dst()};
+      return ::posixpp::transfer(src, dst, file_size).result();
+   };
+}
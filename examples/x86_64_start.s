@@ -4,6 +4,10 @@ _start:
         xor %ebp, %ebp
         pop %rdi         # Pop argc into C++ ABI first argument
         mov %rsp, %rsi   # Push argv into C++ ABI second argument
+        # envp starts just past the nullptr terminating argv. Put it in the C++
+        # ABI third argument so main can hand it to posixpp::init_auxv, which
+        # finds the auxiliary vector just past the nullptr terminating envp.
+        lea 8(%rsi,%rdi,8), %rdx
         and $~15, %rsp   # 16-byte align stack
         pushq %rax       # Garbage, need two 8-byte pushes to maintain alignment.
         pushq %rsp       # end of stack
@@ -11,5 +15,5 @@ _start:
         hlt              # Hopefully crash if you get here.
 
 # TODO - Set up environ, see SVR4/i386 ABI (pages 3-31, 3-32), handle
-#        atexit registration for shared library finish function in
-#        %rdx
+#        atexit registration for shared library finish function that the
+#        dynamic linker passes in %rdx (overwritten above by envp).
@@ -0,0 +1,124 @@
+// Copyright 2021 Eric Hopper
+// Distributed under the terms of the LGPLv3.
+
+// Replaces the global operator new and operator delete with posixpp::heap.
+// This is the posixpp_new library, link it to use it.
+//
+// There's no new_handler support, running out of memory goes straight to
+// throwing bad_alloc (or the expected error handler without exceptions).
+
+#include <posixpp/heap.h>
+#include <posixpp/expected.h>
+#include <cstddef>
+#include <new>
+#include <system_error>
+
+namespace {
+
+void *checked(void *ptr)
+{
+   if (ptr == nullptr) [[unlikely]] {
+#ifdef POSIXPP_NO_EXCEPTIONS
+      ::posixpp::priv_::raise_error(
+           static_cast<int>(::std::errc::not_enough_memory)
+      );
+#else
+      throw ::std::bad_alloc{};
+#endif
+   }
+   return ptr;
+}
+
+::std::size_t align_of(::std::align_val_t align) noexcept
+{
+   return static_cast<::std::size_t>(align);
+}
+
+} // namespace
+
+void *operator new(::std::size_t size)
+{
+   return checked(::posixpp::heap::allocate(size));
+}
+void *operator new[](::std::size_t size)
+{
+   return checked(::posixpp::heap::allocate(size));
+}
+void *operator new(::std::size_t size, ::std::nothrow_t const &) noexcept
+{
+   return ::posixpp::heap::allocate(size);
+}
+void *operator new[](::std::size_t size, ::std::nothrow_t const &) noexcept
+{
+   return ::posixpp::heap::allocate(size);
+}
+void *operator new(::std::size_t size, ::std::align_val_t align)
+{
+   return checked(::posixpp::heap::allocate(size, align_of(align)));
+}
+void *operator new[](::std::size_t size, ::std::align_val_t align)
+{
+   return checked(::posixpp::heap::allocate(size, align_of(align)));
+}
+void *operator new(::std::size_t size, ::std::align_val_t align,
+                   ::std::nothrow_t const &) noexcept
+{
+   return ::posixpp::heap::allocate(size, align_of(align));
+}
+void *operator new[](::std::size_t size, ::std::align_val_t align,
+                     ::std::nothrow_t const &) noexcept
+{
+   return ::posixpp::heap::allocate(size, align_of(align));
+}
+
+// The heap finds the size and alignment itself, so every delete is the same.
+void operator delete(void *ptr) noexcept
+{
+   ::posixpp::heap::deallocate(ptr);
+}
+void operator delete[](void *ptr) noexcept
+{
+   ::posixpp::heap::deallocate(ptr);
+}
+void operator delete(void *ptr, ::std::size_t) noexcept
+{
+   ::posixpp::heap::deallocate(ptr);
+}
+void operator delete[](void *ptr, ::std::size_t) noexcept
+{
+   ::posixpp::heap::deallocate(ptr);
+}
+void operator delete(void *ptr, ::std::nothrow_t const &) noexcept
+{
+   ::posixpp::heap::deallocate(ptr);
+}
+void operator delete[](void *ptr, ::std::nothrow_t const &) noexcept
+{
+   ::posixpp::heap::deallocate(ptr);
+}
+void operator delete(void *ptr, ::std::align_val_t) noexcept
+{
+   ::posixpp::heap::deallocate(ptr);
+}
+void operator delete[](void *ptr, ::std::align_val_t) noexcept
+{
+   ::posixpp::heap::deallocate(ptr);
+}
+void operator delete(void *ptr, ::std::size_t, ::std::align_val_t) noexcept
+{
+   ::posixpp::heap::deallocate(ptr);
+}
+void operator delete[](void *ptr, ::std::size_t, ::std::align_val_t) noexcept
+{
+   ::posixpp::heap::deallocate(ptr);
+}
+void operator delete(void *ptr, ::std::align_val_t,
+                     ::std::nothrow_t const &) noexcept
+{
+   ::posixpp::heap::deallocate(ptr);
+}
+void operator delete[](void *ptr, ::std::align_val_t,
+                       ::std::nothrow_t const &) noexcept
+{
+   ::posixpp::heap::deallocate(ptr);
+}
@@ -0,0 +1,145 @@
+// Copyright 2021 Eric Hopper
+// Distributed under the terms of the LGPLv3.
+
+#pragma once  /*-*-c++-*-*/
+
+#include <posixpp/expected.h>
+#include <posixpp/mapping.h>
+#include <posixpp/mmapflags.h>
+#include <syscalls/linux/memory.h>
+#include <cstddef>
+#include <utility>
+
+namespace posixpp {
+
+/**
+ * \brief Hands out memory by bumping a pointer through one big mapping, and
+ * takes it all back at once.
+ *
+ * The whole range is reserved up front with `mapflags::noreserve`, so a large
+ * arena costs nothing until its pages are touched. Allocating is a few
+ * arithmetic instructions, and nothing is ever freed individually, only all
+ * together by `reset`. Destructors aren't run for anything in the arena.
+ *
+ * This needs nothing but system calls, so it works in freestanding programs
+ * that have no `malloc`. See arena_resource.h to use it with containers.
+ *
+ * An arena isn't thread safe.
+ */
+class arena {
+ public:
+   static constexpr ::std::size_t page_size = mapping::page_size;
+
+   /**
+    * \brief Reserve at least `reserve` bytes of address space.
+    *
+    * @param guard_page Put an inaccessible page after the end, so that code
+    * writing past the end of the last allocation crashes instead of silently
+    * scribbling on whatever is mapped next.
+    */
+   [[nodiscard]] static expected<arena>
+   create(::std::size_t reserve, bool guard_page = false) noexcept
+   {
+      using errtag = expected<arena>::err_tag;
+      ::std::size_t const usable = round_to_page(reserve > 0 ? reserve : 1);
+      ::std::size_t const guard = guard_page ? page_size : 0;
+      auto mapped = mmap_anonymous(usable + guard,
+                                   protflags::read | protflags::write,
+                                   mapflags::private_ | mapflags::noreserve);
+      if (mapped.has_error()) {
+         return expected<arena>{errtag{}, mapped.error()};
+      }
+      mapping region{::std::move(mapped.result())};
+      if (guard_page) {
+         auto const guarded = ::syscalls::linux::mprotect(
+              region.data() + usable, page_size, protflags::none.getbits()
+         );
+         if (guarded.has_error()) {
+            return expected<arena>{errtag{}, guarded.error()};
+         }
+      }
+      return expected<arena>{arena{::std::move(region), usable}};
+   }
+
+   arena(arena &&other) noexcept
+        : region_{::std::move(other.region_)},
+          capacity_{::std::exchange(other.capacity_, 0)},
+          used_{::std::exchange(other.used_, 0)},
+          touched_{::std::exchange(other.touched_, 0)}
+   {}
+   arena &operator =(arena &&other) noexcept {
+      if (this != &other) {
+         region_ = ::std::move(other.region_);
+         capacity_ = ::std::exchange(other.capacity_, 0);
+         used_ = ::std::exchange(other.used_, 0);
+         touched_ = ::std::exchange(other.touched_, 0);
+      }
+      return *this;
+   }
+
+   /**
+    * \brief `size` bytes aligned to `align` (which must be a power of two),
+    * or `nullptr` if the arena is full.
+    */
+   [[nodiscard]] void *allocate(::std::size_t size,
+                                ::std::size_t align
+                                     = alignof(::std::max_align_t)) noexcept
+   {
+      ::std::size_t const start = (used_ + align - 1) & ~(align - 1);
+      if (start > capacity_ || size > capacity_ - start) {
+         return nullptr;
+      }
+      used_ = start + size;
+      if (used_ > touched_) {
+         touched_ = used_;
+      }
+      return region_.data() + start;
+   }
+
+   /**
+    * \brief Make all the memory available again, invalidating everything
+    * allocated from the arena.
+    *
+    * @param release Also hand the pages that were used back to the kernel
+    * with `madvice::dontneed`, so an arena that once grew large doesn't hold
+    * on to that memory. They read as zero when next touched. Without it, the
+    * pages are kept and reused as they are, which is faster if the arena is
+    * about to fill up again anyway.
+    */
+   expected<void> reset(bool release = false) noexcept {
+      used_ = 0;
+      if (release && touched_ > 0) {
+         auto const length = round_to_page(touched_);
+         touched_ = 0;
+         return region_.advise(madvice::dontneed, 0, length);
+      }
+      return expected<void>{};
+   }
+
+   //! Bytes handed out since the last reset, including alignment padding.
+   [[nodiscard]] ::std::size_t used() const noexcept { return used_; }
+   //! How many bytes can be handed out in all, not counting a guard page.
+   [[nodiscard]] ::std::size_t capacity() const noexcept { return capacity_; }
+   //! Whether `ptr` points into this arena.
+   [[nodiscard]] bool owns(void const *ptr) const noexcept {
+      auto const *const p = static_cast<char const *>(ptr);
+      return p >= region_.data() && p < region_.data() + capacity_;
+   }
+
+ private:
+   arena(mapping &&region, ::std::size_t capacity) noexcept
+        : region_{::std::move(region)}, capacity_{capacity}
+   {}
+
+   static constexpr ::std::size_t round_to_page(::std::size_t n) noexcept {
+      return (n + page_size - 1) & ~(page_size - 1);
+   }
+
+   mapping region_;
+   ::std::size_t capacity_ = 0;
+   ::std::size_t used_ = 0;
+   //! The most that's been used since pages were last handed back.
+   ::std::size_t touched_ = 0;
+};
+
+} // namespace posixpp
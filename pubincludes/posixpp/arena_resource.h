@@ -0,0 +1,57 @@
+// Copyright 2021 Eric Hopper
+// Distributed under the terms of the LGPLv3.
+
+#pragma once  /*-*-c++-*-*/
+
+#include <posixpp/arena.h>
+#include <posixpp/expected.h>
+#include <cstddef>
+#include <memory_resource>
+#include <new>
+#include <system_error>
+
+namespace posixpp {
+
+/**
+ * \brief Lets the standard `pmr` containers allocate from an `arena`.
+ *
+ * This is kept apart from arena.h because `::std::pmr::memory_resource`
+ * needs the C++ runtime, and the arena itself doesn't.
+ *
+ * Deallocating does nothing, memory comes back when the arena is reset. Which
+ * has to wait until every container using it is gone.
+ */
+class arena_resource : public ::std::pmr::memory_resource {
+ public:
+   explicit arena_resource(arena &source) noexcept : arena_{source} {}
+
+   [[nodiscard]] arena &get_arena() const noexcept { return arena_; }
+
+ private:
+   //! Throws `::std::bad_alloc` when the arena is full.
+   void *do_allocate(::std::size_t bytes, ::std::size_t align) override {
+      void *const block = arena_.allocate(bytes, align);
+      if (block == nullptr) {
+#ifdef POSIXPP_NO_EXCEPTIONS
+         priv_::raise_error(static_cast<int>(::std::errc::not_enough_memory));
+#else
+         throw ::std::bad_alloc{};
+#endif
+      }
+      return block;
+   }
+
+   void do_deallocate(void *, ::std::size_t, ::std::size_t) noexcept override
+   {}
+
+   [[nodiscard]] bool
+   do_is_equal(::std::pmr::memory_resource const &other) const noexcept
+   override
+   {
+      return this == &other;
+   }
+
+   arena &arena_;
+};
+
+} // namespace posixpp
@@ -0,0 +1,333 @@
+// Copyright 2021 Eric Hopper
+// Distributed under the terms of the LGPLv3.
+
+#pragma once  /*-*-c++-*-*/
+
+#include <posixpp/expected.h>
+#include <posixpp/fd.h>
+#include <posixpp/fdflags.h>
+#include <posixpp/modeflags.h>
+#include <posixpp/io_uring.h>
+#include <posixpp/reactor.h>
+#include <posixpp/simpleio.h>
+#include <posixpp/task.h>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <system_error>
+#include <utility>
+
+/**
+ * \file
+ * \brief `co_await`-able versions of `read`, `write`, `openat` and `close`.
+ *
+ * There are two sets, one driven by an `io_uring` and one by a `reactor`. In
+ * both, the awaitable itself lives in the awaiting coroutine's frame and is
+ * what the event loop hands the result to, so no callback object is allocated
+ * per operation. Give the coroutines a `frame_pool` (see `task`) and a loop
+ * in steady state doesn't allocate at all.
+ */
+
+namespace posixpp {
+
+namespace priv_ {
+
+//! What an io_uring completion's `user_data` points at.
+struct uring_waiter {
+   ::std::coroutine_handle<> handle_;
+   expected<int> result_{0};
+};
+
+/**
+ * \brief Prepares an operation with `Prep` when suspended, and turns the
+ * completion into the awaited value with `Convert` when resumed.
+ */
+template <typename Prep, typename Convert>
+class uring_awaitable : private uring_waiter {
+ public:
+   uring_awaitable(io_uring &ring, Prep prep, Convert convert) noexcept
+        : ring_{ring}, prep_{::std::move(prep)}, convert_{::std::move(convert)}
+   {}
+
+   [[nodiscard]] bool await_ready() const noexcept { return false; }
+
+   bool await_suspend(::std::coroutine_handle<> waiting) noexcept {
+      handle_ = waiting;
+      auto const user_data = reinterpret_cast<::std::uintptr_t>(
+           static_cast<uring_waiter *>(this)
+      );
+      if (prep_(ring_, user_data)) {
+         return true;
+      }
+      // The submission queue is full, so hand it to the kernel to make room.
+      if (!ring_.submit().has_error() && prep_(ring_, user_data)) {
+         return true;
+      }
+      auto const busy = static_cast<int>(::std::errc::device_or_resource_busy);
+      result_ = expected<int>{expected<int>::err_tag{}, busy};
+      return false;
+   }
+
+   auto await_resume() { return convert_(::std::move(result_)); }
+
+ private:
+   io_uring &ring_;
+   Prep prep_;
+   Convert convert_;
+};
+
+inline expected<::std::size_t> to_size(expected<int> &&result) noexcept {
+   return error_cascade(::std::move(result),
+                        [](int n) { return static_cast<::std::size_t>(n); });
+}
+
+/**
+ * \brief Tries `Op` right away, and if it would block, waits for `events` on
+ * the file with a reactor and tries again.
+ *
+ * The file is added to the reactor only while an operation is waiting, so
+ * only one operation at a time can be waiting on any one file.
+ */
+template <typename Op>
+class reactor_awaitable : private event_handler {
+ public:
+   using result_t = decltype(::std::declval<Op &>()());
+
+   reactor_awaitable(reactor &r, fd const &file, epollevents events, Op op)
+   noexcept
+        : reactor_{r}, file_{file}, events_{events}, op_{::std::move(op)}
+   {}
+
+   [[nodiscard]] bool await_ready() noexcept {
+      result_.emplace(op_());
+      return !would_block();
+   }
+
+   bool await_suspend(::std::coroutine_handle<> waiting) noexcept {
+      handle_ = waiting;
+      auto const added = reactor_.add(file_, *this, events_);
+      if (added.has_error()) {
+         result_.emplace(typename result_t::err_tag{}, added.error());
+         return false;
+      }
+      return true;
+   }
+
+   result_t await_resume() { return ::std::move(*result_); }
+
+ private:
+   void on_events(epollevents) noexcept override {
+      result_.emplace(op_());
+      if (!would_block()) {
+         (void)reactor_.remove(file_, *this);
+         handle_.resume();
+      }
+   }
+
+   [[nodiscard]] bool would_block() const noexcept {
+      using ::std::errc;
+      return result_->has_error() &&
+             result_->error() ==
+                  static_cast<int>(errc::resource_unavailable_try_again);
+   }
+
+   reactor &reactor_;
+   fd const &file_;
+   epollevents events_;
+   Op op_;
+   ::std::optional<result_t> result_;
+   ::std::coroutine_handle<> handle_;
+};
+
+//! An operation that never waits, so it's done before it's awaited.
+template <typename T>
+class ready_awaitable {
+ public:
+   explicit ready_awaitable(expected<T> &&result) noexcept
+        : result_{::std::move(result)}
+   {}
+
+   [[nodiscard]] bool await_ready() const noexcept { return true; }
+   void await_suspend(::std::coroutine_handle<>) const noexcept {}
+   expected<T> await_resume() { return ::std::move(result_); }
+
+ private:
+   expected<T> result_;
+};
+
+} // namespace priv_
+
+/**
+ * \name Awaitable operations using an io_uring.
+ *
+ * These only prepare the operation when the coroutine suspends, it's handed
+ * to the kernel the next time the ring is submitted, by `run` or whatever
+ * else is driving the ring. `user_data` in the completion is a pointer to the
+ * awaiting operation, so a ring used with these must only carry operations
+ * started by them. A full submission queue is submitted to make room, and if
+ * that doesn't help the result is `EBUSY`.
+ *
+ * The buffers and path names must stay valid until the operation completes.
+ */
+//! @{
+//! See pread(2). An offset of `-1` means to use the file position.
+[[nodiscard]] inline auto
+async_read(io_uring &ring, fd const &file, char *buf, ::std::size_t size,
+           ::std::int64_t offset = -1) noexcept
+{
+   return priv_::uring_awaitable{
+        ring,
+        [&file, buf, size, offset](io_uring &r, ::std::uint64_t user_data) {
+           return r.prep_read(file, buf, size,
+                              static_cast<::std::uint64_t>(offset), user_data);
+        },
+        priv_::to_size
+   };
+}
+
+//! See pwrite(2). An offset of `-1` means to use the file position.
+[[nodiscard]] inline auto
+async_write(io_uring &ring, fd const &file, char const *buf,
+            ::std::size_t size, ::std::int64_t offset = -1) noexcept
+{
+   return priv_::uring_awaitable{
+        ring,
+        [&file, buf, size, offset](io_uring &r, ::std::uint64_t user_data) {
+           return r.prep_write(file, buf, size,
+                               static_cast<::std::uint64_t>(offset), user_data);
+        },
+        priv_::to_size
+   };
+}
+
+//! See openat(2).
+[[nodiscard]] inline auto
+async_openat(io_uring &ring, fd const &dirfd, char const *pathname,
+             openflags flags, modeflags mode = modeflags{}) noexcept
+{
+   return priv_::uring_awaitable{
+        ring,
+        [&dirfd, pathname, flags, mode](io_uring &r,
+                                        ::std::uint64_t user_data) {
+           return r.prep_openat(dirfd, pathname, flags, mode, user_data);
+        },
+        [](expected<int> &&result) {
+           return error_cascade(::std::move(result),
+                                [](int fdint) { return fd{fdint}; });
+        }
+   };
+}
+
+//! See close(2). `file` is made invalid once the close is prepared.
+[[nodiscard]] inline auto async_close(io_uring &ring, fd &file) noexcept
+{
+   return priv_::uring_awaitable{
+        ring,
+        [&file](io_uring &r, ::std::uint64_t user_data) {
+           if (r.prep_close(file.as_fd(), user_data)) {
+              (void)file.release();
+              return true;
+           }
+           return false;
+        },
+        [](expected<int> &&result) {
+           return error_cascade_void(::std::move(result));
+        }
+   };
+}
+//! @}
+
+//! Resume every coroutine whose io_uring operation has completed.
+inline unsigned resume_completed(io_uring &ring)
+{
+   return ring.for_each_completion([](io_completion &&comp) {
+      auto *const waiter = reinterpret_cast<priv_::uring_waiter *>(
+           static_cast<::std::uintptr_t>(comp.user_data)
+      );
+      waiter->result_ = ::std::move(comp.result);
+      waiter->handle_.resume();
+   });
+}
+
+/**
+ * \brief Start `work` and drive `ring` until it finishes.
+ *
+ * Everything `work` awaits has to be an io_uring operation on `ring`, or
+ * another task that only awaits those, or this waits forever.
+ */
+template <typename T>
+expected<void> run(io_uring &ring, task<T> &work)
+{
+   work.start();
+   while (!work.done()) {
+      auto const submitted = ring.submit(1);
+      if (submitted.has_error()
+          && submitted.error() != static_cast<int>(::std::errc::interrupted))
+      {
+         return expected<void>{submitted.error()};
+      }
+      resume_completed(ring);
+   }
+   return expected<void>{};
+}
+
+/**
+ * \name Awaitable operations using a reactor.
+ *
+ * `read` and `write` are attempted straight away, and only if they fail with
+ * `EAGAIN` does the coroutine suspend until the reactor says the file is
+ * ready. So the file must be non-blocking, as `reactor::add` requires.
+ *
+ * Regular files are always ready as far as epoll is concerned, so `openat`
+ * and `close` just do the system call and don't suspend. They're here so a
+ * handler can be written the same way no matter what's driving it.
+ */
+//! @{
+[[nodiscard]] inline auto
+async_read(reactor &r, fd const &file, char *buf, ::std::size_t size) noexcept
+{
+   return priv_::reactor_awaitable{
+        r, file, epollevents::in | epollevents::rdhup,
+        [&file, buf, size]() { return read(file, buf, size); }
+   };
+}
+
+[[nodiscard]] inline auto
+async_write(reactor &r, fd const &file, char const *buf,
+            ::std::size_t size) noexcept
+{
+   return priv_::reactor_awaitable{
+        r, file, epollevents::out,
+        [&file, buf, size]() { return write(file, buf, size); }
+   };
+}
+
+[[nodiscard]] inline auto
+async_openat(reactor &, fd const &dirfd, char const *pathname,
+             openflags flags, modeflags mode = modeflags{}) noexcept
+{
+   return priv_::ready_awaitable<fd>{openat(dirfd, pathname, flags, mode)};
+}
+
+[[nodiscard]] inline auto async_close(reactor &, fd &file) noexcept
+{
+   return priv_::ready_awaitable<void>{file.close()};
+}
+//! @}
+
+//! Start `work` and drive `r` until it finishes.
+template <typename T>
+expected<void> run(reactor &r, task<T> &work)
+{
+   work.start();
+   while (!work.done()) {
+      auto const polled = r.poll();
+      if (polled.has_error()) {
+         return expected<void>{polled.error()};
+      }
+   }
+   return expected<void>{};
+}
+
+} // namespace posixpp
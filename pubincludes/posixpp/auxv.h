@@ -0,0 +1,43 @@
+// Copyright 2021 Eric Hopper
+// Distributed under the terms of the LGPLv3.
+
+#pragma once  /*-*-c++-*-*/
+
+#include <syscalls/linux/auxv.h>
+#include <cstdint>
+#include <optional>
+
+namespace posixpp {
+
+using ::syscalls::linux::auxv_type;
+using ::syscalls::linux::auxv_entry;
+
+namespace priv_ {
+inline auxv_entry const *process_auxv = nullptr;
+} // namespace priv_
+
+/**
+ * \brief Remember where the auxiliary vector is, given the `envp` `main` got.
+ *
+ * Without libc, there's nothing that does this automatically. The start code
+ * in `examples/x86_64_start.s` passes the original `envp` as the third
+ * argument of `main`, which should call this before anything (like
+ * `init_vdso`) that needs the auxiliary vector.
+ */
+inline void init_auxv(char const * const *envp) noexcept
+{
+   priv_::process_auxv = ::syscalls::linux::auxv_from_envp(envp);
+}
+
+//! See getauxval(3). Always empty if `init_auxv` hasn't been called.
+[[nodiscard]] inline ::std::optional<::std::uint64_t>
+getauxval(auxv_type type) noexcept
+{
+   if (priv_::process_auxv == nullptr) {
+      return ::std::nullopt;
+   } else {
+      return ::syscalls::linux::auxv_lookup(priv_::process_auxv, type);
+   }
+}
+
+} // namespace posixpp
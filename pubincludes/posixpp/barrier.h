@@ -0,0 +1,123 @@
+// Copyright 2021 Eric Hopper
+// Distributed under the terms of the LGPLv3.
+
+#pragma once  /*-*-c++-*-*/
+
+#include <posixpp/expected.h>
+#include <posixpp/futex.h>
+#include <atomic>
+#include <climits>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace posixpp {
+
+namespace priv_ {
+struct empty_completion {
+   void operator ()() const noexcept {}
+};
+} // namespace priv_
+
+/**
+ * \brief A reusable barrier for a group of threads, like `::std::barrier`.
+ *
+ * The state of the current phase is one 32 bit word: how many arrivals are
+ * still expected, a bit for which phase it is, and a bit saying somebody
+ * might be asleep waiting for the phase to end. The last thread to arrive
+ * runs the completion function, starts the next phase, and only calls the
+ * kernel if that bit was set.
+ *
+ * The completion function must not throw.
+ */
+template <typename Completion = priv_::empty_completion>
+requires ::std::invocable<Completion &>
+class barrier {
+ public:
+   //! What `arrive` returns and `wait` needs, saying which phase it was.
+   class arrival_token {
+    private:
+      friend class barrier;
+      explicit arrival_token(::std::uint32_t phase) noexcept : phase_{phase} {}
+      ::std::uint32_t phase_;
+   };
+
+   static constexpr ::std::ptrdiff_t max() noexcept { return count_mask; }
+
+   //! `expected` must be between 0 and `max()`.
+   constexpr explicit barrier(::std::ptrdiff_t expected,
+                              Completion completion = Completion{}) noexcept
+        : word_{static_cast<::std::uint32_t>(expected)},
+          expected_{static_cast<::std::uint32_t>(expected)},
+          completion_{::std::move(completion)}
+   {}
+   barrier(barrier const &) = delete;
+   barrier &operator =(barrier const &) = delete;
+
+   /**
+    * \brief Count `n` arrivals at the current phase.
+    *
+    * If they're the last ones expected, this runs the completion function and
+    * starts the next phase before returning.
+    */
+   [[nodiscard]] arrival_token arrive(::std::ptrdiff_t n = 1) noexcept {
+      auto const dec = static_cast<::std::uint32_t>(n);
+      ::std::uint32_t const old = word_.fetch_sub(dec,
+                                                  ::std::memory_order_acq_rel);
+      ::std::uint32_t const phase = old & phase_bit;
+      if ((old & count_mask) == dec) {
+         completion_();
+         ::std::uint32_t const next = (phase ^ phase_bit)
+              | expected_.load(::std::memory_order_relaxed);
+         // An exchange rather than a store, so a waiter that set the waiting
+         // bit after the fetch_sub above is still seen.
+         if ((word_.exchange(next, ::std::memory_order_acq_rel) & waiting) != 0)
+         {
+            static_cast<void>(futex_wake(word_, INT_MAX));
+         }
+      }
+      return arrival_token{phase};
+   }
+
+   //! Wait for the phase `arrival` came from to finish.
+   expected<void> wait(arrival_token &&arrival) const noexcept {
+      for (;;) {
+         ::std::uint32_t c = word_.load(::std::memory_order_acquire);
+         if ((c & phase_bit) != arrival.phase_) {
+            return expected<void>{};
+         }
+         if ((c & waiting) == 0
+             && !word_.compare_exchange_weak(c, c | waiting,
+                                             ::std::memory_order_relaxed))
+         {
+            continue;
+         }
+         auto const result = futex_wait(word_, c | waiting);
+         if (priv_::is_real_wait_error(result)) {
+            return result;
+         }
+      }
+   }
+
+   expected<void> arrive_and_wait() noexcept {
+      return wait(arrive());
+   }
+
+   //! Arrive at the current phase and leave the group for the phases after.
+   void arrive_and_drop() noexcept {
+      expected_.fetch_sub(1, ::std::memory_order_relaxed);
+      static_cast<void>(arrive());
+   }
+
+ private:
+   static constexpr ::std::uint32_t waiting = 0x8000'0000U;
+   static constexpr ::std::uint32_t phase_bit = 0x4000'0000U;
+   static constexpr ::std::uint32_t count_mask = phase_bit - 1;
+
+   mutable futex_word word_;
+   ::std::atomic<::std::uint32_t> expected_;
+   [[no_unique_address]] Completion completion_;
+};
+
+} // namespace posixpp
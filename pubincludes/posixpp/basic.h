@@ -17,4 +17,9 @@ inline void exit_thread [[noreturn]] (int status)
    ::syscalls::linux::exit(status);
 }
 
+inline void sched_yield() noexcept
+{
+   ::syscalls::linux::sched_yield();
+}
+
 }
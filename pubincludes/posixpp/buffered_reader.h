@@ -0,0 +1,147 @@
+// Copyright 2021 Eric Hopper
+// Distributed under the terms of the LGPLv3.
+
+#pragma once  /*-*-c++-*-*/
+
+#include <posixpp/expected.h>
+#include <posixpp/fd.h>
+#include <posixpp/mapping.h>
+#include <posixpp/simpleio.h>
+#include <pppbase/find_byte.h>
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+namespace posixpp {
+
+/**
+ * \brief Reads delimited records (usually lines) from a file descriptor
+ * without copying them.
+ *
+ * The records are returned as views into a page aligned buffer the reader
+ * owns. A view is only good until the next call to a reading function,
+ * which may move or reuse the memory it points to. A record longer than the
+ * buffer makes the buffer grow (with mremap, so the old contents usually
+ * aren't copied) until it fits.
+ *
+ * Once `read` on the file descriptor returns 0 the reader considers itself at
+ * end of file, and never tries to read again.
+ *
+ * The reader doesn't own the file descriptor, which must outlive it.
+ */
+class buffered_reader {
+ public:
+   static constexpr ::std::size_t default_capacity = 64 * 1024;
+
+   /**
+    * \brief Create a reader for `file` with a buffer of at least `capacity`
+    * bytes.
+    */
+   [[nodiscard]] static expected<buffered_reader>
+   create(fd const &file, ::std::size_t capacity = default_capacity) noexcept
+   {
+      auto const pages = (capacity + mapping::page_size - 1)
+                         / mapping::page_size;
+      ::std::size_t const size = (pages > 0 ? pages : 1) * mapping::page_size;
+      return error_cascade(mmap_anonymous(size),
+                           [&file](mapping &&buf) {
+                              return buffered_reader{file, ::std::move(buf)};
+                           });
+   }
+
+   /**
+    * \brief Read up to and including the next `delim`.
+    *
+    * At end of file the record is whatever was left, which won't end with
+    * `delim`. After that, the result is always an empty view.
+    */
+   [[nodiscard]] expected<::std::string_view> read_until(char delim) noexcept
+   {
+      using errtag = expected<::std::string_view>::err_tag;
+      for (;;) {
+         char const *const data = buf_.data();
+         char const *const found =
+              ::pppbase::find_byte(data + scan_, data + end_, delim);
+         if (found != data + end_) {
+            auto const next = static_cast<::std::size_t>(found - data) + 1;
+            ::std::string_view const record{data + begin_, next - begin_};
+            begin_ = scan_ = next;
+            return expected<::std::string_view>{record};
+         }
+         scan_ = end_;
+         if (eof_) {
+            ::std::string_view const rest{data + begin_, end_ - begin_};
+            begin_ = scan_ = end_;
+            return expected<::std::string_view>{rest};
+         }
+         auto const filled = fill();
+         if (filled.has_error()) {
+            return expected<::std::string_view>{errtag{}, filled.error()};
+         }
+      }
+   }
+
+   //! Same as `read_until('\n')`
+   [[nodiscard]] expected<::std::string_view> read_line() noexcept {
+      return read_until('\n');
+   }
+
+   //! What's been read from the file, but not yet returned.
+   [[nodiscard]] ::std::string_view buffered() const noexcept {
+      return {buf_.data() + begin_, end_ - begin_};
+   }
+
+   //! The current size of the buffer.
+   [[nodiscard]] ::std::size_t capacity() const noexcept {
+      return buf_.size();
+   }
+
+   //! Whether `read` on the file descriptor has returned 0.
+   [[nodiscard]] bool at_eof() const noexcept { return eof_; }
+
+ private:
+   buffered_reader(fd const &file, mapping &&buf) noexcept
+        : file_{&file}, buf_{::std::move(buf)}
+   {}
+
+   //! Make room at the end of the buffer, and read into it.
+   expected<void> fill() noexcept {
+      if (begin_ > 0) {
+         ::std::memmove(buf_.data(), buf_.data() + begin_, end_ - begin_);
+         end_ -= begin_;
+         scan_ -= begin_;
+         begin_ = 0;
+      }
+      if (end_ == buf_.size()) {
+         auto const grown = buf_.resize(buf_.size() * 2);
+         if (grown.has_error()) {
+            return grown;
+         }
+      }
+      for (;;) {
+         auto const result = read(*file_, buf_.data() + end_,
+                                  buf_.size() - end_);
+         if (!result.has_error()) {
+            end_ += result.result();
+            eof_ = result.result() == 0;
+            return expected<void>{};
+         } else if (result.error() != static_cast<int>(::std::errc::interrupted)) {
+            return expected<void>{result.error()};
+         }
+      }
+   }
+
+   fd const *file_;
+   mapping buf_;
+   //! Start of what hasn't been returned yet.
+   ::std::size_t begin_ = 0;
+   //! Where to resume looking for a delimiter.
+   ::std::size_t scan_ = 0;
+   //! End of what's been read.
+   ::std::size_t end_ = 0;
+   bool eof_ = false;
+};
+
+} // namespace posixpp
@@ -0,0 +1,217 @@
+// Copyright 2021 Eric Hopper
+// Distributed under the terms of the LGPLv3.
+
+#pragma once  /*-*-c++-*-*/
+
+#include <posixpp/expected.h>
+#include <posixpp/fd.h>
+#include <posixpp/mapping.h>
+#include <posixpp/simpleio.h>
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+namespace posixpp {
+
+/**
+ * \brief Collects writes to a file descriptor so they can be sent with a
+ * single writev(2).
+ *
+ * There are two ways to add data. `write` copies it into a buffer the writer
+ * owns, which is best for lots of small pieces. `write_ref` just remembers
+ * where the data is, so big payloads are never copied, but the caller has to
+ * keep that memory alive and unchanged until the next `flush`. Both kinds end
+ * up in one list of iovecs, in the order they were added.
+ *
+ * Nothing is written until the buffer or the iovec list fills up, or `flush`
+ * is called. The destructor flushes, ignoring any errors, so call `flush`
+ * before destroying the writer if you care about them.
+ *
+ * The writer doesn't own the file descriptor, which must outlive it.
+ */
+class buffered_writer {
+ public:
+   static constexpr ::std::size_t default_capacity = 64 * 1024;
+   //! How many iovecs are collected before they're flushed.
+   static constexpr unsigned max_iov = 64;
+
+   /**
+    * \brief Create a writer for `file` with a buffer of at least `capacity`
+    * bytes.
+    */
+   [[nodiscard]] static expected<buffered_writer>
+   create(fd const &file, ::std::size_t capacity = default_capacity) noexcept
+   {
+      auto const pages = (capacity + mapping::page_size - 1)
+                         / mapping::page_size;
+      ::std::size_t const size = (pages > 0 ? pages : 1) * mapping::page_size;
+      return error_cascade(mmap_anonymous(size),
+                           [&file](mapping &&buf) {
+                              return buffered_writer{file, ::std::move(buf)};
+                           });
+   }
+
+   buffered_writer(buffered_writer &&other) noexcept
+        : file_{other.file_}, buf_{::std::move(other.buf_)},
+          used_{::std::exchange(other.used_, 0)},
+          run_start_{::std::exchange(other.run_start_, 0)},
+          niov_{::std::exchange(other.niov_, 0)}
+   {
+      ::std::memcpy(iov_, other.iov_, sizeof(iov_));
+   }
+   //! Flushes the destination first, ignoring any errors.
+   buffered_writer &operator =(buffered_writer &&other) noexcept {
+      if (this != &other) {
+         if (buf_.is_valid()) {
+            static_cast<void>(flush());
+         }
+         file_ = other.file_;
+         buf_ = ::std::move(other.buf_);
+         used_ = ::std::exchange(other.used_, 0);
+         run_start_ = ::std::exchange(other.run_start_, 0);
+         niov_ = ::std::exchange(other.niov_, 0);
+         ::std::memcpy(iov_, other.iov_, sizeof(iov_));
+      }
+      return *this;
+   }
+
+   //! Flushes, and ignores any errors in doing so.
+   ~buffered_writer() noexcept {
+      if (buf_.is_valid()) {
+         static_cast<void>(flush());
+      }
+   }
+
+   /**
+    * \brief Copy `size` bytes at `data` to be written later.
+    *
+    * A piece too big to fit in what's left of the buffer, that's also at
+    * least a quarter of the buffer, is written straight from `data` along
+    * with everything before it instead of being copied.
+    */
+   expected<void> write(char const *data, ::std::size_t size) noexcept {
+      if (size <= buf_.size() - used_) {
+         ::std::memcpy(buf_.data() + used_, data, size);
+         used_ += size;
+         return expected<void>{};
+      } else if (size >= buf_.size() / 4) {
+         auto const added = write_ref(data, size);
+         if (added.has_error()) {
+            return added;
+         }
+         return flush();
+      } else {
+         auto const flushed = flush();
+         if (flushed.has_error()) {
+            return flushed;
+         }
+         ::std::memcpy(buf_.data(), data, size);
+         used_ = size;
+         return expected<void>{};
+      }
+   }
+
+   expected<void> write(::std::string_view data) noexcept {
+      return write(data.data(), data.size());
+   }
+
+   /**
+    * \brief Arrange for `size` bytes at `data` to be written without copying
+    * them.
+    *
+    * The memory must stay valid and unchanged until the next `flush` (or
+    * until a `write` or `write_ref` that causes one returns).
+    */
+   expected<void> write_ref(char const *data, ::std::size_t size) noexcept {
+      if (size == 0) {
+         return expected<void>{};
+      }
+      // Room is needed for the buffered run before this and this.
+      if (niov_ + 2 > max_iov) {
+         auto const flushed = flush();
+         if (flushed.has_error()) {
+            return flushed;
+         }
+      }
+      end_run();
+      iov_[niov_++] = const_iovec{data, size};
+      return expected<void>{};
+   }
+
+   expected<void> write_ref(::std::string_view data) noexcept {
+      return write_ref(data.data(), data.size());
+   }
+
+   //! How many bytes are waiting to be written.
+   [[nodiscard]] ::std::size_t pending() const noexcept {
+      ::std::size_t total = used_ - run_start_;
+      for (unsigned i = 0; i < niov_; ++i) {
+         total += iov_[i].iov_len;
+      }
+      return total;
+   }
+
+   /**
+    * \brief Write everything that's waiting, with as few calls to writev as
+    * possible.
+    *
+    * Short writes are continued from where they left off. If there's an
+    * error, whatever wasn't written yet is dropped.
+    */
+   expected<void> flush() noexcept {
+      end_run();
+      const_iovec *iov = iov_;
+      unsigned left = niov_;
+      expected<void> status{};
+      while (left > 0) {
+         auto const written = writev(*file_, ::std::span{iov, left});
+         if (written.has_error()) {
+            if (written.error() == static_cast<int>(::std::errc::interrupted)) {
+               continue;
+            }
+            status = expected<void>{written.error()};
+            break;
+         }
+         ::std::size_t n = written.result();
+         while (left > 0 && n >= iov->iov_len) {
+            n -= iov->iov_len;
+            ++iov;
+            --left;
+         }
+         if (left > 0) {
+            iov->iov_base = static_cast<char const *>(iov->iov_base) + n;
+            iov->iov_len -= n;
+         }
+      }
+      niov_ = 0;
+      used_ = run_start_ = 0;
+      return status;
+   }
+
+ private:
+   buffered_writer(fd const &file, mapping &&buf) noexcept
+        : file_{&file}, buf_{::std::move(buf)}
+   {}
+
+   //! Add an iovec for what's been copied into the buffer since the last one.
+   void end_run() noexcept {
+      if (used_ > run_start_) {
+         iov_[niov_++] = const_iovec{buf_.data() + run_start_,
+                                     used_ - run_start_};
+         run_start_ = used_;
+      }
+   }
+
+   fd const *file_;
+   mapping buf_;
+   //! How much of the buffer is in use.
+   ::std::size_t used_ = 0;
+   //! Start of the data in the buffer that isn't in `iov_` yet.
+   ::std::size_t run_start_ = 0;
+   unsigned niov_ = 0;
+   const_iovec iov_[max_iov];
+};
+
+} // namespace posixpp
@@ -0,0 +1,144 @@
+// Copyright 2021 Eric Hopper
+// Distributed under the terms of the LGPLv3.
+
+#pragma once  /*-*-c++-*-*/
+
+#include <posixpp/expected.h>
+#include <posixpp/auxv.h>
+#include <syscalls/linux/time.h>
+#include <syscalls/linux/vdso.h>
+#include <syscalls/linux/x86_64/vdso.h>
+#include <cstdint>
+
+namespace posixpp {
+
+using ::syscalls::linux::timespec;
+using ::syscalls::linux::timeval;
+using ::syscalls::linux::clockid;
+
+//! Which CPU and NUMA node the calling thread was running on.
+struct cpu_location {
+   unsigned cpu;
+   unsigned node;
+};
+
+namespace priv_ {
+//! Entry points found in the vDSO. A `nullptr` means use the system call.
+struct vdso_functions {
+   using clock_gettime_fn = int (*)(int, timespec *);
+   using clock_getres_fn = int (*)(int, timespec *);
+   using gettimeofday_fn = int (*)(timeval *, void *);
+   using time_fn = ::std::int64_t (*)(::std::int64_t *);
+   using getcpu_fn = long (*)(unsigned *, unsigned *, void *);
+
+   clock_gettime_fn clock_gettime = nullptr;
+   clock_getres_fn clock_getres = nullptr;
+   gettimeofday_fn gettimeofday = nullptr;
+   time_fn time = nullptr;
+   getcpu_fn getcpu = nullptr;
+};
+
+inline vdso_functions vdso;
+
+//! The vDSO functions return the raw system call convention on failure.
+template <typename T>
+expected<T> vdso_result(long retval, T const &val) noexcept
+{
+   using errtag = typename expected<T>::err_tag;
+   if (retval < 0) {
+      return expected<T>{errtag{}, static_cast<int>(-retval)};
+   } else {
+      return expected<T>{val};
+   }
+}
+} // namespace priv_
+
+/**
+ * \brief Find the vDSO and use it for the functions in this header.
+ *
+ * `init_auxv` must be called first. Until this is called, or if it fails
+ * (returns `false`), or if a particular function isn't in the vDSO, the
+ * functions in this header make a real system call instead.
+ */
+inline bool init_vdso() noexcept
+{
+   namespace names = ::syscalls::linux::x86_64::vdso_names;
+   using fns = priv_::vdso_functions;
+   auto const base = getauxval(auxv_type::sysinfo_ehdr);
+   if (!base.has_value() || base.value() == 0) {
+      return false;
+   }
+   ::syscalls::linux::vdso_image const image{
+        reinterpret_cast<void const *>(base.value())
+   };
+   auto const find = [&image](char const *name) {
+      return image.lookup(name, names::version);
+   };
+   auto &vdso = priv_::vdso;
+   vdso.clock_gettime =
+        reinterpret_cast<fns::clock_gettime_fn>(find(names::clock_gettime));
+   vdso.clock_getres =
+        reinterpret_cast<fns::clock_getres_fn>(find(names::clock_getres));
+   vdso.gettimeofday =
+        reinterpret_cast<fns::gettimeofday_fn>(find(names::gettimeofday));
+   vdso.time = reinterpret_cast<fns::time_fn>(find(names::time));
+   vdso.getcpu = reinterpret_cast<fns::getcpu_fn>(find(names::getcpu));
+   return image.is_valid();
+}
+
+//! See clock_gettime(2)
+[[nodiscard]] inline expected<timespec> clock_gettime(clockid clock) noexcept
+{
+   timespec ts{};
+   if (auto const func = priv_::vdso.clock_gettime) {
+      return priv_::vdso_result(func(static_cast<int>(clock), &ts), ts);
+   }
+   return error_cascade(::syscalls::linux::clock_gettime(clock, &ts),
+                        [&ts](auto) { return ts; });
+}
+
+//! See clock_getres(2)
+[[nodiscard]] inline expected<timespec> clock_getres(clockid clock) noexcept
+{
+   timespec ts{};
+   if (auto const func = priv_::vdso.clock_getres) {
+      return priv_::vdso_result(func(static_cast<int>(clock), &ts), ts);
+   }
+   return error_cascade(::syscalls::linux::clock_getres(clock, &ts),
+                        [&ts](auto) { return ts; });
+}
+
+//! See gettimeofday(2), the obsolete timezone argument isn't supported.
+[[nodiscard]] inline expected<timeval> gettimeofday() noexcept
+{
+   timeval tv{};
+   if (auto const func = priv_::vdso.gettimeofday) {
+      return priv_::vdso_result(func(&tv, nullptr), tv);
+   }
+   return error_cascade(::syscalls::linux::gettimeofday(&tv),
+                        [&tv](auto) { return tv; });
+}
+
+//! See time(2)
+[[nodiscard]] inline expected<::std::int64_t> time() noexcept
+{
+   if (auto const func = priv_::vdso.time) {
+      auto const now = func(nullptr);
+      return priv_::vdso_result(now, now);
+   }
+   return error_cascade(::syscalls::linux::time(nullptr),
+                        [](auto t) { return static_cast<::std::int64_t>(t); });
+}
+
+//! See getcpu(2)
+[[nodiscard]] inline expected<cpu_location> getcpu() noexcept
+{
+   cpu_location loc{};
+   if (auto const func = priv_::vdso.getcpu) {
+      return priv_::vdso_result(func(&loc.cpu, &loc.node, nullptr), loc);
+   }
+   return error_cascade(::syscalls::linux::getcpu(&loc.cpu, &loc.node),
+                        [&loc](auto) { return loc; });
+}
+
+} // namespace posixpp
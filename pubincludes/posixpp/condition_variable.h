@@ -0,0 +1,169 @@
+// Copyright 2021 Eric Hopper
+// Distributed under the terms of the LGPLv3.
+
+#pragma once  /*-*-c++-*-*/
+
+#include <posixpp/expected.h>
+#include <posixpp/futex.h>
+#include <posixpp/mutex.h>
+#include <syscalls/linux/time.h>
+#include <atomic>
+#include <concepts>
+#include <cstdint>
+#include <limits>
+#include <system_error>
+
+namespace posixpp {
+
+//! Whether a timed wait ended because the deadline passed.
+enum class cv_status {
+   no_timeout,
+   timeout
+};
+
+/**
+ * \brief A condition variable that works with `posixpp::mutex`.
+ *
+ * Waiters sleep on a sequence number that every notification bumps.
+ * `notify_all` only wakes one waiter. The rest are moved by the kernel
+ * (FUTEX_CMP_REQUEUE) to sleep on the mutex word, so they're woken one at a
+ * time as the mutex is released instead of all waking at once to fight over
+ * it. Notifying when nobody is waiting doesn't call the kernel.
+ *
+ * Timed waits take an absolute `CLOCK_MONOTONIC` deadline, which goes
+ * straight to the kernel.
+ */
+class condition_variable {
+ public:
+   constexpr condition_variable() noexcept = default;
+   condition_variable(condition_variable const &) = delete;
+   condition_variable &operator =(condition_variable const &) = delete;
+
+   //! Wake one waiter, if there are any.
+   expected<void> notify_one() noexcept {
+      seq_.fetch_add(1);
+      if (waiters_.load() == 0) {
+         return expected<void>{};
+      }
+      return error_cascade_void(futex_wake(seq_, 1));
+   }
+
+   //! Wake one waiter and move the rest onto the mutex.
+   expected<void> notify_all() noexcept {
+      using ::std::errc;
+      ::std::uint32_t const seq = seq_.fetch_add(1) + 1;
+      if (waiters_.load() == 0) {
+         return expected<void>{};
+      }
+      mutex *const m = mutex_.load(::std::memory_order_relaxed);
+      auto result = futex_cmp_requeue(seq_, seq,
+                                      1, ::std::numeric_limits<int>::max(),
+                                      m->state_);
+      if (result.has_error()
+          && result.error() == static_cast<int>(errc::resource_unavailable_try_again))
+      {
+         // Someone else notified in the meantime, and their notification
+         // will take care of all current waiters.
+         return expected<void>{};
+      }
+      return error_cascade_void(::std::move(result));
+   }
+
+   //! Unlock `m`, wait for a notification, then lock `m` again.
+   ///
+   /// As usual, spurious wakeups are possible.
+   expected<void> wait(mutex &m) noexcept {
+      ::std::uint32_t const seq = prepare_wait(m);
+      auto result = futex_wait(seq_, seq);
+      return finish_wait(m, result);
+   }
+
+   //! Wait until `pred()` is true.
+   template <typename Predicate>
+   requires ::std::predicate<Predicate &>
+   expected<void> wait(mutex &m, Predicate pred) {
+      while (!pred()) {
+         auto result = wait(m);
+         if (result.has_error()) {
+            return result;
+         }
+      }
+      return expected<void>{};
+   }
+
+   /**
+    * \brief Like `wait`, but gives up at `deadline`.
+    *
+    * @param deadline An absolute `CLOCK_MONOTONIC` time.
+    */
+   expected<cv_status>
+   wait_until(mutex &m, ::syscalls::linux::timespec const &deadline) noexcept
+   {
+      using ::std::errc;
+      using errtag = expected<cv_status>::err_tag;
+      ::std::uint32_t const seq = prepare_wait(m);
+      auto result = futex_wait_until(seq_, seq, deadline);
+      bool const timedout =
+           result.has_error()
+           && result.error() == static_cast<int>(errc::timed_out);
+      auto const finished = finish_wait(m, timedout ? expected<void>{} : result);
+      if (finished.has_error()) {
+         return expected<cv_status>{errtag{}, finished.error()};
+      }
+      return expected<cv_status>{
+           timedout ? cv_status::timeout : cv_status::no_timeout
+      };
+   }
+
+   //! Wait until `pred()` is true or `deadline`, returns the final `pred()`.
+   template <typename Predicate>
+   requires ::std::predicate<Predicate &>
+   expected<bool> wait_until(mutex &m,
+                             ::syscalls::linux::timespec const &deadline,
+                             Predicate pred)
+   {
+      using errtag = expected<bool>::err_tag;
+      while (!pred()) {
+         auto result = wait_until(m, deadline);
+         if (result.has_error()) {
+            return expected<bool>{errtag{}, result.error()};
+         }
+         if (result.result() == cv_status::timeout) {
+            return expected<bool>{pred()};
+         }
+      }
+      return expected<bool>{true};
+   }
+
+ private:
+   //! Called with `m` held, returns the sequence number to wait on.
+   ::std::uint32_t prepare_wait(mutex &m) noexcept {
+      mutex_.store(&m, ::std::memory_order_relaxed);
+      // Sequentially consistent, paired with notify reading waiters_ after
+      // bumping seq_. Either the notifier sees this waiter, or this waiter
+      // sees the new sequence number and doesn't sleep.
+      waiters_.fetch_add(1);
+      ::std::uint32_t const seq = seq_.load();
+      static_cast<void>(m.unlock());
+      return seq;
+   }
+
+   //! Relock `m` after a wait, the result of which is `waited`.
+   expected<void> finish_wait(mutex &m, expected<void> const &waited) noexcept {
+      // This might have been requeued onto the mutex, and the thread that
+      // unlocks it has to know to wake the next one. So the mutex is always
+      // marked as contended here.
+      auto relocked = m.lock_contended(mutex::locked);
+      waiters_.fetch_sub(1, ::std::memory_order_relaxed);
+      if (priv_::is_real_wait_error(waited)) {
+         return waited;
+      }
+      return relocked;
+   }
+
+   futex_word seq_ = 0;
+   ::std::atomic<::std::uint32_t> waiters_ = 0;
+   ::std::atomic<mutex *> mutex_ = nullptr;
+};
+
+} // namespace posixpp
@@ -0,0 +1,60 @@
+// Copyright 2021 Eric Hopper
+// Distributed under the terms of the LGPLv3.
+
+#pragma once  /*-*-c++-*-*/
+
+#include <posixpp/expected.h>
+#include <posixpp/fd.h>
+#include <posixpp/simpleio.h>
+#include <syscalls/linux/eventfd.h>
+#include <syscalls/linux/x86_64/eventfdflags.h>
+#include <cstdint>
+#include <cstring>
+#include <system_error>
+
+namespace posixpp {
+
+using ::syscalls::linux::x86_64::eventfdflags;
+
+//! See eventfd(2)
+[[nodiscard]] inline expected<fd>
+eventfd(unsigned initval, eventfdflags flags) noexcept
+{
+   return error_cascade(
+        ::syscalls::linux::eventfd2(initval,
+                                    static_cast<int>(flags.getbits())),
+        [](auto fdint) { return fd{static_cast<int>(fdint)}; }
+   );
+}
+
+/**
+ * \brief Take the counter's value, setting it to zero (or take 1, for
+ * `eventfdflags::semaphore`).
+ *
+ * Blocks while the counter is zero, unless the eventfd is non-blocking, in
+ * which case that's `EAGAIN`.
+ */
+[[nodiscard]] inline expected<::std::uint64_t>
+eventfd_read(fd const &efd) noexcept
+{
+   char buf[sizeof(::std::uint64_t)];
+   auto const got = read(efd, buf, sizeof(buf));
+   if (got.has_error()) {
+      return expected<::std::uint64_t>{
+           expected<::std::uint64_t>::err_tag{}, got.error()
+      };
+   }
+   ::std::uint64_t value;
+   ::std::memcpy(&value, buf, sizeof(value));
+   return expected<::std::uint64_t>{value};
+}
+
+//! Add `value` to the counter, making the eventfd readable.
+inline expected<void> eventfd_write(fd const &efd, ::std::uint64_t value) noexcept
+{
+   char buf[sizeof(value)];
+   ::std::memcpy(buf, &value, sizeof(value));
+   return error_cascade_void(write(efd, buf, sizeof(buf)));
+}
+
+} // namespace posixpp
@@ -1,9 +1,14 @@
 #pragma once // -*- c++ -*-
 
 #include <system_error>
+#include <atomic>
 #include <utility>
 #include <stdexcept>
 #include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
 
 namespace posixpp {
 
@@ -43,8 +48,254 @@ class no_error_here : public ::std::exception
    char const *reason_ = "no error in expected when error requested";
 };
 
+/**
+ * \name Error handling policy.
+ *
+ * Asking an `expected` for a result it doesn't have (or an error it doesn't
+ * have) normally throws `::std::system_error` (or `no_error_here`). If
+ * `POSIXPP_NO_EXCEPTIONS` is defined, or exceptions are turned off (as with
+ * `-fno-exceptions`), the error handler is called instead, with the error
+ * number, or 0 for a missing error. It must not return, and if it does the
+ * program is stopped with `__builtin_trap`, which is also what the default
+ * handler does. Not needing libc or the C++ runtime for this is the point.
+ *
+ * Either way it happens in an out of line function marked cold, so the code
+ * inlined everywhere an `expected` is used is just a test and a branch.
+ *
+ * Every translation unit in a program has to make the same choice.
+ */
+//! @{
+#if !defined(POSIXPP_NO_EXCEPTIONS) && !defined(__cpp_exceptions)
+#define POSIXPP_NO_EXCEPTIONS 1
+#endif
+
+//! Must not return. Must be safe to call from any thread.
+using error_handler_t = void (*)(int errcode) noexcept;
 
-//! A value that may be an error, throws if accessed and is an error.
+namespace priv_ {
+[[noreturn]] inline void default_error_handler(int) noexcept
+{
+   __builtin_trap();
+}
+
+inline constinit ::std::atomic<error_handler_t> error_handler{
+     default_error_handler
+};
+} // namespace priv_
+
+//! Install `handler`, returning the one it replaces.
+inline error_handler_t set_error_handler(error_handler_t handler) noexcept
+{
+   return priv_::error_handler.exchange(handler, ::std::memory_order_acq_rel);
+}
+
+namespace priv_ {
+[[noreturn, gnu::cold, gnu::noinline]] inline void raise_error(int ec)
+{
+#ifdef POSIXPP_NO_EXCEPTIONS
+   error_handler.load(::std::memory_order_acquire)(ec);
+   __builtin_trap();
+#else
+   throw ::std::system_error(ec, ::std::system_category());
+#endif
+}
+
+[[noreturn, gnu::cold, gnu::noinline]] inline void raise_no_error()
+{
+#ifdef POSIXPP_NO_EXCEPTIONS
+   error_handler.load(::std::memory_order_acquire)(0);
+   __builtin_trap();
+#else
+   throw no_error_here{};
+#endif
+}
+} // namespace priv_
+//! @}
+
+
+/**
+ * \brief Says how to keep an error inside a `T` so that `expected<T>` can be
+ * just a `T`.
+ *
+ * Specialize this for types that have values that can never be valid
+ * results, and so can be used to store an error number. This changes what
+ * every `expected<T>` means, so only do it for a type made for the purpose,
+ * like the system call layer's `syscall_val`, never for a type like `int64_t`
+ * that's used for all sorts of things. Such a specialization has `enabled`
+ * set to true and these `noexcept` static member functions, `constexpr` if
+ * `T` is a literal type:
+ *
+ * - `T from_error(int ec)` a `T` holding the error `ec`, from 1 to 4095.
+ * - `bool is_error(T const &)` whether a `T` holds an error.
+ * - `int to_error(T const &)` the error a `T` holds.
+ *
+ * Without one `expected<T>` is a union of a `T` and an `int`, plus a `bool`.
+ */
+template <typename T>
+struct expected_niche {
+   static constexpr bool enabled = false;
+};
+
+namespace priv_ {
+
+template <typename T>
+concept niche_storable = expected_niche<T>::enabled;
+
+//! A `T` or an error number, stored the long way around.
+template <typename T>
+class expected_storage {
+ public:
+   explicit constexpr expected_storage(T const &val)
+           : val_{val}, has_error_{false}
+   {}
+   explicit constexpr expected_storage(T &&val)
+           : val_{::std::move(val)}, has_error_{false}
+   {}
+   explicit constexpr expected_storage(expected_base::err_tag const &, int ec)
+           noexcept
+           : val_{.errcode_ = ec}, has_error_{true}
+   {}
+
+   constexpr expected_storage(expected_storage const &)
+   requires ::std::copyable<T> && ::std::is_trivially_copy_constructible_v<T>
+           = default;
+   constexpr expected_storage(expected_storage const &other)
+   noexcept(::std::is_nothrow_copy_constructible_v<T>)
+   requires ::std::copyable<T>
+           : val_{.errcode_ = other.has_error_ ? other.val_.errcode_ : 0},
+             has_error_{other.has_error_}
+   {
+      if (!has_error_) {
+         ::std::construct_at(&val_.value_, other.val_.value_);
+      }
+   }
+   constexpr expected_storage(expected_storage &&)
+   requires ::std::movable<T> && ::std::is_trivially_move_constructible_v<T>
+           = default;
+   constexpr expected_storage(expected_storage &&other)
+   noexcept(::std::is_nothrow_move_constructible_v<T>)
+   requires ::std::movable<T>
+           : val_{.errcode_ = other.has_error_ ? other.val_.errcode_ : 0},
+             has_error_{other.has_error_}
+   {
+      if (!has_error_) {
+         ::std::construct_at(&val_.value_, ::std::move(other.val_.value_));
+      }
+   }
+
+   constexpr expected_storage &operator =(expected_storage const &)
+   requires ::std::copyable<T> && ::std::is_trivially_copyable_v<T>
+           = default;
+   constexpr expected_storage &operator =(expected_storage const &other)
+   requires ::std::copyable<T>
+   {
+      if (this != &other) {
+         destroy();
+         has_error_ = other.has_error_;
+         if (has_error_) {
+            val_.errcode_ = other.val_.errcode_;
+         } else {
+            ::std::construct_at(&val_.value_, other.val_.value_);
+         }
+      }
+      return *this;
+   }
+   constexpr expected_storage &operator =(expected_storage &&)
+   requires ::std::movable<T> && ::std::is_trivially_copyable_v<T>
+           = default;
+   constexpr expected_storage &operator =(expected_storage &&other)
+   noexcept(::std::is_nothrow_move_constructible_v<T>)
+   requires ::std::movable<T>
+   {
+      if (this != &other) {
+         destroy();
+         has_error_ = other.has_error_;
+         if (has_error_) {
+            val_.errcode_ = other.val_.errcode_;
+         } else {
+            ::std::construct_at(&val_.value_, ::std::move(other.val_.value_));
+         }
+      }
+      return *this;
+   }
+
+   constexpr ~expected_storage()
+   requires ::std::is_trivially_destructible_v<T> = default;
+   constexpr ~expected_storage() noexcept { destroy(); }
+
+   [[nodiscard]] constexpr bool has_error() const noexcept {
+      return has_error_;
+   }
+   //! Only valid if `has_error()`.
+   [[nodiscard]] constexpr int errcode() const noexcept {
+      return val_.errcode_;
+   }
+   //! Only valid if `!has_error()`.
+   [[nodiscard]] constexpr T &value() noexcept { return val_.value_; }
+   [[nodiscard]] constexpr T const &value() const noexcept {
+      return val_.value_;
+   }
+
+ private:
+   constexpr void destroy() noexcept {
+      if (!has_error_) {
+         val_.value_.~T();
+      }
+   }
+
+   union anonymous {
+      T value_;
+      int errcode_;
+
+      constexpr ~anonymous()
+      requires ::std::is_trivially_destructible_v<T> = default;
+      constexpr ~anonymous() {} // Destruction handled by expected_storage<T>
+   } val_;
+   bool has_error_;
+};
+
+//! A `T` that may hold an error number in place of a value.
+template <niche_storable T>
+class expected_storage<T> {
+ public:
+   using niche = expected_niche<T>;
+
+   explicit constexpr expected_storage(T const &val) : val_{val} {}
+   explicit constexpr expected_storage(T &&val) : val_{::std::move(val)} {}
+   explicit constexpr expected_storage(expected_base::err_tag const &, int ec)
+           noexcept
+           : val_{niche::from_error(ec)}
+   {
+#ifndef NDEBUG
+      // Anything else could read back as a value, or as a different error.
+      // Not `assert`, this has to work without libc.
+      if (ec <= 0 || ec >= 4096) {
+         __builtin_trap();
+      }
+#endif
+   }
+
+   [[nodiscard]] constexpr bool has_error() const noexcept {
+      return niche::is_error(val_);
+   }
+   [[nodiscard]] constexpr int errcode() const noexcept {
+      return niche::to_error(val_);
+   }
+   [[nodiscard]] constexpr T &value() noexcept { return val_; }
+   [[nodiscard]] constexpr T const &value() const noexcept { return val_; }
+
+ private:
+   T val_;
+};
+
+} // namespace priv_
+
+/**
+ * \brief A value that may be an error, throws if accessed and is an error.
+ *
+ * If there's an `expected_niche<T>` this is the same size as a `T`, and for
+ * trivial types it's trivially copyable too, so it's returned in a register.
+ */
 template <typename T>
 class expected : private priv_::expected_base {
  public:
@@ -53,55 +304,47 @@ class expected : private priv_::expected_base {
    using result_t = T;
 
    explicit constexpr expected(T const &val) noexcept requires ::std::copyable<T>
-           : val_{val}, has_error_{false}
+           : val_{val}
    {}
    explicit constexpr expected(T &&val) noexcept requires ::std::movable<T>
-           : val_{::std::move(val)}, has_error_{false}
+           : val_{::std::move(val)}
    {}
-   explicit constexpr expected(err_tag const &, int ec) noexcept
+   explicit constexpr expected(err_tag const &tag, int ec) noexcept
    requires ::std::movable<T> || ::std::copyable<T>
-           : val_{.errcode_ = ec}, has_error_{true}
+           : val_{tag, ec}
    {}
-   constexpr ~expected() noexcept {
-      if (!has_error_) {
-         val_.value_.~T();
-      }
-   }
 
    [[nodiscard]] constexpr T &&result() requires ::std::movable<T> {
-      if (!has_error_) {
-         return ::std::move(val_.value_);
+      if (!val_.has_error()) {
+         return ::std::move(val_.value());
       } else {
-         auto const &cat = ::std::system_category();
-         throw ::std::system_error(val_.errcode_, cat);
+         priv_::raise_error(val_.errcode());
       }
    }
 
    [[nodiscard]] constexpr T const &result() const requires ::std::copyable<T> {
-      if (!has_error_) {
-         return val_.value_;
+      if (!val_.has_error()) {
+         return val_.value();
       } else {
-         auto const &cat = ::std::system_category();
-         throw ::std::system_error(val_.errcode_, cat);
+         priv_::raise_error(val_.errcode());
       }
    }
 
    void throw_if_error() const {
-      if (has_error_) {
-         auto const &cat = ::std::system_category();
-         throw ::std::system_error(val_.errcode_, cat);
+      if (val_.has_error()) {
+         priv_::raise_error(val_.errcode());
       }
    }
 
    [[nodiscard]] constexpr bool has_error() const noexcept {
-      return has_error_;
+      return val_.has_error();
    }
 
    [[nodiscard]] constexpr int error() const {
-      if (has_error_) {
-         return val_.errcode_;
+      if (val_.has_error()) {
+         return val_.errcode();
       } else {
-         throw no_error_here{};
+         priv_::raise_no_error();
       }
    }
 
@@ -110,13 +353,7 @@ class expected : private priv_::expected_base {
    }
 
  private:
-   union anonymous {
-      T value_;
-      int errcode_;
-
-      constexpr ~anonymous() {} // Destruction handled by expected<T>
-   } val_;
-   bool has_error_;
+   priv_::expected_storage<T> val_;
 };
 
 //! A value that may be an error, throws if accessed and is an error.
@@ -137,8 +374,7 @@ class expected<void> : private priv_::expected_base {
 
    constexpr void throw_if_error() const {
       if (errcode_ != 0) {
-         auto const &cat = ::std::system_category();
-         throw ::std::system_error(errcode_, cat);
+         priv_::raise_error(errcode_);
       }
    }
 
@@ -147,10 +383,10 @@ class expected<void> : private priv_::expected_base {
    }
 
    [[nodiscard]] constexpr int error() const {
-      if (errcode_ == 0) {
+      if (errcode_ != 0) {
          return errcode_;
       } else {
-         throw no_error_here{};
+         priv_::raise_no_error();
       }
    }
 
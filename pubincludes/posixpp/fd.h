@@ -53,6 +53,14 @@ class fd {
       return close(tmpfd);
    }
 
+   //! \brief Sets fd to invalid value without closing it, and returns the
+   //! number it had, which the caller is now responsible for closing.
+   [[nodiscard]] constexpr int release() noexcept {
+      int const tmpfd = fd_;
+      fd_ = -1;
+      return tmpfd;
+   }
+
    //! A true return value is maybe, a false return is definite.
    [[nodiscard]] constexpr bool is_valid() const noexcept {
       return fd_ >= 0;
@@ -141,23 +149,45 @@ class fd {
    [[nodiscard]] expected<fd>
            dup_to_unused(unsigned int minval, bool cloexec=false) const noexcept
    {
-      // TODO: Fix hardcoded F_DUPFD and F_DUPFD_CLOEXEC values.
-      static constexpr int F_DUPFD = 0;
-      static constexpr int F_DUPFD_CLOEXEC = 1030;
       using ::syscalls::linux::fcntl;
+      using ::syscalls::linux::fcntl_cmd;
       void * const arg = reinterpret_cast<void *>(minval);
       if (!cloexec) {
          return error_cascade(
-                 fcntl(fd_, F_DUPFD, arg), int_to_fd
+                 fcntl(fd_, fcntl_cmd::dupfd, arg), int_to_fd
          );
       } else {
          return error_cascade(
-                 fcntl(fd_, F_DUPFD_CLOEXEC, arg), int_to_fd
+                 fcntl(fd_, fcntl_cmd::dupfd_cloexec, arg), int_to_fd
          );
       }
    }
    //! @}
 
+   //! See man page fcntl(2), the section on F_GETFL.
+   [[nodiscard]] expected<fdflags> get_status_flags() const noexcept {
+      using ::syscalls::linux::fcntl;
+      using ::syscalls::linux::fcntl_cmd;
+      return error_cascade(
+              fcntl(fd_, fcntl_cmd::getfl, nullptr),
+              [](auto bits) { return fdflags::create_from_int(bits); }
+      );
+   }
+
+   /**
+    * \brief See man page fcntl(2), the section on F_SETFL.
+    *
+    * Only `fdflags::append`, `fdflags::async`, `fdflags::direct`,
+    * `fdflags::noatime` and `fdflags::nonblock` can be changed, the others are
+    * ignored.
+    */
+   [[nodiscard]] expected<void> set_status_flags(fdflags flags) const noexcept {
+      using ::syscalls::linux::fcntl;
+      using ::syscalls::linux::fcntl_cmd;
+      void * const arg = reinterpret_cast<void *>(flags.getbits());
+      return error_cascade_void(fcntl(fd_, fcntl_cmd::setfl, arg));
+   }
+
  protected:
    static fd int_to_fd(int fdes) noexcept {
       return fd{fdes};
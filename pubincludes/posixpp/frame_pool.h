@@ -0,0 +1,84 @@
+// Copyright 2021 Eric Hopper
+// Distributed under the terms of the LGPLv3.
+
+#pragma once  /*-*-c++-*-*/
+
+#include <cstddef>
+#include <new>
+#include <utility>
+
+namespace posixpp {
+
+/**
+ * \brief Recycles coroutine frames so a steady stream of coroutines doesn't
+ * allocate.
+ *
+ * Frames are rounded up to a multiple of `granularity`, and freed frames are
+ * kept on a list per size, to be handed out again to the next coroutine that
+ * needs that size. Only when a list is empty does the pool ask `::operator
+ * new` for memory. Frames bigger than `max_pooled` aren't kept.
+ *
+ * A pool isn't thread safe. It's meant for all the coroutines run by one
+ * event loop, which all run on the same thread. It must outlive every frame
+ * allocated from it.
+ */
+class frame_pool {
+ public:
+   static constexpr ::std::size_t granularity = 64;
+   static constexpr ::std::size_t max_pooled = 4096;
+
+   frame_pool() noexcept = default;
+   frame_pool(frame_pool const &) = delete;
+   frame_pool &operator =(frame_pool const &) = delete;
+
+   ~frame_pool() {
+      for (free_block *&list : free_) {
+         while (list != nullptr) {
+            free_block *const next = list->next;
+            ::operator delete(static_cast<void *>(list));
+            list = next;
+         }
+      }
+   }
+
+   [[nodiscard]] void *allocate(::std::size_t size) {
+      if (size <= max_pooled) {
+         free_block *&list = free_[size_class(size)];
+         if (list != nullptr) {
+            return ::std::exchange(list, list->next);
+         }
+         size = (size_class(size) + 1) * granularity;
+      }
+      ++upstream_allocations_;
+      return ::operator new(size);
+   }
+
+   //! `size` must be the same as was passed to `allocate`.
+   void deallocate(void *block, ::std::size_t size) noexcept {
+      if (size <= max_pooled) {
+         free_block *&list = free_[size_class(size)];
+         list = ::new (block) free_block{list};
+      } else {
+         ::operator delete(block);
+      }
+   }
+
+   //! How many times the pool has had to ask `::operator new` for memory.
+   [[nodiscard]] ::std::size_t upstream_allocations() const noexcept {
+      return upstream_allocations_;
+   }
+
+ private:
+   struct free_block {
+      free_block *next;
+   };
+
+   static constexpr ::std::size_t size_class(::std::size_t size) noexcept {
+      return size == 0 ? 0 : (size - 1) / granularity;
+   }
+
+   free_block *free_[max_pooled / granularity] = {};
+   ::std::size_t upstream_allocations_ = 0;
+};
+
+} // namespace posixpp
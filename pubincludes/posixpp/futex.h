@@ -0,0 +1,199 @@
+// Copyright 2021 Eric Hopper
+// Distributed under the terms of the LGPLv3.
+
+#pragma once  /*-*-c++-*-*/
+
+#include <posixpp/expected.h>
+#include <syscalls/linux/futex.h>
+#include <syscalls/linux/time.h>
+#include <atomic>
+#include <cstdint>
+#include <span>
+#include <system_error>
+#include <type_traits>
+
+namespace posixpp {
+
+//! The type of word the kernel can wait on.
+using futex_word = ::std::atomic<::std::uint32_t>;
+
+static_assert(sizeof(futex_word) == sizeof(::std::uint32_t));
+static_assert(futex_word::is_always_lock_free);
+
+namespace priv_ {
+inline ::std::uint32_t *futex_addr(futex_word &word) noexcept
+{
+   return reinterpret_cast<::std::uint32_t *>(&word);
+}
+
+//! Whether a wait failed for a reason other than `EAGAIN` or `EINTR`, both
+//! of which just mean the waiter should look again.
+inline bool is_real_wait_error(expected<void> const &result) noexcept
+{
+   using ::std::errc;
+   int const ec = result.has_error() ? result.error() : 0;
+   return ec != 0
+          && ec != static_cast<int>(errc::resource_unavailable_try_again)
+          && ec != static_cast<int>(errc::interrupted);
+}
+} // namespace priv_
+
+/**
+ * \brief Sleep until woken, but only if `word` still contains `val`.
+ *
+ * See FUTEX_WAIT in futex(2). Getting `EAGAIN` (`word` didn't contain `val`)
+ * or `EINTR` is normal, and callers should re-check whatever condition they
+ * were waiting for.
+ *
+ * @param process_private Must match what the waker uses. Only set this to
+ * false if `word` might be woken from another process, or by the kernel
+ * itself (like the `CLONE_CHILD_CLEARTID` word).
+ */
+inline expected<void>
+futex_wait(futex_word &word, ::std::uint32_t val,
+           bool process_private = true) noexcept
+{
+   using ::syscalls::linux::futex_op;
+   return error_cascade_void(
+        ::syscalls::linux::futex(priv_::futex_addr(word), futex_op::wait,
+                                 process_private, val, nullptr, nullptr, 0)
+   );
+}
+
+/**
+ * \brief Like `futex_wait`, but gives up with `ETIMEDOUT` at `deadline`.
+ *
+ * `deadline` is an absolute `CLOCK_MONOTONIC` time, handed straight to the
+ * kernel (via FUTEX_WAIT_BITSET), so a loop that waits repeatedly for the same
+ * deadline never needs to read the clock.
+ */
+inline expected<void>
+futex_wait_until(futex_word &word, ::std::uint32_t val,
+                 ::syscalls::linux::timespec const &deadline,
+                 bool process_private = true) noexcept
+{
+   using ::syscalls::linux::futex_op;
+   using ::syscalls::linux::futex_bitset_match_any;
+   return error_cascade_void(
+        ::syscalls::linux::futex(priv_::futex_addr(word),
+                                 futex_op::wait_bitset, process_private,
+                                 val, &deadline, nullptr,
+                                 futex_bitset_match_any)
+   );
+}
+
+//! Wake up to `count` waiters on `word`, returns how many were woken.
+inline expected<int>
+futex_wake(futex_word &word, int count, bool process_private = true) noexcept
+{
+   using ::syscalls::linux::futex_op;
+   return error_cascade(
+        ::syscalls::linux::futex(priv_::futex_addr(word), futex_op::wake,
+                                 process_private,
+                                 static_cast<::std::uint32_t>(count),
+                                 nullptr, nullptr, 0),
+        [](auto r) { return static_cast<int>(r); }
+   );
+}
+
+/**
+ * \brief Wake up to `nwake` waiters on `word` and move up to `nrequeue` more
+ * to wait on `target` instead.
+ *
+ * See FUTEX_CMP_REQUEUE in futex(2). Nothing happens, and the result is
+ * `EAGAIN`, if `word` doesn't contain `val`.
+ *
+ * @return The number of waiters woken or moved.
+ */
+inline expected<int>
+futex_cmp_requeue(futex_word &word, ::std::uint32_t val,
+                  int nwake, int nrequeue, futex_word &target,
+                  bool process_private = true) noexcept
+{
+   using ::syscalls::linux::futex_op;
+   // The number to requeue goes where the timeout normally would.
+   void const *const val2 =
+        reinterpret_cast<void const *>(static_cast<::std::uintptr_t>(nrequeue));
+   return error_cascade(
+        ::syscalls::linux::futex(priv_::futex_addr(word),
+                                 futex_op::cmp_requeue, process_private,
+                                 static_cast<::std::uint32_t>(nwake), val2,
+                                 priv_::futex_addr(target), val),
+        [](auto r) { return static_cast<int>(r); }
+   );
+}
+
+/**
+ * \brief One of the words `wait_any` waits on, and the value it has to still
+ * contain for the wait to start.
+ *
+ * This is laid out exactly like the kernel's `struct futex_waitv`, so a span
+ * of them is handed straight to futex_waitv(2).
+ */
+class futex_waiter {
+ public:
+   //! `process_private` has to match what the waker uses, as for `futex_wait`.
+   futex_waiter(futex_word &word, ::std::uint32_t val,
+                bool process_private = true) noexcept
+        : entry_{val,
+                 reinterpret_cast<::std::uintptr_t>(priv_::futex_addr(word)),
+                 ::syscalls::linux::futex2_size_u32
+                 | (process_private ? ::syscalls::linux::futex2_private : 0),
+                 0}
+   {}
+
+ private:
+   ::syscalls::linux::futex_waitv_entry entry_;
+};
+
+static_assert(sizeof(futex_waiter)
+              == sizeof(::syscalls::linux::futex_waitv_entry));
+static_assert(::std::is_standard_layout_v<futex_waiter>);
+
+namespace priv_ {
+inline expected<unsigned>
+futex_waitv(::std::span<futex_waiter> waiters,
+            ::syscalls::linux::timespec const *deadline) noexcept
+{
+   namespace sl = ::syscalls::linux;
+   return error_cascade(
+        sl::futex_waitv(reinterpret_cast<sl::futex_waitv_entry *>(waiters.data()),
+                        static_cast<unsigned>(waiters.size()),
+                        deadline, sl::clockid::monotonic),
+        [](auto r) { return static_cast<unsigned>(r); }
+   );
+}
+} // namespace priv_
+
+/**
+ * \brief Sleep until any of several futex words is woken, as long as they
+ * all still contain what `waiters` says they should.
+ *
+ * This lets one thread wait for whichever of several things happens first,
+ * like a queue becoming non-empty or a shutdown flag being set, without
+ * polling. Wakers just use `futex_wake` as usual. See futex_waitv(2), which
+ * needs Linux 5.16, and takes at most
+ * `::syscalls::linux::futex_waitv_max` words.
+ *
+ * @return The index in `waiters` of the word that was woken. As with
+ * `futex_wait`, getting `EAGAIN` (one of the words had changed already) or
+ * `EINTR` is normal, and callers should re-check whatever they were waiting
+ * for.
+ */
+inline expected<unsigned> wait_any(::std::span<futex_waiter> waiters) noexcept
+{
+   return priv_::futex_waitv(waiters, nullptr);
+}
+
+/**
+ * \brief Like `wait_any`, but gives up with `ETIMEDOUT` at `deadline`, an
+ * absolute `CLOCK_MONOTONIC` time.
+ */
+inline expected<unsigned>
+wait_any_until(::std::span<futex_waiter> waiters,
+               ::syscalls::linux::timespec const &deadline) noexcept
+{
+   return priv_::futex_waitv(waiters, &deadline);
+}
+
+} // namespace posixpp
@@ -0,0 +1,420 @@
+// Copyright 2021 Eric Hopper
+// Distributed under the terms of the LGPLv3.
+
+#pragma once  /*-*-c++-*-*/
+
+#include <posixpp/mmapflags.h>
+#include <posixpp/mutex.h>
+#include <syscalls/linux/memory.h>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <utility>
+
+/**
+ * \file
+ * \brief A general purpose allocator that needs nothing but system calls.
+ *
+ * Small requests (up to `max_small_size`) are rounded up to one of
+ * `num_size_classes` sizes. Each thread keeps a short free list per size
+ * class, so most allocations and frees just push or pop a list without any
+ * atomic operations. When a thread's list runs dry it takes a batch of
+ * objects from that class's central free list, and when it gets too long it
+ * hands a batch back. The central lists carve new objects out of `slab_size`
+ * slabs mapped with `mmap`. Anything bigger gets its own mapping, which is
+ * unmapped as soon as it's freed.
+ *
+ * Every slab and every big block starts on a `slab_size` boundary with a
+ * header saying what it holds, so `deallocate` doesn't need to be told the
+ * size.
+ *
+ * The per-thread lists are `thread_local`, so every thread that uses this
+ * needs a thread control block, which glibc threads and `posixpp::thread`
+ * both have. A thread's list is capped at a couple of batches per size class,
+ * but memory left in it when the thread exits is never reused, so threads
+ * should call `flush_thread_cache` before they finish. Slabs are never given
+ * back to the kernel.
+ *
+ * Link the `posixpp_new` library to make this what `operator new` and
+ * `operator delete` use.
+ */
+
+namespace posixpp::heap {
+
+//! Slabs and big blocks are this size and alignment.
+inline constexpr ::std::size_t slab_size = 256 * 1024;
+//! The biggest request that's given a slot in a slab.
+inline constexpr ::std::size_t max_small_size = 32 * 1024;
+//! What everything is aligned to unless more is asked for.
+inline constexpr ::std::size_t min_align = 16;
+//! Every 16 bytes up to 256, then 4 steps per doubling up to 32K.
+inline constexpr unsigned num_size_classes = 16 + 4 * 7;
+
+//! The size of the objects in size class `idx`.
+[[nodiscard]] constexpr ::std::size_t class_size(unsigned idx) noexcept
+{
+   if (idx < 16) {
+      return (idx + 1) * 16;
+   }
+   ::std::size_t const base = ::std::size_t{256} << ((idx - 16) / 4);
+   return base + ((idx - 16) % 4 + 1) * (base / 4);
+}
+
+//! The smallest size class that holds `size` bytes, which must be at most
+//! `max_small_size`.
+[[nodiscard]] constexpr unsigned size_class_of(::std::size_t size) noexcept
+{
+   if (size <= 256) {
+      return size == 0 ? 0 : static_cast<unsigned>((size + 15) / 16 - 1);
+   }
+   unsigned const doubling = ::std::bit_width(size - 1) - 9;
+   ::std::size_t const base = ::std::size_t{256} << doubling;
+   ::std::size_t const step = base / 4;
+   return 16 + doubling * 4
+          + static_cast<unsigned>((size - base + step - 1) / step) - 1;
+}
+
+//! What's been counted for one size class.
+struct size_class_stats {
+   //! The size every object in the class is given.
+   ::std::size_t object_size;
+   //! Slabs mapped for this class.
+   ::std::uint64_t slabs;
+   ::std::uint64_t allocations;
+   ::std::uint64_t deallocations;
+   //! Objects on the central free list, not counting the thread caches.
+   ::std::uint64_t central_free;
+};
+
+//! What's been counted for blocks too big for a size class.
+struct large_stats {
+   ::std::uint64_t allocations;
+   ::std::uint64_t deallocations;
+   //! Bytes currently mapped for big blocks.
+   ::std::uint64_t bytes_mapped;
+};
+
+namespace priv_ {
+
+struct free_object {
+   free_object *next;
+};
+
+//! The start of every slab and big block.
+struct alignas(64) slab_header {
+   //! `large_class` for a big block.
+   unsigned size_class;
+   //! Size of the whole mapping, only for big blocks.
+   ::std::size_t mapped_size;
+};
+inline constexpr unsigned large_class = ~0U;
+
+[[nodiscard]] inline slab_header *header_of(void *ptr) noexcept
+{
+   auto const addr = reinterpret_cast<::std::uintptr_t>(ptr);
+   return reinterpret_cast<slab_header *>(addr & ~(slab_size - 1));
+}
+
+//! How many objects move between a thread cache and the central list at once.
+[[nodiscard]] constexpr unsigned batch_size(unsigned idx) noexcept
+{
+   ::std::size_t const n = max_small_size / class_size(idx);
+   return n < 2 ? 2 : n > 32 ? 32 : static_cast<unsigned>(n);
+}
+
+//! One size class's shared state, on its own cache line.
+struct alignas(64) central_list {
+   mutex lock;
+   free_object *free = nullptr;
+   ::std::uint64_t nfree = 0;
+   //! Never-used space in the newest slab.
+   char *bump = nullptr;
+   char *bump_end = nullptr;
+   ::std::uint64_t slabs = 0;
+   ::std::uint64_t allocations = 0;
+   ::std::uint64_t deallocations = 0;
+};
+inline constinit central_list central[num_size_classes];
+
+inline constinit ::std::atomic<::std::uint64_t> large_allocations = 0;
+inline constinit ::std::atomic<::std::uint64_t> large_deallocations = 0;
+inline constinit ::std::atomic<::std::uint64_t> large_bytes = 0;
+
+struct thread_list {
+   free_object *head;
+   unsigned count;
+   //! Counted here and added to the central counts when they're next locked.
+   ::std::uint64_t allocations;
+   ::std::uint64_t deallocations;
+};
+struct thread_cache {
+   thread_list lists[num_size_classes];
+};
+inline constinit thread_local thread_cache cache{};
+
+/**
+ * \brief Map `size` bytes (a multiple of the page size) starting on a
+ * `slab_size` boundary, or return `nullptr`.
+ *
+ * This maps `slab_size` extra and unmaps what's left over on either side.
+ */
+[[nodiscard]] inline char *map_aligned(::std::size_t size) noexcept
+{
+   namespace sl = ::syscalls::linux;
+   auto const prot = protflags::read | protflags::write;
+   auto const flags = mapflags::private_ | mapflags::anonymous;
+   auto const mapped = sl::mmap(nullptr, size + slab_size,
+                                prot.getbits(), flags.getbits(), -1, 0);
+   if (mapped.has_error()) {
+      return nullptr;
+   }
+   auto *const raw = reinterpret_cast<char *>(mapped.result().val);
+   auto const raw_addr = reinterpret_cast<::std::uintptr_t>(raw);
+   auto *const aligned = reinterpret_cast<char *>(
+        (raw_addr + slab_size - 1) & ~(slab_size - 1)
+   );
+   char *const tail = aligned + size;
+   char *const raw_end = raw + size + slab_size;
+   if (aligned != raw) {
+      static_cast<void>(
+           sl::munmap(raw, static_cast<::std::size_t>(aligned - raw))
+      );
+   }
+   if (raw_end != tail) {
+      static_cast<void>(
+           sl::munmap(tail, static_cast<::std::size_t>(raw_end - tail))
+      );
+   }
+   return aligned;
+}
+
+//! Get a batch of objects from the central list onto `list`.
+[[gnu::noinline]] inline bool refill(unsigned idx, thread_list &list) noexcept
+{
+   central_list &c = central[idx];
+   ::std::size_t const size = class_size(idx);
+   unsigned const want = batch_size(idx);
+   ::std::lock_guard<mutex> lock{c.lock};
+   c.allocations += ::std::exchange(list.allocations, 0);
+   c.deallocations += ::std::exchange(list.deallocations, 0);
+   unsigned got = 0;
+   for (; got < want && c.free != nullptr; ++got) {
+      free_object *const obj = c.free;
+      c.free = obj->next;
+      obj->next = list.head;
+      list.head = obj;
+   }
+   c.nfree -= got;
+   for (; got < want; ++got) {
+      if (static_cast<::std::size_t>(c.bump_end - c.bump) < size) {
+         char *const slab = map_aligned(slab_size);
+         if (slab == nullptr) {
+            break;
+         }
+         ::new (slab) slab_header{idx, slab_size};
+         c.bump = slab + sizeof(slab_header);
+         c.bump_end = slab + slab_size;
+         ++c.slabs;
+      }
+      auto *const obj = reinterpret_cast<free_object *>(c.bump);
+      c.bump += size;
+      obj->next = list.head;
+      list.head = obj;
+   }
+   list.count += got;
+   return got > 0;
+}
+
+//! Hand `n` objects from `list` back to the central list.
+[[gnu::noinline]] inline void
+drain(unsigned idx, thread_list &list, unsigned n) noexcept
+{
+   central_list &c = central[idx];
+   ::std::lock_guard<mutex> lock{c.lock};
+   c.allocations += ::std::exchange(list.allocations, 0);
+   c.deallocations += ::std::exchange(list.deallocations, 0);
+   for (unsigned i = 0; i < n && list.head != nullptr; ++i) {
+      free_object *const obj = list.head;
+      list.head = obj->next;
+      --list.count;
+      obj->next = c.free;
+      c.free = obj;
+      ++c.nfree;
+   }
+}
+
+[[gnu::noinline]] inline void *allocate_from_central(unsigned idx) noexcept
+{
+   thread_list &list = cache.lists[idx];
+   if (!refill(idx, list)) {
+      return nullptr;
+   }
+   free_object *const obj = list.head;
+   list.head = obj->next;
+   --list.count;
+   ++list.allocations;
+   return obj;
+}
+
+//! An object from size class `idx`, from this thread's cache if it can.
+inline void *allocate_small(unsigned idx) noexcept
+{
+   thread_list &list = cache.lists[idx];
+   free_object *const obj = list.head;
+   if (obj == nullptr) [[unlikely]] {
+      return allocate_from_central(idx);
+   }
+   list.head = obj->next;
+   --list.count;
+   ++list.allocations;
+   return obj;
+}
+
+//! Give a block its own mapping, with `offset` bytes before it for the header.
+[[gnu::noinline]] inline void *
+allocate_large(::std::size_t size, ::std::size_t offset) noexcept
+{
+   constexpr ::std::size_t page = 4096;
+   if (size > ~::std::size_t{0} - offset - slab_size - page) {
+      return nullptr;
+   }
+   ::std::size_t const mapped_size = (offset + size + page - 1) & ~(page - 1);
+   char *const base = map_aligned(mapped_size);
+   if (base == nullptr) {
+      return nullptr;
+   }
+   ::new (base) slab_header{large_class, mapped_size};
+   large_allocations.fetch_add(1, ::std::memory_order_relaxed);
+   large_bytes.fetch_add(mapped_size, ::std::memory_order_relaxed);
+   return base + offset;
+}
+
+[[gnu::noinline]] inline void deallocate_large(slab_header *header) noexcept
+{
+   ::std::size_t const mapped_size = header->mapped_size;
+   large_deallocations.fetch_add(1, ::std::memory_order_relaxed);
+   large_bytes.fetch_sub(mapped_size, ::std::memory_order_relaxed);
+   static_cast<void>(::syscalls::linux::munmap(header, mapped_size));
+}
+
+//! Anything with more than the minimum alignment.
+[[gnu::noinline]] inline void *
+allocate_aligned(::std::size_t size, ::std::size_t align) noexcept
+{
+   // Slab objects start 64 bytes into a slab, so a size class that's a
+   // multiple of the alignment keeps every object aligned.
+   if (size <= max_small_size && align <= sizeof(slab_header)) {
+      for (unsigned idx = size_class_of(size); idx < num_size_classes; ++idx) {
+         if (class_size(idx) % align == 0) {
+            return allocate_small(idx);
+         }
+      }
+   }
+   if (align >= slab_size) {
+      return nullptr;
+   }
+   return allocate_large(size, align > sizeof(slab_header)
+                               ? align : sizeof(slab_header));
+}
+
+} // namespace priv_
+
+/**
+ * \brief At least `size` bytes aligned to `align`, which must be a power of
+ * two less than `slab_size`. Returns `nullptr` if the kernel won't provide
+ * the memory.
+ *
+ * A `size` of 0 gets a unique minimum sized object, as `operator new` needs.
+ */
+[[nodiscard]] inline void *
+allocate(::std::size_t size, ::std::size_t align = min_align) noexcept
+{
+   if (size <= max_small_size && align <= min_align) [[likely]] {
+      return priv_::allocate_small(size_class_of(size));
+   }
+   if (align <= min_align) {
+      return priv_::allocate_large(size, sizeof(priv_::slab_header));
+   }
+   return priv_::allocate_aligned(size, align);
+}
+
+//! Free something from `allocate`, from any thread. `nullptr` is ignored.
+inline void deallocate(void *ptr) noexcept
+{
+   if (ptr == nullptr) {
+      return;
+   }
+   priv_::slab_header *const header = priv_::header_of(ptr);
+   unsigned const idx = header->size_class;
+   if (idx == priv_::large_class) [[unlikely]] {
+      priv_::deallocate_large(header);
+      return;
+   }
+   priv_::thread_list &list = priv_::cache.lists[idx];
+   auto *const obj = static_cast<priv_::free_object *>(ptr);
+   obj->next = list.head;
+   list.head = obj;
+   ++list.deallocations;
+   if (++list.count > 2 * priv_::batch_size(idx)) [[unlikely]] {
+      priv_::drain(idx, list, priv_::batch_size(idx));
+   }
+}
+
+//! How many bytes `ptr`, from `allocate`, can actually hold.
+[[nodiscard]] inline ::std::size_t usable_size(void *ptr) noexcept
+{
+   priv_::slab_header const *const header = priv_::header_of(ptr);
+   if (header->size_class == priv_::large_class) {
+      auto const offset = static_cast<char *>(ptr)
+                          - reinterpret_cast<char const *>(header);
+      return header->mapped_size - static_cast<::std::size_t>(offset);
+   }
+   return class_size(header->size_class);
+}
+
+//! Give everything in the calling thread's cache back to the central lists.
+inline void flush_thread_cache() noexcept
+{
+   for (unsigned idx = 0; idx < num_size_classes; ++idx) {
+      priv_::thread_list &list = priv_::cache.lists[idx];
+      if (list.count > 0 || list.allocations > 0 || list.deallocations > 0) {
+         priv_::drain(idx, list, list.count);
+      }
+   }
+}
+
+/**
+ * \brief The counts for size class `idx`.
+ *
+ * Allocations and frees are only added up when a thread's cache next trades
+ * with the central list (or is flushed), so they lag a little.
+ */
+[[nodiscard]] inline size_class_stats stats(unsigned idx) noexcept
+{
+   size_class_stats result{class_size(idx), 0, 0, 0, 0};
+   if (idx >= num_size_classes) {
+      return result;
+   }
+   priv_::central_list &c = priv_::central[idx];
+   ::std::lock_guard<mutex> lock{c.lock};
+   result.slabs = c.slabs;
+   result.allocations = c.allocations;
+   result.deallocations = c.deallocations;
+   result.central_free = c.nfree;
+   return result;
+}
+
+//! The counts for blocks too big for any size class.
+[[nodiscard]] inline large_stats big_block_stats() noexcept
+{
+   return large_stats{
+        priv_::large_allocations.load(::std::memory_order_relaxed),
+        priv_::large_deallocations.load(::std::memory_order_relaxed),
+        priv_::large_bytes.load(::std::memory_order_relaxed)
+   };
+}
+
+} // namespace posixpp::heap
@@ -0,0 +1,455 @@
+// Copyright 2021 Eric Hopper
+// Distributed under the terms of the LGPLv3.
+
+#pragma once  /*-*-c++-*-*/
+
+#include <posixpp/expected.h>
+#include <posixpp/fd.h>
+#include <posixpp/fdflags.h>
+#include <posixpp/modeflags.h>
+#include <posixpp/mmapflags.h>
+#include <syscalls/linux/io_uring.h>
+#include <syscalls/linux/memory.h>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <optional>
+#include <utility>
+
+namespace posixpp {
+
+using ::syscalls::linux::io_uring_sqe;
+using ::syscalls::linux::io_uring_cqe;
+
+//! The result of one operation that was submitted to an `io_uring`.
+struct io_completion {
+   //! Whatever was passed as `user_data` when the operation was prepared.
+   ::std::uint64_t user_data;
+   //! What the equivalent system call would have returned.
+   expected<int> result;
+   //! The `flags` field of the completion queue entry.
+   ::std::uint32_t flags;
+};
+
+/**
+ * \brief A submission and completion queue pair shared with the kernel.
+ *
+ * See io_uring(7). Operations are prepared into the submission queue with the
+ * `prep_` member functions, handed to the kernel in a batch by `submit`, and
+ * their results collected with `peek_completion`, `wait_completion` or
+ * `for_each_completion`. Nothing here touches the kernel except `create`,
+ * `submit`, `wait_completion` and `register_files`, so hundreds of
+ * operations can cost a single system call.
+ *
+ * A ring is not thread safe. Each thread should have its own.
+ */
+class io_uring {
+ public:
+   using sqe_t = io_uring_sqe;
+   using cqe_t = io_uring_cqe;
+
+   //! See io_uring_setup(2). `entries` is rounded up to a power of two.
+   [[nodiscard]] static expected<io_uring> create(unsigned entries) noexcept
+   {
+      namespace sl = ::syscalls::linux;
+      using errtag = expected<io_uring>::err_tag;
+      sl::io_uring_params params{};
+      auto setup_result = sl::io_uring_setup(entries, &params);
+      if (setup_result.has_error()) {
+         return expected<io_uring>{errtag{}, setup_result.error()};
+      }
+      io_uring ring;
+      ring.ring_fd_ = fd{static_cast<int>(setup_result.result())};
+      if (auto const ec = ring.map_rings(params); ec != 0) {
+         return expected<io_uring>{errtag{}, ec};
+      }
+      return expected<io_uring>{::std::move(ring)};
+   }
+
+   io_uring(io_uring &&other) noexcept
+        : ring_fd_{::std::move(other.ring_fd_)}
+   {
+      steal_rings(other);
+   }
+
+   io_uring &operator =(io_uring &&other) noexcept {
+      if (this != &other) {
+         unmap_rings();
+         ring_fd_ = ::std::move(other.ring_fd_);
+         steal_rings(other);
+      }
+      return *this;
+   }
+
+   //! Unmaps the rings and closes the ring file descriptor.
+   ///
+   /// Any operations still in flight will be completed by the kernel, but
+   /// their results will be lost.
+   ~io_uring() noexcept { unmap_rings(); }
+
+   //! The file descriptor for the ring, useful for register_eventfd and such.
+   [[nodiscard]] fd const &ring_fd() const noexcept { return ring_fd_; }
+
+   //! Number of entries in the submission queue.
+   [[nodiscard]] unsigned sq_entries() const noexcept { return sq_mask_ + 1; }
+
+   //! Number of entries in the completion queue.
+   [[nodiscard]] unsigned cq_entries() const noexcept { return cq_mask_ + 1; }
+
+   /**
+    * \brief Number of prepared operations the kernel hasn't taken yet.
+    *
+    * This counts from the kernel's head, not the published tail, so it
+    * includes anything an earlier `submit` published that the kernel didn't
+    * get to.
+    */
+   [[nodiscard]] unsigned pending() const noexcept {
+      return sqe_tail_ - load_acquire(sq_khead_);
+   }
+
+   /**
+    * \brief Get a zeroed submission queue entry to fill in, or `nullptr`.
+    *
+    * A `nullptr` means the submission queue is full and `submit` must be
+    * called before any more operations can be prepared. The entry will be
+    * handed to the kernel by the next call to `submit`.
+    */
+   [[nodiscard]] sqe_t *get_sqe() noexcept {
+      unsigned const head = load_acquire(sq_khead_);
+      if (sqe_tail_ - head > sq_mask_) {
+         return nullptr;
+      }
+      sqe_t *const sqe = &sqes_[sqe_tail_ & sq_mask_];
+      ++sqe_tail_;
+      *sqe = sqe_t{};
+      return sqe;
+   }
+
+   /**
+    * \name Member functions that prepare an operation.
+    *
+    * Each of these returns `false` if the submission queue was full and
+    * nothing was prepared. `user_data` is handed back untouched in the
+    * `io_completion` for the operation.
+    */
+   //! @{
+   //! An operation that does nothing, useful to test the ring.
+   [[nodiscard]] bool prep_nop(::std::uint64_t user_data) noexcept {
+      return prep(::syscalls::linux::io_uring_op::nop, -1, user_data);
+   }
+
+   //! See pread(2). An offset of `-1` means to use the file position.
+   [[nodiscard]] bool prep_read(fd const &file, char *buf, ::std::size_t size,
+                                ::std::uint64_t offset,
+                                ::std::uint64_t user_data) noexcept
+   {
+      using ::syscalls::linux::io_uring_op;
+      sqe_t *const sqe = prep(io_uring_op::read, file.as_fd(), user_data);
+      if (sqe) {
+         sqe->addr = reinterpret_cast<::std::uintptr_t>(buf);
+         sqe->len = static_cast<::std::uint32_t>(size);
+         sqe->off = offset;
+      }
+      return sqe;
+   }
+
+   //! See pwrite(2). An offset of `-1` means to use the file position.
+   [[nodiscard]] bool prep_write(fd const &file,
+                                 char const *buf, ::std::size_t size,
+                                 ::std::uint64_t offset,
+                                 ::std::uint64_t user_data) noexcept
+   {
+      using ::syscalls::linux::io_uring_op;
+      sqe_t *const sqe = prep(io_uring_op::write, file.as_fd(), user_data);
+      if (sqe) {
+         sqe->addr = reinterpret_cast<::std::uintptr_t>(buf);
+         sqe->len = static_cast<::std::uint32_t>(size);
+         sqe->off = offset;
+      }
+      return sqe;
+   }
+
+   //! See fsync(2) and fdatasync(2).
+   [[nodiscard]] bool prep_fsync(fd const &file, bool datasync,
+                                 ::std::uint64_t user_data) noexcept
+   {
+      using ::syscalls::linux::io_uring_op;
+      using ::syscalls::linux::ioring_fsync_datasync;
+      sqe_t *const sqe = prep(io_uring_op::fsync, file.as_fd(), user_data);
+      if (sqe) {
+         sqe->op_flags = datasync ? ioring_fsync_datasync : 0;
+      }
+      return sqe;
+   }
+
+   //! See openat(2). The result in the completion is the new fd number.
+   [[nodiscard]] bool prep_openat(fd const &dirfd, char const *pathname,
+                                  openflags flags, modeflags mode,
+                                  ::std::uint64_t user_data) noexcept
+   {
+      using ::syscalls::linux::io_uring_op;
+      sqe_t *const sqe = prep(io_uring_op::openat, dirfd.as_fd(), user_data);
+      if (sqe) {
+         sqe->addr = reinterpret_cast<::std::uintptr_t>(pathname);
+         sqe->len = static_cast<::std::uint32_t>(mode.getbits());
+         sqe->op_flags = static_cast<::std::uint32_t>(flags.getbits());
+      }
+      return sqe;
+   }
+
+   //! See close(2). Takes a bare number since an `fd` would close it again.
+   [[nodiscard]] bool prep_close(int fdnum, ::std::uint64_t user_data) noexcept
+   {
+      return prep(::syscalls::linux::io_uring_op::close, fdnum, user_data);
+   }
+   //! @}
+
+   /**
+    * \brief Hand all prepared operations to the kernel, see io_uring_enter(2).
+    *
+    * @param wait_nr Don't return until at least this many completions are
+    * available.
+    *
+    * @return The number of operations the kernel accepted.
+    */
+   [[nodiscard]] expected<unsigned> submit(unsigned wait_nr = 0) noexcept {
+      using ::syscalls::linux::ioring_enter_getevents;
+      unsigned const to_submit = flush();
+      if (to_submit == 0 && wait_nr == 0) {
+         return expected<unsigned>{0U};
+      }
+      unsigned const flags = wait_nr > 0 ? ioring_enter_getevents : 0U;
+      return enter(to_submit, wait_nr, flags);
+   }
+
+   //! Take the next completion if there is one, never blocks.
+   [[nodiscard]] ::std::optional<io_completion> peek_completion() noexcept {
+      unsigned const head = *cq_khead_;
+      if (head == load_acquire(cq_ktail_)) {
+         return ::std::nullopt;
+      }
+      io_completion result = to_completion(cqes_[head & cq_mask_]);
+      store_release(cq_khead_, head + 1);
+      return result;
+   }
+
+   //! Take the next completion, submitting and waiting if there isn't one.
+   [[nodiscard]] expected<io_completion> wait_completion() noexcept {
+      using errtag = expected<io_completion>::err_tag;
+      for (;;) {
+         if (auto comp = peek_completion(); comp.has_value()) {
+            return expected<io_completion>{::std::move(*comp)};
+         }
+         auto submitted = submit(1);
+         if (submitted.has_error()) {
+            return expected<io_completion>{errtag{}, submitted.error()};
+         }
+      }
+   }
+
+   /**
+    * \brief Call `func` on every completion currently available.
+    *
+    * This only updates the shared completion queue head once, after all the
+    * completions have been looked at.
+    *
+    * @return The number of completions handed to `func`.
+    */
+   template <typename Func>
+   requires ::std::invocable<Func &, io_completion &&>
+   unsigned for_each_completion(Func &&func)
+   {
+      unsigned head = *cq_khead_;
+      unsigned const tail = load_acquire(cq_ktail_);
+      unsigned const count = tail - head;
+      for (; head != tail; ++head) {
+         func(to_completion(cqes_[head & cq_mask_]));
+      }
+      store_release(cq_khead_, tail);
+      return count;
+   }
+
+   //! See IORING_REGISTER_FILES in io_uring_register(2).
+   [[nodiscard]] expected<void>
+   register_files(int const *fds, unsigned nr_fds) noexcept
+   {
+      using ::syscalls::linux::io_uring_register_op;
+      return error_cascade_void(
+           ::syscalls::linux::io_uring_register(
+                ring_fd_.as_fd(), io_uring_register_op::register_files,
+                fds, nr_fds
+           )
+      );
+   }
+
+ private:
+   io_uring() noexcept = default;
+
+   static unsigned load_acquire(unsigned *loc) noexcept {
+      return ::std::atomic_ref<unsigned>{*loc}.load(::std::memory_order_acquire);
+   }
+   static void store_release(unsigned *loc, unsigned val) noexcept {
+      ::std::atomic_ref<unsigned>{*loc}.store(val, ::std::memory_order_release);
+   }
+
+   static io_completion to_completion(cqe_t const &cqe) noexcept {
+      using errtag = expected<int>::err_tag;
+      if (cqe.res < 0) {
+         return io_completion{cqe.user_data,
+                              expected<int>{errtag{}, -cqe.res},
+                              cqe.flags};
+      } else {
+         return io_completion{cqe.user_data, expected<int>{cqe.res},
+                              cqe.flags};
+      }
+   }
+
+   sqe_t *prep(::syscalls::linux::io_uring_op op, int fdnum,
+               ::std::uint64_t user_data) noexcept
+   {
+      sqe_t *const sqe = get_sqe();
+      if (sqe) {
+         sqe->opcode = static_cast<::std::uint8_t>(op);
+         sqe->fd = fdnum;
+         sqe->user_data = user_data;
+      }
+      return sqe;
+   }
+
+   //! Make prepared entries visible to the kernel, return how many there are.
+   unsigned flush() noexcept {
+      // The sq array was set up as an identity mapping in map_rings, so only
+      // the tail needs to be published.
+      if (sqe_tail_ != *sq_ktail_) {
+         store_release(sq_ktail_, sqe_tail_);
+      }
+      // Like liburing, count from the kernel's head. Entries an earlier
+      // io_uring_enter didn't consume are still waiting for one.
+      return pending();
+   }
+
+   expected<unsigned> enter(unsigned to_submit, unsigned min_complete,
+                            unsigned flags) noexcept
+   {
+      return error_cascade(
+           ::syscalls::linux::io_uring_enter(ring_fd_.as_fd(),
+                                             to_submit, min_complete, flags),
+           [](auto r) { return static_cast<unsigned>(r); }
+      );
+   }
+
+   //! Returns an errno value, or 0 on success.
+   int map_rings(::syscalls::linux::io_uring_params const &p) noexcept {
+      namespace sl = ::syscalls::linux;
+      auto const prot = (protflags::read | protflags::write).getbits();
+      auto const flags = (mapflags::shared | mapflags::populate).getbits();
+      auto const fdnum = ring_fd_.as_fd();
+
+      sq_ring_size_ = p.sq_off.array + p.sq_entries * sizeof(::std::uint32_t);
+      cq_ring_size_ = p.cq_off.cqes + p.cq_entries * sizeof(cqe_t);
+      bool const single_mmap = p.features & sl::ioring_feat_single_mmap;
+      if (single_mmap) {
+         if (cq_ring_size_ > sq_ring_size_) {
+            sq_ring_size_ = cq_ring_size_;
+         }
+         cq_ring_size_ = 0;
+      }
+
+      auto sq_map = sl::mmap(nullptr, sq_ring_size_, prot, flags,
+                             fdnum, sl::ioring_off_sq_ring);
+      if (sq_map.has_error()) {
+         return sq_map.error();
+      }
+      sq_ring_ = as_ptr(sq_map.result());
+      if (single_mmap) {
+         cq_ring_ = sq_ring_;
+      } else {
+         auto cq_map = sl::mmap(nullptr, cq_ring_size_, prot, flags,
+                                fdnum, sl::ioring_off_cq_ring);
+         if (cq_map.has_error()) {
+            return cq_map.error();
+         }
+         cq_ring_ = as_ptr(cq_map.result());
+      }
+      sqes_size_ = p.sq_entries * sizeof(sqe_t);
+      auto sqe_map = sl::mmap(nullptr, sqes_size_, prot, flags,
+                              fdnum, sl::ioring_off_sqes);
+      if (sqe_map.has_error()) {
+         return sqe_map.error();
+      }
+      sqes_ = static_cast<sqe_t *>(as_ptr(sqe_map.result()));
+
+      auto *const sq = static_cast<char *>(sq_ring_);
+      auto *const cq = static_cast<char *>(cq_ring_);
+      sq_khead_ = reinterpret_cast<unsigned *>(sq + p.sq_off.head);
+      sq_ktail_ = reinterpret_cast<unsigned *>(sq + p.sq_off.tail);
+      sq_mask_ = *reinterpret_cast<unsigned *>(sq + p.sq_off.ring_mask);
+      cq_khead_ = reinterpret_cast<unsigned *>(cq + p.cq_off.head);
+      cq_ktail_ = reinterpret_cast<unsigned *>(cq + p.cq_off.tail);
+      cq_mask_ = *reinterpret_cast<unsigned *>(cq + p.cq_off.ring_mask);
+      cqes_ = reinterpret_cast<cqe_t *>(cq + p.cq_off.cqes);
+      sqe_tail_ = *sq_ktail_;
+
+      auto *const array = reinterpret_cast<unsigned *>(sq + p.sq_off.array);
+      for (unsigned i = 0; i <= sq_mask_; ++i) {
+         array[i] = i;
+      }
+      return 0;
+   }
+
+   static void *as_ptr(::std::int64_t addr) noexcept {
+      return reinterpret_cast<void *>(addr);
+   }
+
+   void unmap_rings() noexcept {
+      using ::syscalls::linux::munmap;
+      // Errors are ignored, just like the destructor of fd.
+      if (sqes_) {
+         static_cast<void>(munmap(sqes_, sqes_size_));
+      }
+      if (cq_ring_ && cq_ring_ != sq_ring_) {
+         static_cast<void>(munmap(cq_ring_, cq_ring_size_));
+      }
+      if (sq_ring_) {
+         static_cast<void>(munmap(sq_ring_, sq_ring_size_));
+      }
+      sqes_ = nullptr;
+      cq_ring_ = sq_ring_ = nullptr;
+   }
+
+   void steal_rings(io_uring &other) noexcept {
+      sq_ring_ = ::std::exchange(other.sq_ring_, nullptr);
+      cq_ring_ = ::std::exchange(other.cq_ring_, nullptr);
+      sqes_ = ::std::exchange(other.sqes_, nullptr);
+      sq_ring_size_ = other.sq_ring_size_;
+      cq_ring_size_ = other.cq_ring_size_;
+      sqes_size_ = other.sqes_size_;
+      sq_khead_ = other.sq_khead_;
+      sq_ktail_ = other.sq_ktail_;
+      cq_khead_ = other.cq_khead_;
+      cq_ktail_ = other.cq_ktail_;
+      cqes_ = other.cqes_;
+      sq_mask_ = other.sq_mask_;
+      cq_mask_ = other.cq_mask_;
+      sqe_tail_ = other.sqe_tail_;
+   }
+
+   fd ring_fd_;
+   void *sq_ring_ = nullptr;
+   void *cq_ring_ = nullptr;
+   sqe_t *sqes_ = nullptr;
+   ::std::size_t sq_ring_size_ = 0;
+   ::std::size_t cq_ring_size_ = 0;
+   ::std::size_t sqes_size_ = 0;
+   unsigned *sq_khead_ = nullptr;
+   unsigned *sq_ktail_ = nullptr;
+   unsigned *cq_khead_ = nullptr;
+   unsigned *cq_ktail_ = nullptr;
+   cqe_t *cqes_ = nullptr;
+   unsigned sq_mask_ = 0;
+   unsigned cq_mask_ = 0;
+   //! Where the next prepared entry goes. May be ahead of `*sq_ktail_`.
+   unsigned sqe_tail_ = 0;
+};
+
+} // namespace posixpp
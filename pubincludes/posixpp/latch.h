@@ -0,0 +1,84 @@
+// Copyright 2021 Eric Hopper
+// Distributed under the terms of the LGPLv3.
+
+#pragma once  /*-*-c++-*-*/
+
+#include <posixpp/expected.h>
+#include <posixpp/futex.h>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+
+namespace posixpp {
+
+/**
+ * \brief A single use countdown that threads can wait to reach zero, like
+ * `::std::latch`.
+ *
+ * It's one 32 bit word holding the count, plus a bit saying somebody might be
+ * asleep waiting. Only the `count_down` that reaches zero with that bit set
+ * calls the kernel, to wake everybody.
+ */
+class latch {
+ public:
+   static constexpr ::std::ptrdiff_t max() noexcept { return count_mask; }
+
+   //! `expected` must be between 0 and `max()`.
+   constexpr explicit latch(::std::ptrdiff_t expected) noexcept
+        : word_{static_cast<::std::uint32_t>(expected)}
+   {}
+   latch(latch const &) = delete;
+   latch &operator =(latch const &) = delete;
+
+   //! Take `n` off the count, waking the waiters if that makes it zero.
+   expected<void> count_down(::std::ptrdiff_t n = 1) noexcept {
+      auto const dec = static_cast<::std::uint32_t>(n);
+      ::std::uint32_t const old = word_.fetch_sub(dec,
+                                                  ::std::memory_order_acq_rel);
+      if ((old & count_mask) == dec && (old & waiting) != 0) {
+         return error_cascade_void(futex_wake(word_, INT_MAX));
+      }
+      return expected<void>{};
+   }
+
+   //! Whether the count is zero, never waits.
+   [[nodiscard]] bool try_wait() const noexcept {
+      return (word_.load(::std::memory_order_acquire) & count_mask) == 0;
+   }
+
+   //! Wait for the count to reach zero.
+   expected<void> wait() const noexcept {
+      for (;;) {
+         ::std::uint32_t c = word_.load(::std::memory_order_acquire);
+         if ((c & count_mask) == 0) {
+            return expected<void>{};
+         }
+         if ((c & waiting) == 0
+             && !word_.compare_exchange_weak(c, c | waiting,
+                                             ::std::memory_order_relaxed))
+         {
+            continue;
+         }
+         auto const result = futex_wait(word_, c | waiting);
+         if (priv_::is_real_wait_error(result)) {
+            return result;
+         }
+      }
+   }
+
+   //! `count_down(n)` then `wait()`.
+   expected<void> arrive_and_wait(::std::ptrdiff_t n = 1) noexcept {
+      if (auto result = count_down(n); result.has_error()) {
+         return result;
+      }
+      return wait();
+   }
+
+ private:
+   static constexpr ::std::uint32_t waiting = 0x8000'0000U;
+   static constexpr ::std::uint32_t count_mask = waiting - 1;
+
+   mutable futex_word word_;
+};
+
+} // namespace posixpp
@@ -0,0 +1,190 @@
+// Copyright 2021 Eric Hopper
+// Distributed under the terms of the LGPLv3.
+
+#pragma once  /*-*-c++-*-*/
+
+#include <posixpp/expected.h>
+#include <posixpp/fd.h>
+#include <posixpp/mmapflags.h>
+#include <syscalls/linux/memory.h>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace posixpp {
+
+using ::syscalls::linux::madvice;
+
+//! A region of memory from mmap(2), and the associated functions
+class mapping {
+ public:
+   //! Create a mapping that doesn't refer to any memory.
+   constexpr mapping() noexcept = default;
+
+   //! Avoid using this to take ownership of memory from some other mmap.
+   constexpr mapping(void *addr, ::std::size_t size) noexcept
+        : addr_{static_cast<char *>(addr)}, size_{size}
+   {}
+
+   //! \brief Will call `munmap` on a valid mapping and ignore the return
+   //! value.
+   //!
+   //! If you care about the return value of `munmap`, use the `unmap` method
+   //! of this class.
+   ~mapping() noexcept {
+      if (addr_ != nullptr) {
+         ::syscalls::linux::munmap(addr_, size_); // Ignore any error return.
+      }
+   }
+
+   mapping(mapping &&other) noexcept
+        : addr_{::std::exchange(other.addr_, nullptr)},
+          size_{::std::exchange(other.size_, 0)}
+   {}
+
+   //! \brief Will call `munmap` on the destination if it's valid, and ignore
+   //! the return value.
+   mapping &operator =(mapping &&other) noexcept {
+      char *const tmpaddr = ::std::exchange(other.addr_, nullptr);
+      ::std::size_t const tmpsize = ::std::exchange(other.size_, 0);
+      if (addr_ != nullptr) {
+         ::syscalls::linux::munmap(addr_, size_); // Ignore any error return.
+      }
+      addr_ = tmpaddr;
+      size_ = tmpsize;
+      return *this;
+   }
+
+   //! Unmaps the memory and makes this mapping refer to nothing.
+   [[nodiscard]] expected<void> unmap() noexcept {
+      char *const tmpaddr = ::std::exchange(addr_, nullptr);
+      ::std::size_t const tmpsize = ::std::exchange(size_, 0);
+      return ::syscalls::linux::munmap(tmpaddr, tmpsize);
+   }
+
+   [[nodiscard]] constexpr bool is_valid() const noexcept {
+      return addr_ != nullptr;
+   }
+
+   [[nodiscard]] constexpr char *data() const noexcept { return addr_; }
+   [[nodiscard]] constexpr ::std::size_t size() const noexcept { return size_; }
+   [[nodiscard]] constexpr char *begin() const noexcept { return addr_; }
+   [[nodiscard]] constexpr char *end() const noexcept { return addr_ + size_; }
+
+   /**
+    * \brief See madvise(2), tell the kernel how a part of the mapping will be
+    * used.
+    *
+    * `offset` is rounded down to the start of its page, and the length is
+    * extended to match, since the kernel only accepts page aligned addresses.
+    * The default arguments cover the whole mapping.
+    *
+    * The most useful ones for scanning large files are `madvice::sequential`
+    * (read ahead aggressively and drop pages once they've been passed),
+    * `madvice::willneed` (start reading now), and `madvice::dontneed` (drop
+    * pages that won't be looked at again). `madvice::hugepage` only has an
+    * effect on anonymous (or tmpfs) memory.
+    */
+   expected<void> advise(madvice advice, ::std::size_t offset = 0,
+                         ::std::size_t length = npos) const noexcept
+   {
+      if (offset > size_) {
+         offset = size_;
+      }
+      if (length > size_ - offset) {
+         length = size_ - offset;
+      }
+      ::std::size_t const slop = offset % page_size;
+      return ::syscalls::linux::madvise(addr_ + offset - slop,
+                                        length + slop, advice);
+   }
+
+   /**
+    * \brief Fault in every page of the mapping now, instead of as it's
+    * touched.
+    *
+    * This is MAP_POPULATE for after the mapping already exists, and unlike
+    * MAP_POPULATE it reports failures. It needs Linux 5.14.
+    *
+    * @param for_write Whether to fault pages in writeable, which breaks
+    * copy-on-write for private mappings.
+    */
+   expected<void> populate(bool for_write = false) const noexcept {
+      return advise(for_write ? madvice::populate_write
+                              : madvice::populate_read);
+   }
+
+   /**
+    * \brief See mremap(2), change the size of the mapping.
+    *
+    * On failure, the mapping is unchanged.
+    *
+    * @param may_move Whether the kernel can move the mapping to a new address
+    * if there isn't room to grow it in place. Pointers into the old mapping
+    * are no longer valid if it moves.
+    */
+   expected<void> resize(::std::size_t new_size, bool may_move = true) noexcept
+   {
+      auto const flags = may_move ? remapflags::maymove : remapflags{};
+      auto result = ::syscalls::linux::mremap(
+           addr_, size_, new_size, flags.getbits(), nullptr
+      );
+      if (!result.has_error()) {
+         addr_ = reinterpret_cast<char *>(result.result().val);
+         size_ = new_size;
+      }
+      return error_cascade_void(::std::move(result));
+   }
+
+   //! Give up ownership of the memory without unmapping it.
+   [[nodiscard]] void *release() noexcept {
+      size_ = 0;
+      return ::std::exchange(addr_, nullptr);
+   }
+
+   static constexpr ::std::size_t npos = ~::std::size_t{0};
+   static constexpr ::std::size_t page_size = 4096;
+
+ private:
+   char *addr_ = nullptr;
+   ::std::size_t size_ = 0;
+};
+
+/**
+ * \brief See mmap(2), map `length` bytes of `file` starting at `offset`.
+ *
+ * `offset` must be a multiple of the page size. Use `mapflags::populate` to
+ * have the whole thing faulted in up front, and `mapflags::shared` or
+ * `mapflags::private_` (one of which is required) to decide whether writes go
+ * to the file.
+ */
+[[nodiscard]] inline expected<mapping>
+mmap(fd const &file, ::std::size_t length, ::std::int64_t offset,
+     protflags prot, mapflags flags) noexcept
+{
+   return error_cascade(
+        ::syscalls::linux::mmap(nullptr, length, prot.getbits(),
+                                flags.getbits(), file.as_fd(), offset),
+        [length](auto addr) {
+           return mapping{reinterpret_cast<void *>(addr.val), length};
+        }
+   );
+}
+
+//! See mmap(2), map `length` bytes of zero filled memory.
+[[nodiscard]] inline expected<mapping>
+mmap_anonymous(::std::size_t length,
+               protflags prot = protflags::read | protflags::write,
+               mapflags flags = mapflags::private_) noexcept
+{
+   return error_cascade(
+        ::syscalls::linux::mmap(nullptr, length, prot.getbits(),
+                                (flags | mapflags::anonymous).getbits(),
+                                -1, 0),
+        [length](auto addr) {
+           return mapping{reinterpret_cast<void *>(addr.val), length};
+        }
+   );
+}
+
+} // namespace posixpp
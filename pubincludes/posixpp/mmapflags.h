@@ -0,0 +1,14 @@
+#pragma once  /*-*-c++-*-*/
+
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+#include <syscalls/linux/x86_64/mmapflags.h>
+
+namespace posixpp {
+
+using ::syscalls::linux::x86_64::protflags;
+using ::syscalls::linux::x86_64::mapflags;
+using ::syscalls::linux::x86_64::remapflags;
+
+} // namespace posixpp
@@ -0,0 +1,117 @@
+// Copyright 2021 Eric Hopper
+// Distributed under the terms of the LGPLv3.
+
+#pragma once  /*-*-c++-*-*/
+
+#include <posixpp/expected.h>
+#include <posixpp/futex.h>
+#include <pppbase/cpu_relax.h>
+#include <atomic>
+#include <cstdint>
+#include <system_error>
+
+namespace posixpp {
+
+class condition_variable;
+
+/**
+ * \brief A mutex that's a single 32 bit word, and calls the kernel only when
+ * there's real contention.
+ *
+ * This is the third mutex from Ulrich Drepper's "Futexes Are Tricky" with a
+ * short spin added before sleeping. The word is 0 when unlocked, 1 when
+ * locked with no waiters, and 2 when there may be threads asleep in the
+ * kernel waiting for it. Only an unlock that sees 2 makes a system call.
+ *
+ * It meets the standard Lockable requirements, so `::std::lock_guard` and
+ * friends work with it. They ignore the `expected<void>` results, which only
+ * have errors if the kernel refuses to let a thread sleep on the mutex word
+ * (`EFAULT` or `EINVAL`), which should never happen.
+ */
+class mutex {
+ public:
+   constexpr mutex() noexcept = default;
+   mutex(mutex const &) = delete;
+   mutex &operator =(mutex const &) = delete;
+
+   //! Take the lock, sleeping if needed.
+   expected<void> lock() noexcept {
+      ::std::uint32_t c = unlocked;
+      if (state_.compare_exchange_strong(c, locked,
+                                         ::std::memory_order_acquire,
+                                         ::std::memory_order_relaxed)) {
+         return expected<void>{};
+      }
+      return lock_slow(c);
+   }
+
+   //! Take the lock only if nobody has it, never calls the kernel.
+   [[nodiscard]] bool try_lock() noexcept {
+      ::std::uint32_t c = unlocked;
+      return state_.compare_exchange_strong(c, locked,
+                                            ::std::memory_order_acquire,
+                                            ::std::memory_order_relaxed);
+   }
+
+   //! Release the lock, waking a waiter if there might be one.
+   expected<void> unlock() noexcept {
+      if (state_.exchange(unlocked, ::std::memory_order_release) == contended) {
+         return error_cascade_void(futex_wake(state_, 1));
+      }
+      return expected<void>{};
+   }
+
+ private:
+   friend class condition_variable;
+
+   static constexpr ::std::uint32_t unlocked = 0;
+   static constexpr ::std::uint32_t locked = 1;
+   static constexpr ::std::uint32_t contended = 2;
+
+   //! Total number of pause instructions to spin for before sleeping.
+   static constexpr unsigned spin_budget = 128;
+
+   expected<void> lock_slow(::std::uint32_t c) noexcept {
+      // Spin with exponential backoff while the holder has no waiters and is
+      // presumably still running. Once there are sleepers, spinning just
+      // competes with the thread the unlocker is waking up.
+      for (unsigned pauses = 1, spent = 0;
+           c == locked && spent < spin_budget;
+           spent += pauses, pauses *= 2)
+      {
+         for (unsigned i = 0; i < pauses; ++i) {
+            ::pppbase::cpu_relax();
+         }
+         c = state_.load(::std::memory_order_relaxed);
+         if (c == unlocked
+             && state_.compare_exchange_strong(c, locked,
+                                               ::std::memory_order_acquire,
+                                               ::std::memory_order_relaxed))
+         {
+            return expected<void>{};
+         }
+      }
+      return lock_contended(c);
+   }
+
+   //! Take the lock, marking it as possibly having waiters.
+   ///
+   /// `c` is the last value seen in the mutex word.
+   expected<void> lock_contended(::std::uint32_t c) noexcept {
+      if (c != contended) {
+         c = state_.exchange(contended, ::std::memory_order_acquire);
+      }
+      while (c != unlocked) {
+         auto const result = futex_wait(state_, contended);
+         if (priv_::is_real_wait_error(result)) {
+            return result;
+         }
+         c = state_.exchange(contended, ::std::memory_order_acquire);
+      }
+      return expected<void>{};
+   }
+
+   futex_word state_ = unlocked;
+};
+
+} // namespace posixpp
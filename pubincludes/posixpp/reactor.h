@@ -0,0 +1,211 @@
+// Copyright 2021 Eric Hopper
+// Distributed under the terms of the LGPLv3.
+
+#pragma once  /*-*-c++-*-*/
+
+#include <posixpp/expected.h>
+#include <posixpp/fd.h>
+#include <posixpp/epollflags.h>
+#include <syscalls/linux/epoll.h>
+#include <cstdint>
+#include <system_error>
+#include <utility>
+
+namespace posixpp {
+
+/**
+ * \brief Something that wants to hear when a file descriptor is ready.
+ *
+ * The reactor only holds a pointer to a handler, so a handler must be removed
+ * from the reactor (or the reactor destroyed) before the handler is.
+ */
+class event_handler {
+ public:
+   /**
+    * \brief Called from `reactor::poll` with the events that happened.
+    *
+    * Everything is edge triggered, so a handler that stops reading (or
+    * writing) before it gets `EAGAIN` won't be called again for data that was
+    * already there.
+    */
+   virtual void on_events(epollevents events) noexcept = 0;
+
+ protected:
+   ~event_handler() = default;
+};
+
+/**
+ * \brief Dispatches readiness of many file descriptors to their handlers
+ * using epoll.
+ *
+ * Everything is registered edge triggered, and so only non-blocking file
+ * descriptors are accepted. Otherwise a handler draining its fd until `EAGAIN`
+ * would block the whole loop instead. This is checked when the fd is added.
+ *
+ * Events are fetched into an array inside the reactor, `max_events` at a
+ * time, so no memory is allocated after the reactor is created, and a burst
+ * of activity on many connections is picked up with one system call.
+ */
+class reactor {
+ public:
+   static constexpr int max_events = 512;
+
+   //! Create a reactor with a new epoll instance.
+   [[nodiscard]] static expected<reactor> create() noexcept {
+      return error_cascade(
+           ::syscalls::linux::epoll_create1(
+                static_cast<int>(fdflags::cloexec.getbits())
+           ),
+           [](auto epfd) { return reactor{fd{static_cast<int>(epfd)}}; }
+      );
+   }
+
+   reactor(reactor &&other) noexcept
+        : epfd_{::std::move(other.epfd_)},
+          next_{::std::exchange(other.next_, 0)},
+          nready_{::std::exchange(other.nready_, 0)},
+          stopped_{other.stopped_}
+   {
+      for (int i = next_; i < nready_; ++i) {
+         events_[i] = other.events_[i];
+      }
+   }
+   reactor &operator =(reactor &&other) noexcept {
+      if (this != &other) {
+         epfd_ = ::std::move(other.epfd_);
+         next_ = ::std::exchange(other.next_, 0);
+         nready_ = ::std::exchange(other.nready_, 0);
+         stopped_ = other.stopped_;
+         for (int i = next_; i < nready_; ++i) {
+            events_[i] = other.events_[i];
+         }
+      }
+      return *this;
+   }
+
+   /**
+    * \brief Start calling `handler` for `events` on `file`.
+    *
+    * `epollevents::et` is always added. Fails with `EINVAL` if `file` isn't
+    * in non-blocking mode.
+    */
+   expected<void> add(fd const &file, event_handler &handler,
+                      epollevents events) noexcept
+   {
+      auto const flags = file.get_status_flags();
+      if (flags.has_error()) {
+         return expected<void>{flags.error()};
+      }
+      if (!(flags.result() & fdflags::nonblock)) {
+         return expected<void>{static_cast<int>(::std::errc::invalid_argument)};
+      }
+      return control(::syscalls::linux::epoll_op::add, file, &handler, events);
+   }
+
+   //! Change the handler or the events for a file that's already been added.
+   expected<void> modify(fd const &file, event_handler &handler,
+                         epollevents events) noexcept
+   {
+      return control(::syscalls::linux::epoll_op::mod, file, &handler, events);
+   }
+
+   /**
+    * \brief Stop calling `handler` for `file`.
+    *
+    * This is safe to call from inside a handler, even for a different file
+    * that already has events waiting in the current batch; those are dropped.
+    *
+    * Closing a file removes it automatically, but only if it hasn't been
+    * dup'ed, so it's best to remove it first.
+    */
+   expected<void> remove(fd const &file, event_handler &handler) noexcept {
+      forget(&handler);
+      return ::syscalls::linux::epoll_ctl(epfd_.as_fd(),
+                                          ::syscalls::linux::epoll_op::del,
+                                          file.as_fd(), nullptr);
+   }
+
+   /**
+    * \brief Wait up to `timeout_ms` (-1 for forever) for events, and dispatch
+    * them.
+    *
+    * @return How many handlers were called.
+    */
+   expected<unsigned> poll(int timeout_ms = -1) noexcept {
+      using errtag = expected<unsigned>::err_tag;
+      auto const result = ::syscalls::linux::epoll_pwait(epfd_.as_fd(),
+                                                         events_, max_events,
+                                                         timeout_ms);
+      if (result.has_error()) {
+         if (result.error() == static_cast<int>(::std::errc::interrupted)) {
+            return expected<unsigned>{0U};
+         }
+         return expected<unsigned>{errtag{}, result.error()};
+      }
+      nready_ = static_cast<int>(result.result());
+      unsigned called = 0;
+      for (next_ = 0; next_ < nready_; ) {
+         auto const &event = events_[next_++];
+         auto *const handler = reinterpret_cast<event_handler *>(
+              static_cast<::std::uintptr_t>(event.data)
+         );
+         if (handler != nullptr) {
+            handler->on_events(epollevents::create_from_int(event.events));
+            ++called;
+         }
+      }
+      next_ = nready_ = 0;
+      return expected<unsigned>{called};
+   }
+
+   //! Call `poll` until `stop` is called or there's an error.
+   expected<void> run() noexcept {
+      stopped_ = false;
+      while (!stopped_) {
+         auto const result = poll();
+         if (result.has_error()) {
+            return expected<void>{result.error()};
+         }
+      }
+      return expected<void>{};
+   }
+
+   //! Make `run` return after the current batch of events.
+   void stop() noexcept { stopped_ = true; }
+
+   [[nodiscard]] fd const &epoll_fd() const noexcept { return epfd_; }
+
+ private:
+   explicit reactor(fd &&epfd) noexcept : epfd_{::std::move(epfd)} {}
+
+   expected<void> control(::syscalls::linux::epoll_op op, fd const &file,
+                          event_handler *handler, epollevents events) noexcept
+   {
+      ::syscalls::linux::epoll_event event{
+           static_cast<::std::uint32_t>((events | epollevents::et).getbits()),
+           reinterpret_cast<::std::uintptr_t>(handler)
+      };
+      return ::syscalls::linux::epoll_ctl(epfd_.as_fd(), op, file.as_fd(),
+                                          &event);
+   }
+
+   //! Drop events for `handler` that are waiting in the current batch.
+   void forget(event_handler const *handler) noexcept {
+      auto const data = reinterpret_cast<::std::uintptr_t>(handler);
+      for (int i = next_; i < nready_; ++i) {
+         if (events_[i].data == data) {
+            events_[i].data = 0;
+         }
+      }
+   }
+
+   fd epfd_;
+   //! Index of the next event to dispatch in the current batch.
+   int next_ = 0;
+   //! How many events are in the current batch.
+   int nready_ = 0;
+   bool stopped_ = false;
+   ::syscalls::linux::epoll_event events_[max_events];
+};
+
+} // namespace posixpp
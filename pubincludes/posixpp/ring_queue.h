@@ -0,0 +1,423 @@
+// Copyright 2021 Eric Hopper
+// Distributed under the terms of the LGPLv3.
+
+#pragma once  /*-*-c++-*-*/
+
+#include <posixpp/eventfd.h>
+#include <posixpp/expected.h>
+#include <posixpp/fd.h>
+#include <posixpp/futex.h>
+#include <atomic>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/**
+ * \file
+ * \brief Bounded lock-free queues for handing things from one thread to
+ * another.
+ *
+ * `spsc_queue` has one producer and one consumer, and `mpsc_queue` any number
+ * of producers and one consumer. Both are rings with a power of two capacity
+ * allocated inline, and the indexes each side writes are on cache lines of
+ * their own so the two sides don't fight over them.
+ *
+ * What happens when the consumer finds the queue empty is up to the `Wakeup`
+ * parameter:
+ *  - `no_wakeup`, the default, leaves the consumer to poll `try_pop`.
+ *  - `futex_wakeup` adds a blocking `pop` that sleeps on a futex.
+ *  - `eventfd_wakeup` makes an eventfd readable when something arrives for a
+ *    consumer that has gone idle, so the queue can be handled by a `reactor`.
+ *
+ * Producers only call the kernel when the consumer has said it's going idle,
+ * so a busy consumer costs them nothing but a memory fence.
+ */
+
+namespace posixpp {
+
+//! Consumers poll, producers never call the kernel.
+struct no_wakeup {
+   void notify() noexcept {}
+};
+
+//! Consumers can sleep in `pop` until a producer wakes them.
+class futex_wakeup {
+ public:
+   //! Called by producers after every push.
+   void notify() noexcept {
+      // Pairs with the fence in `wait_while`. Either the consumer sees the
+      // new item, or this sees the consumer is idle.
+      ::std::atomic_thread_fence(::std::memory_order_seq_cst);
+      if (idle_.load(::std::memory_order_relaxed) != 0
+          && idle_.exchange(0, ::std::memory_order_relaxed) != 0)
+      {
+         static_cast<void>(futex_wake(idle_, 1));
+      }
+   }
+
+   //! Called by the consumer, sleeps if `empty()` is still true after
+   //! saying it's idle. It may return early, so check again.
+   template <typename Empty>
+   expected<void> wait_while(Empty empty) noexcept {
+      idle_.store(1, ::std::memory_order_relaxed);
+      ::std::atomic_thread_fence(::std::memory_order_seq_cst);
+      if (empty()) {
+         auto const result = futex_wait(idle_, 1);
+         if (priv_::is_real_wait_error(result)) {
+            idle_.store(0, ::std::memory_order_relaxed);
+            return result;
+         }
+      }
+      idle_.store(0, ::std::memory_order_relaxed);
+      return expected<void>{};
+   }
+
+ private:
+   futex_word idle_{0};
+};
+
+/**
+ * \brief Makes an eventfd readable when something arrives for a consumer
+ * that has gone idle.
+ *
+ * The eventfd is non-blocking, so it can be added to a `reactor`. The
+ * consumer pops until the queue is empty, then calls `arm` on the queue
+ * before going back to waiting for the eventfd.
+ */
+class eventfd_wakeup {
+ public:
+   [[nodiscard]] static expected<eventfd_wakeup> create() noexcept {
+      return error_cascade(
+           eventfd(0, eventfdflags::nonblock | eventfdflags::cloexec),
+           [](fd &&efd) { return eventfd_wakeup{::std::move(efd)}; }
+      );
+   }
+
+   eventfd_wakeup(eventfd_wakeup &&other) noexcept
+        : efd_{::std::move(other.efd_)},
+          armed_{other.armed_.load(::std::memory_order_relaxed)}
+   {}
+   eventfd_wakeup &operator =(eventfd_wakeup &&other) noexcept {
+      efd_ = ::std::move(other.efd_);
+      armed_.store(other.armed_.load(::std::memory_order_relaxed),
+                   ::std::memory_order_relaxed);
+      return *this;
+   }
+
+   //! The eventfd to wait on for readability.
+   [[nodiscard]] fd const &get_fd() const noexcept { return efd_; }
+
+   //! Called by producers after every push.
+   void notify() noexcept {
+      // Pairs with the fence in `arm`.
+      ::std::atomic_thread_fence(::std::memory_order_seq_cst);
+      if (armed_.load(::std::memory_order_relaxed) != 0
+          && armed_.exchange(0, ::std::memory_order_relaxed) != 0)
+      {
+         static_cast<void>(eventfd_write(efd_, 1));
+      }
+   }
+
+   /**
+    * \brief Called by the consumer. Clears the eventfd and asks to be
+    * signalled, unless `empty()` is false after all.
+    *
+    * @return Whether the consumer should go back to waiting for the eventfd.
+    * If not, something arrived in the meantime and it should keep popping.
+    */
+   template <typename Empty>
+   [[nodiscard]] bool arm(Empty empty) noexcept {
+      static_cast<void>(eventfd_read(efd_));
+      armed_.store(1, ::std::memory_order_relaxed);
+      ::std::atomic_thread_fence(::std::memory_order_seq_cst);
+      if (!empty()) {
+         armed_.store(0, ::std::memory_order_relaxed);
+         return false;
+      }
+      return true;
+   }
+
+ private:
+   explicit eventfd_wakeup(fd &&efd) noexcept : efd_{::std::move(efd)} {}
+
+   fd efd_;
+   ::std::atomic<::std::uint32_t> armed_ = 0;
+};
+
+namespace priv_ {
+
+template <typename T>
+concept queue_item = ::std::is_nothrow_move_constructible_v<T>
+                     && ::std::is_nothrow_move_assignable_v<T>
+                     && ::std::is_nothrow_destructible_v<T>;
+
+template <::std::size_t Capacity>
+concept ring_capacity = Capacity > 0 && (Capacity & (Capacity - 1)) == 0;
+
+template <typename Wakeup>
+concept queue_wakeup = requires(Wakeup &w) {
+   { w.notify() } noexcept;
+};
+
+//! Uninitialized space for one item.
+template <typename T>
+struct ring_slot {
+   T *get() noexcept { return ::std::launder(reinterpret_cast<T *>(bytes)); }
+   alignas(T) unsigned char bytes[sizeof(T)];
+};
+
+} // namespace priv_
+
+/**
+ * \brief A bounded queue with exactly one producer thread and one consumer
+ * thread.
+ *
+ * Each side keeps a stale copy of the other side's index and only rereads the
+ * real one when the copy says the queue is full (or empty), so in a steady
+ * stream each side mostly touches only its own cache lines.
+ */
+template <typename T, ::std::size_t Capacity,
+          typename Wakeup = no_wakeup>
+requires priv_::queue_item<T> && priv_::ring_capacity<Capacity>
+         && priv_::queue_wakeup<Wakeup>
+class spsc_queue {
+ public:
+   spsc_queue() noexcept requires ::std::default_initializable<Wakeup>
+        : wakeup_{}
+   {}
+   explicit spsc_queue(Wakeup &&wakeup) noexcept
+        : wakeup_{::std::move(wakeup)}
+   {}
+   spsc_queue(spsc_queue const &) = delete;
+   spsc_queue &operator =(spsc_queue const &) = delete;
+
+   //! Destroys whatever's still in the queue.
+   ~spsc_queue() {
+      ::std::size_t const tail = tail_.load(::std::memory_order_relaxed);
+      for (auto i = head_.load(::std::memory_order_relaxed); i != tail; ++i) {
+         slots_[i & mask].get()->~T();
+      }
+   }
+
+   static constexpr ::std::size_t capacity() noexcept { return Capacity; }
+
+   //! Producer only. Returns false, leaving `item` alone, if the queue is full.
+   template <typename U>
+   requires ::std::is_nothrow_constructible_v<T, U &&>
+   [[nodiscard]] bool try_push(U &&item) noexcept {
+      ::std::size_t const tail = tail_.load(::std::memory_order_relaxed);
+      if (tail - cached_head_ >= Capacity) {
+         cached_head_ = head_.load(::std::memory_order_acquire);
+         if (tail - cached_head_ >= Capacity) {
+            return false;
+         }
+      }
+      ::new (slots_[tail & mask].bytes) T(::std::forward<U>(item));
+      tail_.store(tail + 1, ::std::memory_order_release);
+      wakeup_.notify();
+      return true;
+   }
+
+   //! Consumer only. Returns false if the queue is empty.
+   [[nodiscard]] bool try_pop(T &out) noexcept {
+      ::std::size_t const head = head_.load(::std::memory_order_relaxed);
+      if (head == cached_tail_) {
+         cached_tail_ = tail_.load(::std::memory_order_acquire);
+         if (head == cached_tail_) {
+            return false;
+         }
+      }
+      T *const item = slots_[head & mask].get();
+      out = ::std::move(*item);
+      item->~T();
+      head_.store(head + 1, ::std::memory_order_release);
+      return true;
+   }
+
+   //! Consumer only. Whether there's nothing to pop right now.
+   [[nodiscard]] bool empty() const noexcept {
+      return head_.load(::std::memory_order_relaxed)
+             == tail_.load(::std::memory_order_acquire);
+   }
+
+   //! Consumer only. Wait for an item and take it.
+   expected<void> pop(T &out) noexcept
+   requires ::std::same_as<Wakeup, futex_wakeup>
+   {
+      while (!try_pop(out)) {
+         auto result = wakeup_.wait_while([this]() noexcept {
+            return empty();
+         });
+         if (result.has_error()) {
+            return result;
+         }
+      }
+      return expected<void>{};
+   }
+
+   //! Consumer only. See `eventfd_wakeup::arm`.
+   [[nodiscard]] bool arm() noexcept
+   requires ::std::same_as<Wakeup, eventfd_wakeup>
+   {
+      return wakeup_.arm([this]() noexcept { return empty(); });
+   }
+
+   [[nodiscard]] Wakeup &get_wakeup() noexcept { return wakeup_; }
+
+ private:
+   static constexpr ::std::size_t mask = Capacity - 1;
+
+   // Written by the consumer.
+   alignas(64) ::std::atomic<::std::size_t> head_ = 0;
+   ::std::size_t cached_tail_ = 0;
+   // Written by the producer.
+   alignas(64) ::std::atomic<::std::size_t> tail_ = 0;
+   ::std::size_t cached_head_ = 0;
+   alignas(64) Wakeup wakeup_;
+   alignas(64) priv_::ring_slot<T> slots_[Capacity];
+};
+
+/**
+ * \brief A bounded queue with any number of producer threads and one
+ * consumer thread.
+ *
+ * This is Dmitry Vyukov's bounded queue with the consumer side simplified.
+ * Each slot has a sequence number saying whether it's ready to be written or
+ * read, so producers only contend on claiming a slot, and an item is only
+ * visible to the consumer once its producer has finished writing it.
+ */
+template <typename T, ::std::size_t Capacity,
+          typename Wakeup = no_wakeup>
+requires priv_::queue_item<T> && priv_::ring_capacity<Capacity>
+         && priv_::queue_wakeup<Wakeup>
+class mpsc_queue {
+ public:
+   mpsc_queue() noexcept requires ::std::default_initializable<Wakeup>
+        : wakeup_{}
+   {
+      init_slots();
+   }
+   explicit mpsc_queue(Wakeup &&wakeup) noexcept
+        : wakeup_{::std::move(wakeup)}
+   {
+      init_slots();
+   }
+   mpsc_queue(mpsc_queue const &) = delete;
+   mpsc_queue &operator =(mpsc_queue const &) = delete;
+
+   //! Destroys whatever's still in the queue.
+   ~mpsc_queue() {
+      for (::std::size_t pos = head_; ; ++pos) {
+         slot &s = slots_[pos & mask];
+         if (s.seq.load(::std::memory_order_relaxed) != pos + 1) {
+            break;
+         }
+         s.item.get()->~T();
+      }
+   }
+
+   static constexpr ::std::size_t capacity() noexcept { return Capacity; }
+
+   //! Any thread. Returns false, leaving `item` alone, if the queue is full.
+   template <typename U>
+   requires ::std::is_nothrow_constructible_v<T, U &&>
+   [[nodiscard]] bool try_push(U &&item) noexcept {
+      ::std::size_t pos = tail_.load(::std::memory_order_relaxed);
+      for (;;) {
+         slot &s = slots_[pos & mask];
+         ::std::size_t const seq = s.seq.load(::std::memory_order_acquire);
+         auto const diff = static_cast<::std::ptrdiff_t>(seq - pos);
+         if (diff == 0) {
+            if (tail_.compare_exchange_weak(pos, pos + 1,
+                                            ::std::memory_order_relaxed))
+            {
+               ::new (s.item.bytes) T(::std::forward<U>(item));
+               s.seq.store(pos + 1, ::std::memory_order_release);
+               wakeup_.notify();
+               return true;
+            }
+         } else if (diff < 0) {
+            // The consumer hasn't emptied this slot from last time around.
+            return false;
+         } else {
+            pos = tail_.load(::std::memory_order_relaxed);
+         }
+      }
+   }
+
+   //! Consumer only. Returns false if the queue is empty.
+   [[nodiscard]] bool try_pop(T &out) noexcept {
+      ::std::size_t const pos = head_;
+      slot &s = slots_[pos & mask];
+      if (s.seq.load(::std::memory_order_acquire) != pos + 1) {
+         return false;
+      }
+      T *const item = s.item.get();
+      out = ::std::move(*item);
+      item->~T();
+      s.seq.store(pos + Capacity, ::std::memory_order_release);
+      head_ = pos + 1;
+      return true;
+   }
+
+   /**
+    * \brief Consumer only. Whether there's nothing to pop right now.
+    *
+    * A slot a producer has claimed but not finished writing counts as empty.
+    * That producer's notification will follow.
+    */
+   [[nodiscard]] bool empty() const noexcept {
+      return slots_[head_ & mask].seq.load(::std::memory_order_acquire)
+             != head_ + 1;
+   }
+
+   //! Consumer only. Wait for an item and take it.
+   expected<void> pop(T &out) noexcept
+   requires ::std::same_as<Wakeup, futex_wakeup>
+   {
+      while (!try_pop(out)) {
+         auto result = wakeup_.wait_while([this]() noexcept {
+            return empty();
+         });
+         if (result.has_error()) {
+            return result;
+         }
+      }
+      return expected<void>{};
+   }
+
+   //! Consumer only. See `eventfd_wakeup::arm`.
+   [[nodiscard]] bool arm() noexcept
+   requires ::std::same_as<Wakeup, eventfd_wakeup>
+   {
+      return wakeup_.arm([this]() noexcept { return empty(); });
+   }
+
+   [[nodiscard]] Wakeup &get_wakeup() noexcept { return wakeup_; }
+
+ private:
+   static constexpr ::std::size_t mask = Capacity - 1;
+
+   struct slot {
+      ::std::atomic<::std::size_t> seq;
+      priv_::ring_slot<T> item;
+   };
+
+   void init_slots() noexcept {
+      for (::std::size_t i = 0; i < Capacity; ++i) {
+         slots_[i].seq.store(i, ::std::memory_order_relaxed);
+      }
+   }
+
+   // Only the consumer touches this.
+   alignas(64) ::std::size_t head_ = 0;
+   // Producers claim slots by bumping this.
+   alignas(64) ::std::atomic<::std::size_t> tail_ = 0;
+   alignas(64) Wakeup wakeup_;
+   alignas(64) slot slots_[Capacity];
+};
+
+} // namespace posixpp
@@ -0,0 +1,12 @@
+#pragma once  /*-*-c++-*-*/
+
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+#include <syscalls/linux/x86_64/rwflags.h>
+
+namespace posixpp {
+
+using ::syscalls::linux::x86_64::rwflags;
+
+} // namespace posixpp
@@ -0,0 +1,130 @@
+// Copyright 2021 Eric Hopper
+// Distributed under the terms of the LGPLv3.
+
+#pragma once  /*-*-c++-*-*/
+
+#include <posixpp/expected.h>
+#include <posixpp/futex.h>
+#include <syscalls/linux/time.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <system_error>
+
+namespace posixpp {
+
+/**
+ * \brief A counting semaphore in one 32 bit word, like
+ * `::std::counting_semaphore`.
+ *
+ * The word is the count plus a bit saying somebody might be asleep waiting
+ * for it to go up. `release` only calls the kernel when that bit is set. It
+ * clears the bit and wakes as many waiters as it added to the count, and
+ * each woken waiter sets the bit again as it takes one, in case it wasn't
+ * the only one asleep. That's the same trick `posixpp::mutex` uses.
+ */
+template <::std::ptrdiff_t LeastMaxValue = 0x7fff'ffff>
+requires (LeastMaxValue >= 0 && LeastMaxValue <= 0x7fff'ffff)
+class counting_semaphore {
+ public:
+   static constexpr ::std::ptrdiff_t max() noexcept { return count_mask; }
+
+   //! `desired` must be between 0 and `max()`.
+   constexpr explicit counting_semaphore(::std::ptrdiff_t desired) noexcept
+        : word_{static_cast<::std::uint32_t>(desired)}
+   {}
+   counting_semaphore(counting_semaphore const &) = delete;
+   counting_semaphore &operator =(counting_semaphore const &) = delete;
+
+   //! Add `update` to the count, waking that many waiters if there are any.
+   expected<void> release(::std::ptrdiff_t update = 1) noexcept {
+      auto const inc = static_cast<::std::uint32_t>(update);
+      ::std::uint32_t c = word_.load(::std::memory_order_relaxed);
+      while (!word_.compare_exchange_weak(c, (c + inc) & count_mask,
+                                          ::std::memory_order_release,
+                                          ::std::memory_order_relaxed))
+      {}
+      if ((c & waiting) != 0) {
+         return error_cascade_void(
+              futex_wake(word_, static_cast<int>(update))
+         );
+      }
+      return expected<void>{};
+   }
+
+   //! Take one from the count, never waits.
+   [[nodiscard]] bool try_acquire() noexcept {
+      ::std::uint32_t c = word_.load(::std::memory_order_relaxed);
+      while ((c & count_mask) != 0) {
+         if (word_.compare_exchange_weak(c, c - 1,
+                                         ::std::memory_order_acquire,
+                                         ::std::memory_order_relaxed))
+         {
+            return true;
+         }
+      }
+      return false;
+   }
+
+   //! Take one from the count, waiting for it to be more than zero.
+   expected<void> acquire() noexcept {
+      if (try_acquire()) {
+         return expected<void>{};
+      }
+      return acquire_slow(nullptr);
+   }
+
+   /**
+    * \brief Like `acquire`, but gives up with `ETIMEDOUT` at `deadline`, an
+    * absolute `CLOCK_MONOTONIC` time.
+    */
+   expected<void>
+   try_acquire_until(::syscalls::linux::timespec const &deadline) noexcept {
+      if (try_acquire()) {
+         return expected<void>{};
+      }
+      return acquire_slow(&deadline);
+   }
+
+ private:
+   static constexpr ::std::uint32_t waiting = 0x8000'0000U;
+   static constexpr ::std::uint32_t count_mask = waiting - 1;
+
+   expected<void>
+   acquire_slow(::syscalls::linux::timespec const *deadline) noexcept {
+      ::std::uint32_t c = word_.load(::std::memory_order_relaxed);
+      for (;;) {
+         if ((c & count_mask) != 0) {
+            // There's no telling if this was the last waiter, so leave the
+            // bit set for the next release to check.
+            if (word_.compare_exchange_weak(c, (c - 1) | waiting,
+                                            ::std::memory_order_acquire,
+                                            ::std::memory_order_relaxed))
+            {
+               return expected<void>{};
+            }
+            continue;
+         }
+         if ((c & waiting) == 0
+             && !word_.compare_exchange_weak(c, waiting,
+                                             ::std::memory_order_relaxed))
+         {
+            continue;
+         }
+         auto const result = deadline == nullptr
+                             ? futex_wait(word_, waiting)
+                             : futex_wait_until(word_, waiting, *deadline);
+         if (priv_::is_real_wait_error(result)) {
+            return result;
+         }
+         c = word_.load(::std::memory_order_relaxed);
+      }
+   }
+
+   futex_word word_;
+};
+
+//! A semaphore that's either 0 or 1.
+using binary_semaphore = counting_semaphore<1>;
+
+} // namespace posixpp
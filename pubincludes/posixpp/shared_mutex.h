@@ -0,0 +1,168 @@
+// Copyright 2021 Eric Hopper
+// Distributed under the terms of the LGPLv3.
+
+#pragma once  /*-*-c++-*-*/
+
+#include <posixpp/expected.h>
+#include <posixpp/futex.h>
+#include <atomic>
+#include <climits>
+#include <cstdint>
+
+namespace posixpp {
+
+/**
+ * \brief A readers-writer lock in one 32 bit word that prefers writers, like
+ * `::std::shared_mutex`.
+ *
+ * The word holds how many readers have the lock, how many writers are
+ * waiting for it, a bit for a writer having it, and a bit saying somebody
+ * might be asleep. New readers wait as long as any writer is waiting, so a
+ * steady stream of readers can't starve the writers. Unlocking only calls the
+ * kernel when the sleeping bit is set, and then wakes everybody, who sort out
+ * among themselves who's next.
+ *
+ * There can be up to about a million readers at once and 1023 waiting
+ * writers.
+ *
+ * It meets the standard SharedLockable requirements, so `::std::shared_lock`
+ * works with it. Like `posixpp::mutex`, the errors the lock functions can
+ * return should never happen.
+ */
+class shared_mutex {
+ public:
+   constexpr shared_mutex() noexcept = default;
+   shared_mutex(shared_mutex const &) = delete;
+   shared_mutex &operator =(shared_mutex const &) = delete;
+
+   //! Take the lock exclusively, never calls the kernel.
+   [[nodiscard]] bool try_lock() noexcept {
+      ::std::uint32_t c = word_.load(::std::memory_order_relaxed);
+      return (c & (reader_mask | writer_mask | writer_locked)) == 0
+             && word_.compare_exchange_strong(c, c | writer_locked,
+                                              ::std::memory_order_acquire,
+                                              ::std::memory_order_relaxed);
+   }
+
+   //! Take the lock exclusively, sleeping if needed.
+   expected<void> lock() noexcept {
+      if (try_lock()) {
+         return expected<void>{};
+      }
+      return lock_slow();
+   }
+
+   expected<void> unlock() noexcept {
+      ::std::uint32_t const old = word_.fetch_and(~(writer_locked | sleeping),
+                                                  ::std::memory_order_release);
+      if ((old & sleeping) != 0) {
+         return error_cascade_void(futex_wake(word_, INT_MAX));
+      }
+      return expected<void>{};
+   }
+
+   //! Take the lock shared, never calls the kernel.
+   [[nodiscard]] bool try_lock_shared() noexcept {
+      ::std::uint32_t c = word_.load(::std::memory_order_relaxed);
+      while ((c & (writer_mask | writer_locked)) == 0) {
+         if (word_.compare_exchange_weak(c, c + one_reader,
+                                         ::std::memory_order_acquire,
+                                         ::std::memory_order_relaxed))
+         {
+            return true;
+         }
+      }
+      return false;
+   }
+
+   //! Take the lock shared, sleeping while a writer has it or wants it.
+   expected<void> lock_shared() noexcept {
+      if (try_lock_shared()) {
+         return expected<void>{};
+      }
+      for (;;) {
+         ::std::uint32_t c = word_.load(::std::memory_order_relaxed);
+         if ((c & (writer_mask | writer_locked)) == 0) {
+            if (word_.compare_exchange_weak(c, c + one_reader,
+                                            ::std::memory_order_acquire,
+                                            ::std::memory_order_relaxed))
+            {
+               return expected<void>{};
+            }
+            continue;
+         }
+         if (auto result = sleep(c); result.has_error()) {
+            return result;
+         }
+      }
+   }
+
+   //! Release a shared lock, waking everybody if it was the last reader and
+   //! somebody's asleep.
+   expected<void> unlock_shared() noexcept {
+      ::std::uint32_t c = word_.load(::std::memory_order_relaxed);
+      ::std::uint32_t next;
+      do {
+         next = c - one_reader;
+         if ((next & reader_mask) == 0) {
+            next &= ~sleeping;
+         }
+      } while (!word_.compare_exchange_weak(c, next,
+                                            ::std::memory_order_release,
+                                            ::std::memory_order_relaxed));
+      if ((c & sleeping) != 0 && (next & sleeping) == 0) {
+         return error_cascade_void(futex_wake(word_, INT_MAX));
+      }
+      return expected<void>{};
+   }
+
+ private:
+   static constexpr ::std::uint32_t one_reader = 1;
+   static constexpr ::std::uint32_t reader_mask = (1U << 20) - 1;
+   static constexpr ::std::uint32_t one_writer = 1U << 20;
+   static constexpr ::std::uint32_t writer_mask = ((1U << 10) - 1) << 20;
+   static constexpr ::std::uint32_t writer_locked = 1U << 30;
+   static constexpr ::std::uint32_t sleeping = 1U << 31;
+
+   expected<void> lock_slow() noexcept {
+      // Register as a waiting writer, which holds off new readers.
+      ::std::uint32_t c = word_.fetch_add(one_writer,
+                                          ::std::memory_order_relaxed);
+      c += one_writer;
+      for (;;) {
+         if ((c & (reader_mask | writer_locked)) == 0) {
+            if (word_.compare_exchange_weak(
+                      c, (c - one_writer) | writer_locked,
+                      ::std::memory_order_acquire, ::std::memory_order_relaxed))
+            {
+               return expected<void>{};
+            }
+            continue;
+         }
+         if (auto result = sleep(c); result.has_error()) {
+            word_.fetch_sub(one_writer, ::std::memory_order_relaxed);
+            return result;
+         }
+         c = word_.load(::std::memory_order_relaxed);
+      }
+   }
+
+   //! Set the sleeping bit and sleep, if the word is still `c`.
+   expected<void> sleep(::std::uint32_t c) noexcept {
+      if ((c & sleeping) == 0
+          && !word_.compare_exchange_strong(c, c | sleeping,
+                                            ::std::memory_order_relaxed))
+      {
+         return expected<void>{};
+      }
+      auto const result = futex_wait(word_, c | sleeping);
+      if (priv_::is_real_wait_error(result)) {
+         return result;
+      }
+      return expected<void>{};
+   }
+
+   futex_word word_ = 0;
+};
+
+} // namespace posixpp
@@ -4,10 +4,15 @@
 #pragma once
 
 #include <posixpp/fd.h>
+#include <posixpp/rwflags.h>
 #include <syscalls/linux/simple_io.h>
+#include <span>
 
 namespace posixpp {
 
+using ::syscalls::linux::iovec;
+using ::syscalls::linux::const_iovec;
+
 //! See write(2)
 expected<::std::size_t>
 inline write(fd const &file, char const *buf, ::std::size_t size) noexcept {
@@ -24,6 +29,84 @@ inline read(fd const &file, char *buf, ::std::size_t size) noexcept {
                         [](auto r) { return static_cast<::std::size_t>(r);});
 }
 
+/**
+ * \name Positional and scatter/gather I/O
+ *
+ * The positional versions read or write at the given offset without using or
+ * changing the file position, so several threads can share one file
+ * descriptor without racing on it.
+ *
+ * Like `read` and `write`, these can transfer less than was asked for, and
+ * return how much they did transfer.
+ */
+///@{
+//! See pread(2)
+expected<::std::size_t>
+inline pread(fd const &file, char *buf, ::std::size_t size,
+             ::std::int64_t offset) noexcept {
+   using posixpp::error_cascade;
+   return error_cascade(::syscalls::linux::pread64(file.as_fd(), buf, size, offset),
+                        [](auto r) { return static_cast<::std::size_t>(r);});
+}
+
+//! See pwrite(2)
+expected<::std::size_t>
+inline pwrite(fd const &file, char const *buf, ::std::size_t size,
+              ::std::int64_t offset) noexcept {
+   using posixpp::error_cascade;
+   return error_cascade(::syscalls::linux::pwrite64(file.as_fd(), buf, size, offset),
+                        [](auto r) { return static_cast<::std::size_t>(r);});
+}
+
+//! See readv(2)
+expected<::std::size_t>
+inline readv(fd const &file, ::std::span<iovec const> iov) noexcept {
+   using posixpp::error_cascade;
+   auto const count = static_cast<int>(iov.size());
+   return error_cascade(::syscalls::linux::readv(file.as_fd(), iov.data(), count),
+                        [](auto r) { return static_cast<::std::size_t>(r);});
+}
+
+//! See writev(2)
+expected<::std::size_t>
+inline writev(fd const &file, ::std::span<const_iovec const> iov) noexcept {
+   using posixpp::error_cascade;
+   auto const count = static_cast<int>(iov.size());
+   return error_cascade(::syscalls::linux::writev(file.as_fd(), iov.data(), count),
+                        [](auto r) { return static_cast<::std::size_t>(r);});
+}
+
+/**
+ * \brief See preadv2(2)
+ *
+ * With `rwflags::nowait` this fails with `EAGAIN` instead of blocking if the
+ * data isn't already in the page cache, which lets an event loop try the fast
+ * path inline. An `offset` of -1 uses (and updates) the file position.
+ */
+expected<::std::size_t>
+inline preadv2(fd const &file, ::std::span<iovec const> iov,
+               ::std::int64_t offset, rwflags flags = rwflags{}) noexcept {
+   using posixpp::error_cascade;
+   auto const count = static_cast<int>(iov.size());
+   auto const bits = static_cast<int>(flags.getbits());
+   return error_cascade(::syscalls::linux::preadv2(file.as_fd(), iov.data(),
+                                                   count, offset, bits),
+                        [](auto r) { return static_cast<::std::size_t>(r);});
+}
+
+//! See pwritev2(2), an `offset` of -1 uses (and updates) the file position.
+expected<::std::size_t>
+inline pwritev2(fd const &file, ::std::span<const_iovec const> iov,
+                ::std::int64_t offset, rwflags flags = rwflags{}) noexcept {
+   using posixpp::error_cascade;
+   auto const count = static_cast<int>(iov.size());
+   auto const bits = static_cast<int>(flags.getbits());
+   return error_cascade(::syscalls::linux::pwritev2(file.as_fd(), iov.data(),
+                                                    count, offset, bits),
+                        [](auto r) { return static_cast<::std::size_t>(r);});
+}
+///@}
+
 ///@{
 [[nodiscard]] expected<fd>
 inline openat(fd const &dirfd, char const *pathname,
@@ -0,0 +1,172 @@
+// Copyright 2021 Eric Hopper
+// Distributed under the terms of the LGPLv3.
+
+#pragma once  /*-*-c++-*-*/
+
+#include <posixpp/expected.h>
+#include <posixpp/fd.h>
+#include <posixpp/simpleio.h>
+#include <syscalls/linux/syscall.h>
+#include <syscalls/linux/x86_64/syscall_stats.h>
+#include <atomic>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <system_error>
+
+/**
+ * \file
+ * \brief Per system call counts, errors and latency histograms.
+ *
+ * These are only collected if `POSIXPP_SYSCALL_STATS` is defined for the whole
+ * program. Otherwise everything here still works, but all the counts stay
+ * zero, and `syscall_expected` compiles to exactly what it would anyway.
+ *
+ * Counting costs a couple of `rdtsc` instructions and a few relaxed atomic
+ * increments per call, instead of the 10x slowdown of strace.
+ */
+
+namespace posixpp::syscall_stats {
+
+using ::syscalls::linux::x86_64::stats::call_stats;
+using ::syscalls::linux::x86_64::stats::max_calls;
+using ::syscalls::linux::x86_64::stats::max_errno;
+using ::syscalls::linux::x86_64::stats::latency_buckets;
+using ::syscalls::linux::call_id;
+
+//! Whether this program is collecting anything.
+#ifdef POSIXPP_SYSCALL_STATS
+inline constexpr bool enabled = true;
+#else
+inline constexpr bool enabled = false;
+#endif
+
+/**
+ * \brief A copy of the counters for `callnum`, optionally setting them to
+ * zero at the same time.
+ *
+ * Each counter is read (and reset) atomically, but not all of them together,
+ * so calls made at the same time by other threads might be partly counted.
+ */
+[[nodiscard]] inline call_stats
+snapshot(call_id callnum, bool reset = false) noexcept
+{
+   auto const idx = static_cast<unsigned>(callnum);
+   call_stats result{};
+   if (idx >= max_calls) {
+      return result;
+   }
+   auto &live = ::syscalls::linux::x86_64::stats::table[idx];
+   auto take = [reset](::std::uint64_t &counter) {
+      ::std::atomic_ref<::std::uint64_t> ref{counter};
+      return reset ? ref.exchange(0, ::std::memory_order_relaxed)
+                   : ref.load(::std::memory_order_relaxed);
+   };
+   result.calls = take(live.calls);
+   result.errors = take(live.errors);
+   for (unsigned i = 0; i < max_errno; ++i) {
+      result.errno_counts[i] = take(live.errno_counts[i]);
+   }
+   for (unsigned i = 0; i < latency_buckets; ++i) {
+      result.latency[i] = take(live.latency[i]);
+   }
+   return result;
+}
+
+//! Set every counter for every system call to zero.
+inline void reset() noexcept
+{
+   for (unsigned i = 0; i < max_calls; ++i) {
+      (void)snapshot(static_cast<call_id>(i), true);
+   }
+}
+
+namespace priv_ {
+//! Appends text to a fixed buffer, remembering if it ran out of room.
+class line_buffer {
+ public:
+   void append(char const *text) noexcept {
+      for (; *text != '\0' && used_ < sizeof(buf_); ++text) {
+         buf_[used_++] = *text;
+      }
+   }
+   void append(::std::uint64_t n) noexcept {
+      auto const [end, ec] = ::std::to_chars(buf_ + used_,
+                                             buf_ + sizeof(buf_), n);
+      if (ec == ::std::errc{}) {
+         used_ = static_cast<::std::size_t>(end - buf_);
+      }
+   }
+
+   expected<void> write_to(fd const &out) noexcept {
+      char const *next = buf_;
+      while (used_ > 0) {
+         auto const written = write(out, next, used_);
+         if (written.has_error()) {
+            if (written.error() == static_cast<int>(::std::errc::interrupted)) {
+               continue;
+            }
+            return expected<void>{written.error()};
+         }
+         next += written.result();
+         used_ -= written.result();
+      }
+      return expected<void>{};
+   }
+
+ private:
+   char buf_[4096];
+   ::std::size_t used_ = 0;
+};
+} // namespace priv_
+
+/**
+ * \brief Write a line for every system call that's been made to `out`.
+ *
+ * Each line is the system call number followed by `name=value` fields, with
+ * only the non-zero error and latency counts:
+ *
+ *     0 calls=12 errors=1 errno.9=1 cycles.lt.2**11=3 cycles.lt.2**12=9
+ *
+ * `cycles.lt.2**N` counts calls that took fewer than 2**N cycles, and at least
+ * half that. The writes this does are counted too, but only after their line
+ * has been taken.
+ */
+inline expected<void> dump(fd const &out, bool reset = false) noexcept
+{
+   for (unsigned i = 0; i < max_calls; ++i) {
+      call_stats const stats = snapshot(static_cast<call_id>(i), reset);
+      if (stats.calls == 0) {
+         continue;
+      }
+      priv_::line_buffer line;
+      line.append(i);
+      line.append(" calls=");
+      line.append(stats.calls);
+      line.append(" errors=");
+      line.append(stats.errors);
+      for (unsigned e = 0; e < max_errno; ++e) {
+         if (stats.errno_counts[e] != 0) {
+            line.append(" errno.");
+            line.append(e);
+            line.append("=");
+            line.append(stats.errno_counts[e]);
+         }
+      }
+      for (unsigned b = 0; b < latency_buckets; ++b) {
+         if (stats.latency[b] != 0) {
+            line.append(" cycles.lt.2**");
+            line.append(b);
+            line.append("=");
+            line.append(stats.latency[b]);
+         }
+      }
+      line.append("\n");
+      if (auto const written = line.write_to(out); written.has_error()) {
+         return written;
+      }
+   }
+   return expected<void>{};
+}
+
+} // namespace posixpp::syscall_stats
@@ -0,0 +1,257 @@
+// Copyright 2021 Eric Hopper
+// Distributed under the terms of the LGPLv3.
+
+#pragma once  /*-*-c++-*-*/
+
+#include <posixpp/frame_pool.h>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <tuple>
+#include <utility>
+
+namespace posixpp {
+
+template <typename T>
+class task;
+
+namespace priv_ {
+
+/**
+ * \brief Allocates coroutine frames, from a `frame_pool` if the coroutine
+ * asks for one.
+ *
+ * A coroutine asks for a pool by following the `::std::allocator_arg`
+ * convention, making its first two parameters (after `this`, for a member
+ * function) `::std::allocator_arg_t` and `frame_pool &`. Every frame starts
+ * with a header saying which pool, if any, it came from.
+ */
+struct task_frame_allocation {
+   struct alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) header {
+      frame_pool *pool;
+   };
+
+   // Every frame is allocated and freed by this one pair, pool or not. They're
+   // kept out of line so the compiler never sees a pool's memory or
+   // `::operator new`'s handed to a frame's `operator delete` and warns about
+   // a mismatch, not knowing the header sends it back to the right place.
+   [[gnu::noinline]] static void *allocate(frame_pool *pool,
+                                           ::std::size_t size)
+   {
+      size += sizeof(header);
+      void *const block = pool ? pool->allocate(size) : ::operator new(size);
+      auto *const hdr = ::new (block) header{pool};
+      return hdr + 1;
+   }
+
+   [[gnu::noinline]] static void deallocate(void *frame,
+                                            ::std::size_t size) noexcept
+   {
+      auto *const hdr = static_cast<header *>(frame) - 1;
+      frame_pool *const pool = hdr->pool;
+      size += sizeof(header);
+      if (pool) {
+         pool->deallocate(hdr, size);
+      } else {
+         ::operator delete(static_cast<void *>(hdr));
+      }
+   }
+
+   static void *operator new(::std::size_t size) {
+      return allocate(nullptr, size);
+   }
+
+   static void operator delete(void *frame, ::std::size_t size) noexcept {
+      deallocate(frame, size);
+   }
+};
+
+//! The parts of a task's promise that don't depend on the result type.
+struct task_promise_base : task_frame_allocation {
+   //! Resumes whoever was waiting for the task to finish.
+   struct final_awaiter {
+      [[nodiscard]] bool await_ready() const noexcept { return false; }
+
+      template <typename Promise>
+      ::std::coroutine_handle<>
+      await_suspend(::std::coroutine_handle<Promise> finished) noexcept {
+         auto const next = finished.promise().continuation_;
+         return next ? next : ::std::noop_coroutine();
+      }
+
+      void await_resume() const noexcept {}
+   };
+
+   ::std::suspend_always initial_suspend() const noexcept { return {}; }
+   final_awaiter final_suspend() const noexcept { return {}; }
+   //! Errors are reported with `expected`, an exception here is a bug.
+   void unhandled_exception() const noexcept { ::std::terminate(); }
+
+   ::std::coroutine_handle<> continuation_;
+};
+
+template <typename T>
+struct task_promise : task_promise_base {
+   task<T> get_return_object() noexcept;
+
+   template <typename U>
+   void return_value(U &&value) { value_.emplace(::std::forward<U>(value)); }
+
+   T take_result() { return ::std::move(*value_); }
+
+   ::std::optional<T> value_;
+};
+
+template <>
+struct task_promise<void> : task_promise_base {
+   task<void> get_return_object() noexcept;
+
+   void return_void() const noexcept {}
+   void take_result() const noexcept {}
+};
+
+/**
+ * \brief The promise for a task whose coroutine takes a `frame_pool`, with
+ * the pool at `PoolAt` in its parameter types, `Params`.
+ *
+ * The `::std::coroutine_traits` specializations below pick this. Knowing the
+ * parameters means `operator new` doesn't have to be a template to take them,
+ * which GCC 12 would warn about pairing with any `operator delete`.
+ */
+template <typename T, ::std::size_t PoolAt, typename... Params>
+struct pooled_task_promise : task_promise<T> {
+   task<T> get_return_object() noexcept;
+
+   static void *operator new(::std::size_t size, Params const &...params) {
+      frame_pool &pool = ::std::get<PoolAt>(::std::tie(params...));
+      return task_frame_allocation::allocate(&pool, size);
+   }
+
+   static void operator delete(void *frame, ::std::size_t size) noexcept {
+      task_frame_allocation::deallocate(frame, size);
+   }
+};
+
+} // namespace priv_
+
+/**
+ * \brief A coroutine that produces a `T`, which doesn't start until it's
+ * awaited (or started by an event loop).
+ *
+ * Awaiting a task from another task transfers control directly from one to
+ * the other, and back when it finishes, without growing the stack.
+ *
+ * Exceptions escaping from the coroutine terminate the program, errors are
+ * supposed to be returned as `expected` values.
+ */
+template <typename T>
+class [[nodiscard]] task {
+ public:
+   using promise_type = priv_::task_promise<T>;
+
+   task(task &&other) noexcept
+        : handle_{::std::exchange(other.handle_, nullptr)},
+          promise_{other.promise_}
+   {}
+   task &operator =(task &&other) noexcept {
+      if (this != &other) {
+         if (handle_) {
+            handle_.destroy();
+         }
+         handle_ = ::std::exchange(other.handle_, nullptr);
+         promise_ = other.promise_;
+      }
+      return *this;
+   }
+   ~task() {
+      if (handle_) {
+         handle_.destroy();
+      }
+   }
+
+   //! Run the coroutine until it first suspends, for use by event loops.
+   void start() noexcept { handle_.resume(); }
+
+   //! Whether the coroutine has returned.
+   [[nodiscard]] bool done() const noexcept { return handle_.done(); }
+
+   //! What the coroutine returned, which can only be taken once.
+   T result() { return promise_->take_result(); }
+
+   auto operator co_await() && noexcept {
+      struct awaiter {
+         ::std::coroutine_handle<> handle_;
+         promise_type *promise_;
+
+         [[nodiscard]] bool await_ready() const noexcept { return false; }
+         ::std::coroutine_handle<>
+         await_suspend(::std::coroutine_handle<> waiting) noexcept {
+            promise_->continuation_ = waiting;
+            return handle_;
+         }
+         T await_resume() { return promise_->take_result(); }
+      };
+      return awaiter{handle_, promise_};
+   }
+
+ private:
+   friend promise_type;
+   template <typename, ::std::size_t, typename...>
+   friend struct priv_::pooled_task_promise;
+
+   // The promise may be a `pooled_task_promise`, so the handle doesn't say.
+   template <typename Promise>
+   explicit task(::std::coroutine_handle<Promise> handle) noexcept
+        : handle_{handle}, promise_{&handle.promise()}
+   {}
+
+   ::std::coroutine_handle<> handle_;
+   promise_type *promise_;
+};
+
+namespace priv_ {
+template <typename T>
+task<T> task_promise<T>::get_return_object() noexcept
+{
+   return task<T>{::std::coroutine_handle<task_promise>::from_promise(*this)};
+}
+
+inline task<void> task_promise<void>::get_return_object() noexcept
+{
+   return task<void>{
+        ::std::coroutine_handle<task_promise>::from_promise(*this)
+   };
+}
+
+template <typename T, ::std::size_t PoolAt, typename... Params>
+task<T> pooled_task_promise<T, PoolAt, Params...>::get_return_object() noexcept
+{
+   return task<T>{
+        ::std::coroutine_handle<pooled_task_promise>::from_promise(*this)
+   };
+}
+} // namespace priv_
+
+} // namespace posixpp
+
+//! A task coroutine that takes a `frame_pool`.
+template <typename T, typename... Args>
+struct std::coroutine_traits<::posixpp::task<T>, ::std::allocator_arg_t,
+                             ::posixpp::frame_pool &, Args...>
+{
+   using promise_type = ::posixpp::priv_::pooled_task_promise<
+        T, 1, ::std::allocator_arg_t, ::posixpp::frame_pool &, Args...
+   >;
+};
+
+//! A member function task coroutine that takes a `frame_pool`.
+template <typename T, typename This, typename... Args>
+struct std::coroutine_traits<::posixpp::task<T>, This, ::std::allocator_arg_t,
+                             ::posixpp::frame_pool &, Args...>
+{
+   using promise_type = ::posixpp::priv_::pooled_task_promise<
+        T, 2, This, ::std::allocator_arg_t, ::posixpp::frame_pool &, Args...
+   >;
+};
@@ -0,0 +1,453 @@
+// Copyright 2021 Eric Hopper
+// Distributed under the terms of the LGPLv3.
+
+#pragma once  /*-*-c++-*-*/
+
+#include <posixpp/expected.h>
+#include <posixpp/auxv.h>
+#include <posixpp/futex.h>
+#include <posixpp/mutex.h>
+#include <posixpp/mmapflags.h>
+#include <syscalls/linux/memory.h>
+#include <syscalls/linux/elf.h>
+#include <syscalls/linux/x86_64/clone.h>
+#include <atomic>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+namespace posixpp {
+
+using ::syscalls::linux::x86_64::cloneflags;
+
+//! A region of memory to use as a thread's stack.
+struct thread_stack {
+   //! Lowest address, where the guard page is.
+   char *base = nullptr;
+   //! Size of the whole region, including the guard page.
+   ::std::size_t size = 0;
+};
+
+/**
+ * \brief Recycles thread stacks so starting a thread doesn't need an mmap and
+ * finishing one doesn't need a munmap.
+ *
+ * Every stack has an inaccessible guard page at the bottom so an overflow
+ * crashes instead of silently corrupting memory. Stacks beyond `max_cached`
+ * are unmapped when they're released instead of being kept.
+ *
+ * The destructor doesn't unmap anything, so that a pool can be a global
+ * variable without needing an `atexit` handler. Call `trim` to give cached
+ * stacks back to the kernel.
+ */
+class stack_pool {
+ public:
+   static constexpr ::std::size_t page_size = 4096;
+   static constexpr ::std::size_t default_stack_size = 256 * 1024;
+
+   constexpr explicit stack_pool(::std::size_t stack_size = default_stack_size,
+                                 unsigned max_cached = 16) noexcept
+        : stack_size_{round_to_page(stack_size) + page_size},
+          max_cached_{max_cached}
+   {}
+   stack_pool(stack_pool const &) = delete;
+   stack_pool &operator =(stack_pool const &) = delete;
+
+   //! Size of every stack from this pool, including the guard page.
+   [[nodiscard]] ::std::size_t stack_size() const noexcept {
+      return stack_size_;
+   }
+
+   //! How many stacks are waiting to be reused.
+   [[nodiscard]] unsigned cached() const noexcept {
+      ::std::lock_guard<mutex> lock{lock_};
+      return ncached_;
+   }
+
+   //! Get a cached stack, or map a new one.
+   [[nodiscard]] expected<thread_stack> acquire() noexcept {
+      {
+         ::std::lock_guard<mutex> lock{lock_};
+         if (free_ != nullptr) {
+            free_node *const node = free_;
+            free_ = node->next;
+            --ncached_;
+            return expected<thread_stack>{stack_of(node)};
+         }
+      }
+      return map_stack();
+   }
+
+   //! Give back a stack that came from `acquire`.
+   void release(thread_stack stk) noexcept {
+      {
+         ::std::lock_guard<mutex> lock{lock_};
+         if (ncached_ < max_cached_) {
+            auto *const node = ::new (node_of(stk)) free_node{free_};
+            free_ = node;
+            ++ncached_;
+            return;
+         }
+      }
+      static_cast<void>(::syscalls::linux::munmap(stk.base, stk.size));
+   }
+
+   //! Unmap all cached stacks.
+   void trim() noexcept {
+      free_node *list;
+      {
+         ::std::lock_guard<mutex> lock{lock_};
+         list = ::std::exchange(free_, nullptr);
+         ncached_ = 0;
+      }
+      while (list != nullptr) {
+         free_node *const next = list->next;
+         thread_stack const stk = stack_of(list);
+         static_cast<void>(::syscalls::linux::munmap(stk.base, stk.size));
+         list = next;
+      }
+   }
+
+ private:
+   //! Lives at the very top of a cached stack.
+   struct free_node {
+      free_node *next;
+   };
+
+   static constexpr ::std::size_t round_to_page(::std::size_t size) noexcept {
+      return (size + page_size - 1) & ~(page_size - 1);
+   }
+
+   [[nodiscard]] void *node_of(thread_stack const &stk) const noexcept {
+      return stk.base + stk.size - sizeof(free_node);
+   }
+   [[nodiscard]] thread_stack stack_of(free_node *node) const noexcept {
+      char *const top = reinterpret_cast<char *>(node) + sizeof(free_node);
+      return thread_stack{top - stack_size_, stack_size_};
+   }
+
+   [[nodiscard]] expected<thread_stack> map_stack() const noexcept {
+      namespace sl = ::syscalls::linux;
+      using errtag = expected<thread_stack>::err_tag;
+      auto const prot = protflags::read | protflags::write;
+      auto const flags = mapflags::private_ | mapflags::anonymous
+                         | mapflags::stack | mapflags::noreserve;
+      auto mapped = sl::mmap(nullptr, stack_size_,
+                             prot.getbits(), flags.getbits(), -1, 0);
+      if (mapped.has_error()) {
+         return expected<thread_stack>{errtag{}, mapped.error()};
+      }
+      auto *const base = reinterpret_cast<char *>(mapped.result().val);
+      auto guarded = sl::mprotect(base, page_size, protflags::none.getbits());
+      if (guarded.has_error()) {
+         static_cast<void>(sl::munmap(base, stack_size_));
+         return expected<thread_stack>{errtag{}, guarded.error()};
+      }
+      return expected<thread_stack>{thread_stack{base, stack_size_}};
+   }
+
+   mutable mutex lock_;
+   free_node *free_ = nullptr;
+   unsigned ncached_ = 0;
+   ::std::size_t stack_size_;
+   unsigned max_cached_;
+};
+
+//! The pool used when a thread is started without naming one.
+inline constinit stack_pool default_stack_pool{};
+
+namespace priv_ {
+
+/**
+ * \brief The start of the thread control block `%fs` points at.
+ *
+ * The compiler relies on the self pointer at `%fs:0` for thread local
+ * variables, and the stack protector reads its canary from `%fs:0x28`. The
+ * layout matches glibc's as far as those go.
+ */
+struct alignas(64) thread_tcb {
+   thread_tcb *self;
+   void *dtv;
+   thread_tcb *self2;
+   ::std::uint64_t reserved[2];
+   ::std::uintptr_t stack_guard;
+   ::std::uintptr_t pointer_guard;
+};
+static_assert(offsetof(thread_tcb, stack_guard) == 0x28);
+
+//! The process's stack canary and pointer guard, once `current_guards` has
+//! looked them up.
+inline constinit ::std::atomic<bool> guards_known = false;
+inline constinit ::std::atomic<::std::uintptr_t> known_stack_guard = 0;
+inline constinit ::std::atomic<::std::uintptr_t> known_pointer_guard = 0;
+
+/**
+ * \brief The stack canary and pointer guard, if the calling thread has a TCB.
+ *
+ * They're the same in every thread of the process, so the system call to find
+ * the TCB is only made the first time.
+ */
+inline void current_guards(::std::uintptr_t &stack_guard,
+                           ::std::uintptr_t &pointer_guard) noexcept
+{
+   namespace x86 = ::syscalls::linux::x86_64;
+   if (guards_known.load(::std::memory_order_acquire)) {
+      stack_guard = known_stack_guard.load(::std::memory_order_relaxed);
+      pointer_guard = known_pointer_guard.load(::std::memory_order_relaxed);
+      return;
+   }
+   ::std::uintptr_t fsbase = 0;
+   auto const r = x86::arch_prctl(x86::arch_prctl_code::get_fs, &fsbase);
+   if (r.has_error() || fsbase == 0) {
+      // Maybe there's a TCB by next time.
+      stack_guard = pointer_guard = 0;
+      return;
+   }
+   auto const *const tcb = reinterpret_cast<thread_tcb const *>(fsbase);
+   stack_guard = tcb->stack_guard;
+   pointer_guard = tcb->pointer_guard;
+   known_stack_guard.store(stack_guard, ::std::memory_order_relaxed);
+   known_pointer_guard.store(pointer_guard, ::std::memory_order_relaxed);
+   guards_known.store(true, ::std::memory_order_release);
+}
+
+//! Where the initial values of the program's thread local variables are.
+struct tls_template {
+   void const *image = nullptr;
+   ::std::size_t filesz = 0;
+   ::std::size_t memsz = 0;
+   ::std::size_t align = 1;
+};
+
+//! Find the program's PT_TLS segment, which needs `init_auxv` to have run.
+inline tls_template find_tls_template() noexcept
+{
+   namespace elf = ::syscalls::linux::elf;
+   tls_template result;
+   auto const phdr_addr = getauxval(auxv_type::phdr);
+   auto const phnum = getauxval(auxv_type::phnum);
+   if (!phdr_addr.has_value() || !phnum.has_value()) {
+      return result;
+   }
+   auto const *const ph = reinterpret_cast<elf::phdr const *>(*phdr_addr);
+   ::std::uintptr_t load_bias = 0;
+   elf::phdr const *tls = nullptr;
+   for (::std::uint64_t i = 0; i < *phnum; ++i) {
+      if (ph[i].p_type == elf::pt_phdr) {
+         load_bias = *phdr_addr - ph[i].p_vaddr;
+      } else if (ph[i].p_type == elf::pt_tls) {
+         tls = &ph[i];
+      }
+   }
+   if (tls != nullptr) {
+      result.image = reinterpret_cast<void const *>(load_bias + tls->p_vaddr);
+      result.filesz = tls->p_filesz;
+      result.memsz = tls->p_memsz;
+      result.align = tls->p_align > 0 ? tls->p_align : 1;
+   }
+   return result;
+}
+
+inline char *align_down(char *p, ::std::size_t align) noexcept
+{
+   auto const addr = reinterpret_cast<::std::uintptr_t>(p);
+   return reinterpret_cast<char *>(addr & ~(align - 1));
+}
+
+//! The part of a thread's state that lives at the top of its stack.
+struct thread_control {
+   //! The kernel sets this to the thread id, and clears it when it exits.
+   futex_word tid{0};
+};
+
+template <typename Func>
+struct thread_start : thread_control {
+   explicit thread_start(Func &&f) : func{::std::move(f)} {}
+
+   static void run(void *arg) noexcept {
+      auto *const self = static_cast<thread_start *>(arg);
+      ::std::invoke(self->func);
+      self->func.~Func();
+   }
+
+   Func func;
+};
+
+} // namespace priv_
+
+/**
+ * \brief A thread started without pthreads, which is joined when destroyed.
+ *
+ * Like `::std::jthread` (minus stop tokens), destroying or assigning over a
+ * running thread waits for it to finish. There's no `detach`, because the
+ * stack can only go back to its pool once the thread is known to be done.
+ *
+ * The function the thread runs, its thread control block and its thread
+ * local variables are all placed at the top of its stack, so starting a
+ * thread with a cached stack does no allocation and makes exactly one
+ * system call (clone3), and joining one that's already finished makes none.
+ * The very first thread also makes an arch_prctl, to find the stack canary.
+ *
+ * These threads have no libc thread state. They can use the program's own
+ * `thread_local` variables (as long as `init_auxv` has been called so they
+ * can be found), but must not call into libc or anything else that relies on
+ * pthreads having set up the thread.
+ */
+class thread {
+ public:
+   //! Not a thread.
+   constexpr thread() noexcept = default;
+
+   /**
+    * \brief Start a thread that calls `func()`.
+    *
+    * `func` is moved to the new thread's stack. It must not let an exception
+    * escape, or the program will terminate.
+    */
+   template <typename Func>
+   requires ::std::invocable<::std::decay_t<Func> &>
+            && ::std::move_constructible<::std::decay_t<Func>>
+   [[nodiscard]] static expected<thread>
+   create(Func &&func, stack_pool &pool = default_stack_pool) noexcept
+   {
+      using func_t = ::std::decay_t<Func>;
+      using start_t = priv_::thread_start<func_t>;
+      using errtag = expected<thread>::err_tag;
+      static_assert(alignof(start_t) <= alignof(priv_::thread_tcb));
+      namespace x86 = ::syscalls::linux::x86_64;
+
+      auto stk_result = pool.acquire();
+      if (stk_result.has_error()) {
+         return expected<thread>{errtag{}, stk_result.error()};
+      }
+      thread_stack const stk = stk_result.result();
+
+      // From the top down: the function to run, the TCB, thread local
+      // variables, then the stack proper.
+      char *top = stk.base + stk.size;
+      top = priv_::align_down(top - sizeof(start_t), alignof(start_t));
+      auto *const start = ::new (top) start_t{func_t{::std::forward<Func>(func)}};
+
+      auto const tls = priv_::find_tls_template();
+      ::std::size_t const tcb_align = tls.align > alignof(priv_::thread_tcb)
+                                      ? tls.align : alignof(priv_::thread_tcb);
+      char *const tcb_addr =
+           priv_::align_down(top - sizeof(priv_::thread_tcb), tcb_align);
+      auto *const tcb = ::new (tcb_addr) priv_::thread_tcb{};
+      tcb->self = tcb->self2 = tcb;
+      priv_::current_guards(tcb->stack_guard, tcb->pointer_guard);
+      // Variant II TLS: the program's block ends where the TCB starts.
+      ::std::size_t const tls_size = (tls.memsz + tls.align - 1)
+                                     & ~(tls.align - 1);
+      char *const tls_block = tcb_addr - tls_size;
+      if (tls.memsz > 0) {
+         ::std::memcpy(tls_block, tls.image, tls.filesz);
+         ::std::memset(tls_block + tls.filesz, 0, tls.memsz - tls.filesz);
+      }
+      char *const stack_top = priv_::align_down(tls_block, 16);
+
+      auto const flags = cloneflags::vm | cloneflags::fs | cloneflags::files
+                         | cloneflags::sighand | cloneflags::thread
+                         | cloneflags::sysvsem | cloneflags::settls
+                         | cloneflags::parent_settid
+                         | cloneflags::child_cleartid;
+      auto const tid_addr = reinterpret_cast<::std::uintptr_t>(
+           priv_::futex_addr(start->tid)
+      );
+      x86::clone_args const args{
+           .flags = flags.getbits(),
+           .pidfd = 0,
+           .child_tid = tid_addr,
+           .parent_tid = tid_addr,
+           .exit_signal = 0,
+           .stack = reinterpret_cast<::std::uintptr_t>(stk.base),
+           .stack_size = static_cast<::std::uint64_t>(stack_top - stk.base),
+           .tls = reinterpret_cast<::std::uintptr_t>(tcb)
+      };
+      auto cloned = x86::clone3_thread(args, &start_t::run, start);
+      if (cloned.has_error()
+          && cloned.error() == static_cast<int>(::std::errc::function_not_supported))
+      {
+         cloned = x86::clone_thread(args, &start_t::run, start);
+      }
+      if (cloned.has_error()) {
+         start->~start_t();
+         pool.release(stk);
+         return expected<thread>{errtag{}, cloned.error()};
+      }
+      return expected<thread>{thread{start, stk, pool}};
+   }
+
+   thread(thread &&other) noexcept
+        : control_{::std::exchange(other.control_, nullptr)},
+          stack_{other.stack_},
+          pool_{other.pool_}
+   {}
+
+   //! Joins this thread first if it's running.
+   thread &operator =(thread &&other) noexcept {
+      if (this != &other) {
+         static_cast<void>(join());
+         control_ = ::std::exchange(other.control_, nullptr);
+         stack_ = other.stack_;
+         pool_ = other.pool_;
+      }
+      return *this;
+   }
+
+   //! Joins the thread, ignoring errors.
+   ~thread() noexcept {
+      static_cast<void>(join());
+   }
+
+   //! Whether there's a thread that hasn't been joined yet.
+   [[nodiscard]] bool joinable() const noexcept { return control_ != nullptr; }
+
+   //! The kernel's thread id, or 0 if it has finished or was never started.
+   [[nodiscard]] int get_id() const noexcept {
+      if (control_ == nullptr) {
+         return 0;
+      }
+      return static_cast<int>(control_->tid.load(::std::memory_order_relaxed));
+   }
+
+   //! Wait for the thread to finish, then recycle its stack.
+   expected<void> join() noexcept {
+      if (control_ == nullptr) {
+         return expected<void>{};
+      }
+      for (;;) {
+         auto const tid = control_->tid.load(::std::memory_order_acquire);
+         if (tid == 0) {
+            break;
+         }
+         // The kernel's wake when the thread exits isn't process private.
+         auto const result = futex_wait(control_->tid, tid, false);
+         if (priv_::is_real_wait_error(result)) {
+            return result;
+         }
+      }
+      control_ = nullptr;
+      pool_->release(stack_);
+      return expected<void>{};
+   }
+
+ private:
+   thread(priv_::thread_control *control, thread_stack stk,
+          stack_pool &pool) noexcept
+        : control_{control}, stack_{stk}, pool_{&pool}
+   {}
+
+   priv_::thread_control *control_ = nullptr;
+   thread_stack stack_;
+   stack_pool *pool_ = nullptr;
+};
+
+} // namespace posixpp
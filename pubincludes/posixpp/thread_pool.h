@@ -0,0 +1,566 @@
+// Copyright 2021 Eric Hopper
+// Distributed under the terms of the LGPLv3.
+
+#pragma once  /*-*-c++-*-*/
+
+#include <posixpp/basic.h>
+#include <posixpp/expected.h>
+#include <posixpp/futex.h>
+#include <posixpp/heap.h>
+#include <posixpp/mutex.h>
+#include <posixpp/thread.h>
+#include <pppbase/cpu_relax.h>
+#include <atomic>
+#include <climits>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+namespace posixpp {
+
+namespace priv_ {
+
+//! Something for a pool worker to run.
+struct pool_job {
+   void (*run)(pool_job *) noexcept;
+   //! Only used while waiting in the pool's injection queue.
+   pool_job *next;
+};
+
+/**
+ * \brief A fixed size Chase-Lev work-stealing deque.
+ *
+ * The owning worker pushes and pops at the bottom, and any other worker can
+ * steal from the top. This follows "Correct and Efficient Work-Stealing for
+ * Weak Memory Models" by Lê, Pop, Cohen and Zappa Nardelli, minus growing
+ * the buffer. A push to a full deque fails, and the caller runs the job
+ * itself instead.
+ */
+class work_deque {
+ public:
+   static constexpr ::std::int64_t capacity = 4096;
+
+   //! Only the owner may call this.
+   [[nodiscard]] bool push(pool_job *job) noexcept {
+      ::std::int64_t const b = bottom_.load(::std::memory_order_relaxed);
+      ::std::int64_t const t = top_.load(::std::memory_order_acquire);
+      if (b - t >= capacity) {
+         return false;
+      }
+      buffer_[b & mask].store(job, ::std::memory_order_relaxed);
+      ::std::atomic_thread_fence(::std::memory_order_release);
+      bottom_.store(b + 1, ::std::memory_order_relaxed);
+      return true;
+   }
+
+   //! Only the owner may call this, returns the newest job.
+   [[nodiscard]] pool_job *pop() noexcept {
+      ::std::int64_t const b = bottom_.load(::std::memory_order_relaxed) - 1;
+      bottom_.store(b, ::std::memory_order_relaxed);
+      ::std::atomic_thread_fence(::std::memory_order_seq_cst);
+      ::std::int64_t t = top_.load(::std::memory_order_relaxed);
+      if (t > b) {
+         bottom_.store(b + 1, ::std::memory_order_relaxed);
+         return nullptr;
+      }
+      pool_job *job = buffer_[b & mask].load(::std::memory_order_relaxed);
+      if (t == b) {
+         // The last one, race the thieves for it.
+         if (!top_.compare_exchange_strong(t, t + 1,
+                                           ::std::memory_order_seq_cst,
+                                           ::std::memory_order_relaxed))
+         {
+            job = nullptr;
+         }
+         bottom_.store(b + 1, ::std::memory_order_relaxed);
+      }
+      return job;
+   }
+
+   //! Anybody may call this, returns the oldest job.
+   [[nodiscard]] pool_job *steal() noexcept {
+      ::std::int64_t t = top_.load(::std::memory_order_acquire);
+      ::std::atomic_thread_fence(::std::memory_order_seq_cst);
+      ::std::int64_t const b = bottom_.load(::std::memory_order_acquire);
+      if (t >= b) {
+         return nullptr;
+      }
+      pool_job *const job = buffer_[t & mask].load(::std::memory_order_relaxed);
+      if (!top_.compare_exchange_strong(t, t + 1,
+                                        ::std::memory_order_seq_cst,
+                                        ::std::memory_order_relaxed))
+      {
+         return nullptr;
+      }
+      return job;
+   }
+
+   //! Whether there might be something to steal.
+   [[nodiscard]] bool maybe_nonempty() const noexcept {
+      return bottom_.load(::std::memory_order_relaxed)
+             > top_.load(::std::memory_order_relaxed);
+   }
+
+ private:
+   static constexpr ::std::int64_t mask = capacity - 1;
+   static_assert((capacity & mask) == 0);
+
+   alignas(64) ::std::atomic<::std::int64_t> top_{0};
+   alignas(64) ::std::atomic<::std::int64_t> bottom_{0};
+   alignas(64) ::std::atomic<pool_job *> buffer_[capacity] = {};
+};
+
+struct pool_state;
+
+struct alignas(64) pool_worker {
+   work_deque deque;
+   pool_state *pool = nullptr;
+   unsigned index = 0;
+   //! For picking victims to steal from.
+   ::std::uint32_t rand = 0;
+
+   unsigned next_victim(unsigned nworkers) noexcept {
+      rand ^= rand << 13;
+      rand ^= rand >> 17;
+      rand ^= rand << 5;
+      return rand % nworkers;
+   }
+};
+
+//! The worker the calling thread is, if it's one.
+inline constinit thread_local pool_worker *current_worker = nullptr;
+
+//! A job from `thread_pool::submit`, which deletes itself once it has run.
+template <typename Func>
+struct submitted_job : pool_job {
+   submitted_job(Func &&f, pool_state &p)
+        : pool_job{&run_job, nullptr}, func{::std::move(f)}, pool{&p}
+   {}
+
+   static void run_job(pool_job *job) noexcept;
+
+   Func func;
+   pool_state *pool;
+};
+
+//! The second half of a `thread_pool::fork_join`, which lives on the stack.
+template <typename Func>
+struct join_job : pool_job {
+   static constexpr ::std::uint32_t pending = 0;
+   static constexpr ::std::uint32_t finished = 1;
+   //! Still pending, and the forking worker is asleep waiting for it.
+   static constexpr ::std::uint32_t sleeping = 2;
+
+   explicit join_job(Func &f) noexcept
+        : pool_job{&run_job, nullptr}, func{f}
+   {}
+
+   static void run_job(pool_job *job) noexcept {
+      auto *const self = static_cast<join_job *>(job);
+      ::std::invoke(self->func);
+      // The forking worker may return and reuse the stack this lives on as
+      // soon as it sees `finished`. A wake on that address afterwards is
+      // harmless, the kernel just finds nobody (or somebody who rechecks).
+      if (self->state.exchange(finished, ::std::memory_order_release)
+          == sleeping)
+      {
+         static_cast<void>(futex_wake(self->state, 1));
+      }
+   }
+
+   Func &func;
+   futex_word state{pending};
+};
+
+struct pool_state {
+   //! How many times a worker looks for work, yielding in between, before
+   //! it goes to sleep.
+   static constexpr unsigned spin_rounds = 16;
+
+   explicit pool_state(unsigned n) noexcept : nworkers{n} {}
+
+   //! Take the oldest job from the injection queue.
+   pool_job *take_injected() noexcept {
+      if (!injected.load(::std::memory_order_acquire)) {
+         return nullptr;
+      }
+      ::std::lock_guard<mutex> lock{inject_lock};
+      pool_job *const job = inject_head;
+      if (job != nullptr) {
+         inject_head = job->next;
+         if (inject_head == nullptr) {
+            inject_tail = nullptr;
+            injected.store(false, ::std::memory_order_relaxed);
+         }
+      }
+      return job;
+   }
+
+   void inject(pool_job *job) noexcept {
+      {
+         ::std::lock_guard<mutex> lock{inject_lock};
+         job->next = nullptr;
+         if (inject_tail == nullptr) {
+            inject_head = job;
+         } else {
+            inject_tail->next = job;
+         }
+         inject_tail = job;
+         injected.store(true, ::std::memory_order_release);
+      }
+      notify();
+   }
+
+   //! Wake a sleeping worker, if there is one, because there's new work.
+   void notify() noexcept {
+      // Pairs with the fence in `park`. Either this sees the sleeper, or the
+      // sleeper sees the new work.
+      ::std::atomic_thread_fence(::std::memory_order_seq_cst);
+      if (sleepers.load(::std::memory_order_relaxed) > 0) {
+         epoch.fetch_add(1, ::std::memory_order_release);
+         static_cast<void>(futex_wake(epoch, 1));
+      }
+   }
+
+   pool_job *find_work(pool_worker &self) noexcept {
+      if (pool_job *const job = self.deque.pop()) {
+         return job;
+      }
+      if (pool_job *const job = take_injected()) {
+         return job;
+      }
+      for (unsigned tries = 0; tries < 2 * nworkers; ++tries) {
+         unsigned const victim = self.next_victim(nworkers);
+         if (victim != self.index) {
+            if (pool_job *const job = workers[victim].deque.steal()) {
+               return job;
+            }
+         }
+      }
+      return nullptr;
+   }
+
+   [[nodiscard]] bool has_work() const noexcept {
+      if (injected.load(::std::memory_order_relaxed)) {
+         return true;
+      }
+      for (unsigned i = 0; i < nworkers; ++i) {
+         if (workers[i].deque.maybe_nonempty()) {
+            return true;
+         }
+      }
+      return false;
+   }
+
+   //! Sleep until there might be work, returns false if the pool is stopping.
+   bool park() noexcept {
+      ::std::uint32_t const seen = epoch.load(::std::memory_order_acquire);
+      sleepers.fetch_add(1, ::std::memory_order_relaxed);
+      ::std::atomic_thread_fence(::std::memory_order_seq_cst);
+      bool const stop = stopping.load(::std::memory_order_relaxed);
+      if (!stop && !has_work()) {
+         static_cast<void>(futex_wait(epoch, seen));
+      }
+      sleepers.fetch_sub(1, ::std::memory_order_relaxed);
+      return !stop;
+   }
+
+   void worker_main(pool_worker &self) noexcept {
+      current_worker = &self;
+      for (;;) {
+         pool_job *job = nullptr;
+         for (unsigned round = 0; job == nullptr && round < spin_rounds;
+              ++round)
+         {
+            job = find_work(self);
+            if (job == nullptr) {
+               sched_yield();
+            }
+         }
+         if (job != nullptr) {
+            job->run(job);
+         } else if (!park()) {
+            break;
+         }
+      }
+      current_worker = nullptr;
+      heap::flush_thread_cache();
+   }
+
+   //! Run other jobs until `state` says the join job is finished.
+   template <typename Func>
+   void help_until_done(join_job<Func> &joined, pool_worker &self) noexcept {
+      using jj = join_job<Func>;
+      unsigned idle = 0;
+      for (;;) {
+         ::std::uint32_t s = joined.state.load(::std::memory_order_acquire);
+         if (s == jj::finished) {
+            return;
+         }
+         if (pool_job *const job = find_work(self)) {
+            job->run(job);
+            idle = 0;
+            continue;
+         }
+         if (++idle < spin_rounds) {
+            ::pppbase::cpu_relax();
+            continue;
+         }
+         if (s == jj::pending
+             && !joined.state.compare_exchange_strong(
+                  s, jj::sleeping, ::std::memory_order_acquire,
+                  ::std::memory_order_acquire))
+         {
+            continue;
+         }
+         static_cast<void>(futex_wait(joined.state, jj::sleeping));
+      }
+   }
+
+   //! A submitted job finished, wake `wait` if it was the last one.
+   void finished_one() noexcept {
+      if (pending.fetch_sub(1, ::std::memory_order_acq_rel) == 1) {
+         static_cast<void>(futex_wake(pending, INT_MAX));
+      }
+   }
+
+   unsigned const nworkers;
+   ::std::unique_ptr<pool_worker[]> workers;
+   ::std::unique_ptr<thread[]> threads;
+
+   //! Jobs submitted from outside the pool.
+   mutex inject_lock;
+   pool_job *inject_head = nullptr;
+   pool_job *inject_tail = nullptr;
+   ::std::atomic<bool> injected = false;
+
+   //! Changed whenever sleeping workers are woken.
+   futex_word epoch{0};
+   ::std::atomic<unsigned> sleepers = 0;
+   ::std::atomic<bool> stopping = false;
+   //! Submitted jobs that haven't finished yet.
+   futex_word pending{0};
+};
+
+template <typename Func>
+void submitted_job<Func>::run_job(pool_job *job) noexcept
+{
+   auto *const self = static_cast<submitted_job *>(job);
+   pool_state &pool = *self->pool;
+   ::std::invoke(self->func);
+   self->~submitted_job();
+   heap::deallocate(self);
+   pool.finished_one();
+}
+
+} // namespace priv_
+
+/**
+ * \brief A fixed set of `posixpp::thread` workers that share jobs by
+ * stealing them from each other.
+ *
+ * Every worker has its own deque. Jobs a worker creates go on the bottom of
+ * its own deque, and it takes them back from there, newest first, so a
+ * recursive fork-join computation mostly stays on one worker and in its
+ * cache. A worker that runs out steals the oldest job from the top of a
+ * randomly chosen worker's deque, which tends to be the biggest piece of
+ * work. Nothing is shared between workers that aren't stealing from each
+ * other, so this keeps scaling where a single shared queue would not.
+ *
+ * Workers that find nothing to do after a few rounds of looking sleep on a
+ * futex, and are woken one at a time as new jobs appear.
+ *
+ * The workers are `posixpp::thread`s, so jobs must not call into libc, and
+ * `init_auxv` must have been called before the pool is created because the
+ * workers use thread local variables. Jobs must not let exceptions escape.
+ * Submitted jobs are allocated with `posixpp::heap`.
+ */
+class thread_pool {
+ public:
+   //! Start `nworkers` workers.
+   [[nodiscard]] static expected<thread_pool>
+   create(unsigned nworkers, stack_pool &stacks = default_stack_pool) noexcept
+   {
+      using errtag = expected<thread_pool>::err_tag;
+      auto const nomem = static_cast<int>(::std::errc::not_enough_memory);
+      if (nworkers == 0) {
+         return expected<thread_pool>{
+              errtag{}, static_cast<int>(::std::errc::invalid_argument)
+         };
+      }
+      ::std::unique_ptr<priv_::pool_state> state{
+           new (::std::nothrow) priv_::pool_state{nworkers}
+      };
+      if (state == nullptr) {
+         return expected<thread_pool>{errtag{}, nomem};
+      }
+      state->workers.reset(new (::std::nothrow) priv_::pool_worker[nworkers]);
+      state->threads.reset(new (::std::nothrow) thread[nworkers]);
+      if (state->workers == nullptr || state->threads == nullptr) {
+         return expected<thread_pool>{errtag{}, nomem};
+      }
+      for (unsigned i = 0; i < nworkers; ++i) {
+         priv_::pool_worker &w = state->workers[i];
+         w.pool = state.get();
+         w.index = i;
+         w.rand = 2463534242U + i * 0x9e3779b9U;
+      }
+      thread_pool pool{::std::move(state)};
+      for (unsigned i = 0; i < nworkers; ++i) {
+         priv_::pool_state *const st = pool.state_.get();
+         auto started = thread::create([st, i]() noexcept {
+            st->worker_main(st->workers[i]);
+         }, stacks);
+         if (started.has_error()) {
+            // The destructor stops the ones that did start.
+            return expected<thread_pool>{errtag{}, started.error()};
+         }
+         st->threads[i] = ::std::move(started).result();
+      }
+      return expected<thread_pool>{::std::move(pool)};
+   }
+
+   thread_pool(thread_pool &&) noexcept = default;
+   thread_pool &operator =(thread_pool &&other) noexcept {
+      if (this != &other) {
+         shutdown();
+         state_ = ::std::move(other.state_);
+      }
+      return *this;
+   }
+
+   //! Waits for every submitted job, then stops the workers.
+   ~thread_pool() noexcept { shutdown(); }
+
+   [[nodiscard]] unsigned size() const noexcept { return state_->nworkers; }
+
+   /**
+    * \brief Run `func()` on some worker.
+    *
+    * From a worker it goes on that worker's own deque, and from anywhere else
+    * on a shared queue all the workers check. Fails with `ENOMEM` if the job
+    * can't be allocated.
+    */
+   template <typename Func>
+   requires ::std::invocable<::std::decay_t<Func> &>
+            && ::std::move_constructible<::std::decay_t<Func>>
+   expected<void> submit(Func &&func) noexcept {
+      using job_t = priv_::submitted_job<::std::decay_t<Func>>;
+      priv_::pool_state &st = *state_;
+      void *const mem = heap::allocate(sizeof(job_t), alignof(job_t));
+      if (mem == nullptr) {
+         return expected<void>{static_cast<int>(::std::errc::not_enough_memory)};
+      }
+      auto *const job = ::new (mem) job_t{
+           ::std::decay_t<Func>{::std::forward<Func>(func)}, st
+      };
+      st.pending.fetch_add(1, ::std::memory_order_relaxed);
+      priv_::pool_worker *const self = priv_::current_worker;
+      if (self != nullptr && self->pool == &st) {
+         if (self->deque.push(job)) {
+            st.notify();
+         } else {
+            job->run(job);
+         }
+      } else {
+         st.inject(job);
+      }
+      return expected<void>{};
+   }
+
+   /**
+    * \brief Block until every submitted job has finished.
+    *
+    * Must not be called from a job, which would wait for itself.
+    */
+   expected<void> wait() noexcept {
+      priv_::pool_state &st = *state_;
+      for (;;) {
+         ::std::uint32_t const left = st.pending.load(::std::memory_order_acquire);
+         if (left == 0) {
+            return expected<void>{};
+         }
+         auto const waited = futex_wait(st.pending, left);
+         if (priv_::is_real_wait_error(waited)) {
+            return waited;
+         }
+      }
+   }
+
+   /**
+    * \brief Run `a()` and `b()`, possibly at the same time, and return when
+    * both are done.
+    *
+    * On a worker, `b` is offered up for stealing while this worker runs `a`.
+    * If nobody took it, this worker runs `b` too, and otherwise it runs other
+    * jobs until the thief is done with it. Nothing is allocated. Called from
+    * anywhere but a worker, this just calls `a()` then `b()`.
+    */
+   template <typename FuncA, typename FuncB>
+   requires ::std::invocable<FuncA &> && ::std::invocable<FuncB &>
+   static void fork_join(FuncA &&a, FuncB &&b) noexcept {
+      priv_::pool_worker *const self = priv_::current_worker;
+      if (self == nullptr) {
+         ::std::invoke(a);
+         ::std::invoke(b);
+         return;
+      }
+      using bfunc_t = ::std::remove_reference_t<FuncB>;
+      priv_::join_job<bfunc_t> second{b};
+      if (!self->deque.push(&second)) {
+         ::std::invoke(a);
+         ::std::invoke(b);
+         return;
+      }
+      self->pool->notify();
+      ::std::invoke(a);
+      // Jobs `a` submitted may be above `second` on the deque. And if a
+      // nested `help_until_done` already ran `second`, the next one down
+      // belongs to an outer fork_join. Either way they're work that has to
+      // be done, so do it on the way down to `second`.
+      using jj = priv_::join_job<bfunc_t>;
+      while (second.state.load(::std::memory_order_acquire) != jj::finished) {
+         priv_::pool_job *const job = self->deque.pop();
+         if (job == &second) {
+            ::std::invoke(b);
+            return;
+         } else if (job == nullptr) {
+            // Stolen, wait for the thief.
+            self->pool->help_until_done(second, *self);
+            return;
+         }
+         job->run(job);
+      }
+   }
+
+ private:
+   explicit thread_pool(::std::unique_ptr<priv_::pool_state> &&state) noexcept
+        : state_{::std::move(state)}
+   {}
+
+   void shutdown() noexcept {
+      if (state_ == nullptr) {
+         return;
+      }
+      static_cast<void>(wait());
+      priv_::pool_state &st = *state_;
+      st.stopping.store(true, ::std::memory_order_seq_cst);
+      st.epoch.fetch_add(1, ::std::memory_order_release);
+      static_cast<void>(futex_wake(st.epoch, INT_MAX));
+      for (unsigned i = 0; i < st.nworkers; ++i) {
+         static_cast<void>(st.threads[i].join());
+      }
+      state_.reset();
+   }
+
+   ::std::unique_ptr<priv_::pool_state> state_;
+};
+
+} // namespace posixpp
@@ -0,0 +1,472 @@
+// Copyright 2021 Eric Hopper
+// Distributed under the terms of the LGPLv3.
+
+#pragma once  /*-*-c++-*-*/
+
+#include <posixpp/clock.h>
+#include <posixpp/expected.h>
+#include <posixpp/fd.h>
+#include <posixpp/reactor.h>
+#include <posixpp/timerfd.h>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <new>
+#include <system_error>
+#include <utility>
+
+namespace posixpp {
+
+namespace priv_ {
+
+//! A link in a circular list of timers. A list's head is a bare link.
+struct timer_link {
+   timer_link() noexcept = default;
+   timer_link(timer_link const &) = delete;
+   timer_link &operator =(timer_link const &) = delete;
+
+   [[nodiscard]] bool empty() const noexcept { return next == this; }
+
+   void push_back(timer_link &l) noexcept {
+      l.prev = prev;
+      l.next = this;
+      prev->next = &l;
+      prev = &l;
+   }
+
+   void unlink() noexcept {
+      prev->next = next;
+      next->prev = prev;
+      prev = next = this;
+   }
+
+   //! Move everything in this list to the empty list `to`.
+   void splice_into(timer_link &to) noexcept {
+      if (!empty()) {
+         to.next = next;
+         to.prev = prev;
+         next->prev = &to;
+         prev->next = &to;
+         prev = next = this;
+      }
+   }
+
+   timer_link *prev = this;
+   timer_link *next = this;
+};
+
+struct wheel_state;
+
+} // namespace priv_
+
+/**
+ * \brief Something to be called back from a `timer_wheel` at a certain tick.
+ *
+ * Timers are intrusive, the wheel allocates nothing to schedule one. A timer
+ * cancels itself when destroyed, and a wheel unschedules its timers when it's
+ * destroyed, so either can go first.
+ */
+class timer : private priv_::timer_link {
+ public:
+   timer() noexcept = default;
+
+   //! Called from `timer_wheel::advance` when the timer's deadline arrives.
+   //! It's no longer scheduled by then, so it can schedule itself again.
+   virtual void on_expire() noexcept = 0;
+
+   [[nodiscard]] bool is_scheduled() const noexcept {
+      return wheel_ != nullptr;
+   }
+
+   //! The tick it was last scheduled for.
+   [[nodiscard]] ::std::uint64_t deadline() const noexcept { return deadline_; }
+
+   //! Unschedule it, if it's scheduled. Never calls the kernel.
+   void cancel() noexcept;
+
+ protected:
+   ~timer() { cancel(); }
+
+ private:
+   friend class timer_wheel;
+   friend struct priv_::wheel_state;
+
+   priv_::wheel_state *wheel_ = nullptr;
+   ::std::uint64_t deadline_ = 0;
+   ::std::uint8_t level_ = 0;
+   ::std::uint8_t slot_ = 0;
+};
+
+namespace priv_ {
+
+/**
+ * \brief The levels of a `timer_wheel`.
+ *
+ * Level 0 has a slot for each of the next 64 ticks, level 1 a slot for each
+ * of the next 64 runs of 64 ticks, and so on. A timer goes in the lowest level
+ * its deadline fits in, in the slot picked by that level's digit of its
+ * deadline. When the current tick enters a new slot at a level above 0, the
+ * timers in it are put back in the levels below, so every timer is moved at
+ * most once per level. A bitmap per level says which slots have timers, so
+ * finding the next thing to do never means looking through empty slots.
+ */
+struct wheel_state {
+   static constexpr unsigned slot_bits = 6;
+   static constexpr unsigned slots = 1U << slot_bits;
+   static constexpr unsigned levels = 6;
+   static constexpr ::std::uint64_t max_delay =
+        (::std::uint64_t{1} << (slot_bits * levels)) - 1;
+   static constexpr ::std::uint64_t no_deadline =
+        ::std::numeric_limits<::std::uint64_t>::max();
+
+   static timer &as_timer(timer_link &link) noexcept {
+      return static_cast<timer &>(link);
+   }
+
+   //! Put `t` in its slot. Its deadline must not be before `now`.
+   void place(timer &t) noexcept {
+      ::std::uint64_t const delta = t.deadline_ - now;
+      unsigned const width = ::std::bit_width(delta);
+      unsigned const level = width == 0 ? 0 : (width - 1) / slot_bits;
+      unsigned const slot = (t.deadline_ >> (level * slot_bits)) & (slots - 1);
+      t.level_ = static_cast<::std::uint8_t>(level);
+      t.slot_ = static_cast<::std::uint8_t>(slot);
+      wheel[level][slot].push_back(t);
+      occupied[level] |= ::std::uint64_t{1} << slot;
+   }
+
+   void remove(timer &t) noexcept {
+      t.unlink();
+      if (wheel[t.level_][t.slot_].empty()) {
+         occupied[t.level_] &= ~(::std::uint64_t{1} << t.slot_);
+      }
+      t.wheel_ = nullptr;
+      --count;
+   }
+
+   //! The earliest tick that has a timer to fire or a slot to cascade.
+   [[nodiscard]] ::std::uint64_t next_event() const noexcept {
+      ::std::uint64_t best = no_deadline;
+      for (unsigned level = 0; level < levels; ++level) {
+         if (occupied[level] == 0) {
+            continue;
+         }
+         // Slot (prefix + 1) is the next one this level reaches. The current
+         // slot at a level above 0 can only hold timers a whole turn away.
+         unsigned const shift = level * slot_bits;
+         ::std::uint64_t const prefix = now >> shift;
+         auto const start = static_cast<int>((prefix + 1) & (slots - 1));
+         unsigned const ahead = ::std::countr_zero(
+              ::std::rotr(occupied[level], start)
+         );
+         ::std::uint64_t const event = (prefix + 1 + ahead) << shift;
+         if (event < best) {
+            best = event;
+         }
+      }
+      return best;
+   }
+
+   //! Put the timers in one slot back in the levels below it.
+   void cascade(unsigned level, unsigned slot) noexcept {
+      timer_link &head = wheel[level][slot];
+      occupied[level] &= ~(::std::uint64_t{1} << slot);
+      timer_link moving;
+      head.splice_into(moving);
+      while (!moving.empty()) {
+         timer &t = as_timer(*moving.next);
+         t.unlink();
+         place(t);
+      }
+   }
+
+   //! Go forward one tick, and fire what's due then.
+   unsigned step() noexcept {
+      ++now;
+      for (unsigned level = 1; level < levels; ++level) {
+         unsigned const shift = level * slot_bits;
+         if ((now & ((::std::uint64_t{1} << shift) - 1)) != 0) {
+            break;
+         }
+         cascade(level, (now >> shift) & (slots - 1));
+      }
+      auto const slot = static_cast<unsigned>(now & (slots - 1));
+      occupied[0] &= ~(::std::uint64_t{1} << slot);
+      // Firing from a list of its own lets the callbacks schedule and cancel
+      // whatever they like.
+      timer_link due;
+      wheel[0][slot].splice_into(due);
+      unsigned fired = 0;
+      while (!due.empty()) {
+         timer &t = as_timer(*due.next);
+         t.unlink();
+         t.wheel_ = nullptr;
+         --count;
+         ++fired;
+         t.on_expire();
+      }
+      return fired;
+   }
+
+   unsigned advance(::std::uint64_t tick) noexcept {
+      unsigned fired = 0;
+      while (now < tick) {
+         ::std::uint64_t const next = count == 0 ? no_deadline : next_event();
+         if (next > tick) {
+            // Nothing happens in between, so skip straight there.
+            now = tick;
+         } else {
+            now = next - 1;
+            fired += step();
+         }
+      }
+      return fired;
+   }
+
+   //! Unschedule everything, without calling anything.
+   void clear() noexcept {
+      for (auto &level : wheel) {
+         for (auto &head : level) {
+            while (!head.empty()) {
+               timer &t = as_timer(*head.next);
+               t.unlink();
+               t.wheel_ = nullptr;
+            }
+         }
+      }
+      for (auto &bits : occupied) {
+         bits = 0;
+      }
+      count = 0;
+   }
+
+   timer_link wheel[levels][slots];
+   ::std::uint64_t occupied[levels] = {};
+   ::std::uint64_t now = 0;
+   ::std::size_t count = 0;
+};
+
+} // namespace priv_
+
+inline void timer::cancel() noexcept
+{
+   if (wheel_ != nullptr) {
+      wheel_->remove(*this);
+   }
+}
+
+/**
+ * \brief A hierarchical timing wheel that keeps one timerfd set for its next
+ * deadline.
+ *
+ * Scheduling and cancelling are O(1) and allocate nothing, so it copes with a
+ * timeout per connection for a great many connections. Time is counted in
+ * ticks of `tick_ns` nanoseconds of `CLOCK_MONOTONIC` from when the wheel was
+ * created.
+ *
+ * The timerfd is non-blocking and the wheel is an `event_handler`, so it can be
+ * added to a `reactor` as is and its timers will be called from
+ * `reactor::poll`. Remove it from the reactor before moving it.
+ *
+ * Deadlines are relative to the clock, not to `now()`, which only moves when
+ * the wheel is advanced and so stands still while it's idle. The timerfd is
+ * only set again when a new deadline is earlier than what it's set for, or
+ * after expiring timers. When the only timers are far off, it will sometimes
+ * go off early just to move them to a finer level.
+ */
+class timer_wheel : public event_handler {
+ public:
+   //! Longer delays than this are shortened to it.
+   static constexpr ::std::uint64_t max_delay = priv_::wheel_state::max_delay;
+
+   //! Create a wheel whose ticks are `tick_ns` nanoseconds long.
+   [[nodiscard]] static expected<timer_wheel>
+   create(::std::uint64_t tick_ns = 1'000'000) noexcept {
+      using result_t = expected<timer_wheel>;
+      if (tick_ns == 0) {
+         return result_t{result_t::err_tag{},
+                         static_cast<int>(::std::errc::invalid_argument)};
+      }
+      ::std::unique_ptr<priv_::wheel_state> state{
+           new (::std::nothrow) priv_::wheel_state
+      };
+      if (state == nullptr) {
+         return result_t{result_t::err_tag{},
+                         static_cast<int>(::std::errc::not_enough_memory)};
+      }
+      auto tfd = timerfd_create(clockid::monotonic,
+                                timerfdflags::nonblock | timerfdflags::cloexec);
+      if (tfd.has_error()) {
+         return result_t{result_t::err_tag{}, tfd.error()};
+      }
+      auto const origin = clock_gettime(clockid::monotonic);
+      if (origin.has_error()) {
+         return result_t{result_t::err_tag{}, origin.error()};
+      }
+      return result_t{timer_wheel{::std::move(tfd).result(),
+                                  ::std::move(state), tick_ns,
+                                  to_ns(origin.result())}};
+   }
+
+   timer_wheel(timer_wheel &&other) noexcept = default;
+   timer_wheel &operator =(timer_wheel &&other) noexcept {
+      if (this != &other) {
+         if (state_ != nullptr) {
+            state_->clear();
+         }
+         tfd_ = ::std::move(other.tfd_);
+         state_ = ::std::move(other.state_);
+         tick_ns_ = other.tick_ns_;
+         origin_ns_ = other.origin_ns_;
+         armed_ = other.armed_;
+      }
+      return *this;
+   }
+
+   //! Unschedules any timers still waiting, without calling them.
+   ~timer_wheel() {
+      if (state_ != nullptr) {
+         state_->clear();
+      }
+   }
+
+   //! The timerfd, readable when something's due.
+   [[nodiscard]] fd const &get_fd() const noexcept { return tfd_; }
+
+   [[nodiscard]] ::std::uint64_t tick_ns() const noexcept { return tick_ns_; }
+
+   //! The tick the wheel has advanced to.
+   [[nodiscard]] ::std::uint64_t now() const noexcept { return state_->now; }
+
+   //! How many timers are scheduled.
+   [[nodiscard]] ::std::size_t size() const noexcept { return state_->count; }
+
+   /**
+    * \brief Schedule `t` to go off `ticks` after the current tick by the
+    * clock (or `now()`, if the wheel has been advanced past that), at least 1
+    * tick from now and at most `max_delay`.
+    *
+    * A timer that's already scheduled is moved. Nothing fires from here, and
+    * the only system call besides reading the clock (which `init_vdso` makes
+    * cheap) is when the new deadline is the earliest one yet.
+    */
+   expected<void> schedule(timer &t, ::std::uint64_t ticks) noexcept {
+      auto const current = clock_tick();
+      if (current.has_error()) {
+         return expected<void>{current.error()};
+      }
+      t.cancel();
+      auto &state = *state_;
+      ::std::uint64_t const base = current.result() > state.now
+                                   ? current.result() : state.now;
+      // Placing it counts from `now`, which can't be more than `max_delay`
+      // behind the deadline.
+      ::std::uint64_t const latest = state.now + max_delay;
+      ::std::uint64_t const deadline = base + (ticks < 1 ? 1 : ticks);
+      t.deadline_ = deadline < latest && deadline > base ? deadline : latest;
+      t.wheel_ = &state;
+      state.place(t);
+      ++state.count;
+      if (t.deadline_ < armed_) {
+         return arm(t.deadline_);
+      }
+      return expected<void>{};
+   }
+
+   /**
+    * \brief Fire every timer due at or before `tick`, in deadline order.
+    *
+    * This doesn't look at the clock or touch the timerfd, which `expire`
+    * does.
+    *
+    * @return How many timers were fired.
+    */
+   unsigned advance(::std::uint64_t tick) noexcept {
+      return state_->advance(tick);
+   }
+
+   /**
+    * \brief Fire every timer that's due by the clock, then set the timerfd
+    * for the next deadline.
+    *
+    * @return How many timers were fired.
+    */
+   expected<unsigned> expire() noexcept {
+      // Only to make it not readable any more, the count doesn't matter.
+      static_cast<void>(timerfd_read(tfd_));
+      auto const tick = clock_tick();
+      if (tick.has_error()) {
+         return expected<unsigned>{expected<unsigned>::err_tag{},
+                                   tick.error()};
+      }
+      // The timerfd has gone off, or is about to be set again anyway.
+      armed_ = priv_::wheel_state::no_deadline;
+      unsigned const fired = state_->advance(tick.result());
+      ::std::uint64_t const next = state_->count == 0
+                                   ? priv_::wheel_state::no_deadline
+                                   : state_->next_event();
+      if (next != armed_) {
+         if (auto result = arm(next); result.has_error()) {
+            return expected<unsigned>{expected<unsigned>::err_tag{},
+                                      result.error()};
+         }
+      }
+      return expected<unsigned>{fired};
+   }
+
+   //! Expire timers when the timerfd is ready. Errors are dropped.
+   void on_events(epollevents) noexcept override {
+      static_cast<void>(expire());
+   }
+
+ private:
+   timer_wheel(fd &&tfd, ::std::unique_ptr<priv_::wheel_state> &&state,
+               ::std::uint64_t tick_ns, ::std::uint64_t origin_ns) noexcept
+        : tfd_{::std::move(tfd)}, state_{::std::move(state)},
+          tick_ns_{tick_ns}, origin_ns_{origin_ns}
+   {}
+
+   static ::std::uint64_t to_ns(timespec const &ts) noexcept {
+      return static_cast<::std::uint64_t>(ts.tv_sec) * 1'000'000'000
+             + static_cast<::std::uint64_t>(ts.tv_nsec);
+   }
+
+   //! The tick it is by the clock.
+   expected<::std::uint64_t> clock_tick() const noexcept {
+      return error_cascade(
+           clock_gettime(clockid::monotonic),
+           [this](timespec const &ts) {
+              return (to_ns(ts) - origin_ns_) / tick_ns_;
+           }
+      );
+   }
+
+   //! Set the timerfd for `tick`, or disarm it for `no_deadline`.
+   expected<void> arm(::std::uint64_t tick) noexcept {
+      itimerspec when{};
+      armed_ = tick;
+      if (tick != priv_::wheel_state::no_deadline) {
+         // Far enough off with long ticks, it could overflow a timespec.
+         ::std::uint64_t const latest =
+              (::std::numeric_limits<::std::int64_t>::max() - origin_ns_)
+              / tick_ns_;
+         ::std::uint64_t const ns = origin_ns_
+                                    + (tick < latest ? tick : latest) * tick_ns_;
+         when.it_value.tv_sec = static_cast<::std::int64_t>(ns / 1'000'000'000);
+         when.it_value.tv_nsec = static_cast<::std::int64_t>(ns % 1'000'000'000);
+      }
+      return error_cascade_void(
+           timerfd_settime(tfd_, when, timersetflags::abstime)
+      );
+   }
+
+   fd tfd_;
+   ::std::unique_ptr<priv_::wheel_state> state_;
+   ::std::uint64_t tick_ns_;
+   ::std::uint64_t origin_ns_;
+   ::std::uint64_t armed_ = priv_::wheel_state::no_deadline;
+};
+
+} // namespace posixpp
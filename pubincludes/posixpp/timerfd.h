@@ -0,0 +1,83 @@
+// Copyright 2021 Eric Hopper
+// Distributed under the terms of the LGPLv3.
+
+#pragma once  /*-*-c++-*-*/
+
+#include <posixpp/clock.h>
+#include <posixpp/expected.h>
+#include <posixpp/fd.h>
+#include <posixpp/simpleio.h>
+#include <syscalls/linux/timerfd.h>
+#include <syscalls/linux/x86_64/timerfdflags.h>
+#include <cstdint>
+#include <cstring>
+
+namespace posixpp {
+
+using ::syscalls::linux::itimerspec;
+using ::syscalls::linux::x86_64::timerfdflags;
+using ::syscalls::linux::x86_64::timersetflags;
+
+//! See timerfd_create(2)
+[[nodiscard]] inline expected<fd>
+timerfd_create(clockid clock, timerfdflags flags) noexcept
+{
+   return error_cascade(
+        ::syscalls::linux::timerfd_create(clock,
+                                          static_cast<int>(flags.getbits())),
+        [](auto fdint) { return fd{static_cast<int>(fdint)}; }
+   );
+}
+
+/**
+ * \brief Arm (or with a zero `it_value`, disarm) a timerfd.
+ *
+ * @return The setting it had before.
+ */
+inline expected<itimerspec>
+timerfd_settime(fd const &tfd, itimerspec const &new_value,
+                timersetflags flags = timersetflags{}) noexcept
+{
+   itimerspec old_value;
+   return error_cascade(
+        ::syscalls::linux::timerfd_settime(tfd.as_fd(),
+                                           static_cast<int>(flags.getbits()),
+                                           &new_value, &old_value),
+        [&old_value](auto) { return old_value; }
+   );
+}
+
+//! How long until a timerfd next expires, and its interval.
+[[nodiscard]] inline expected<itimerspec>
+timerfd_gettime(fd const &tfd) noexcept
+{
+   itimerspec curr_value;
+   return error_cascade(
+        ::syscalls::linux::timerfd_gettime(tfd.as_fd(), &curr_value),
+        [&curr_value](auto) { return curr_value; }
+   );
+}
+
+/**
+ * \brief Take how many times a timerfd has expired since it was last read or
+ * set.
+ *
+ * Blocks until it's expired at least once, unless the timerfd is
+ * non-blocking, in which case that's `EAGAIN`.
+ */
+[[nodiscard]] inline expected<::std::uint64_t>
+timerfd_read(fd const &tfd) noexcept
+{
+   char buf[sizeof(::std::uint64_t)];
+   auto const got = read(tfd, buf, sizeof(buf));
+   if (got.has_error()) {
+      return expected<::std::uint64_t>{
+           expected<::std::uint64_t>::err_tag{}, got.error()
+      };
+   }
+   ::std::uint64_t expirations;
+   ::std::memcpy(&expirations, buf, sizeof(expirations));
+   return expected<::std::uint64_t>{expirations};
+}
+
+} // namespace posixpp
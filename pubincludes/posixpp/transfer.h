@@ -0,0 +1,245 @@
+// Copyright 2021 Eric Hopper
+// Distributed under the terms of the LGPLv3.
+
+#pragma once  /*-*-c++-*-*/
+
+#include <posixpp/expected.h>
+#include <posixpp/fd.h>
+#include <posixpp/simpleio.h>
+#include <posixpp/spliceflags.h>
+#include <syscalls/linux/splice.h>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <system_error>
+
+namespace posixpp {
+
+/**
+ * \name Moving data between file descriptors inside the kernel.
+ *
+ * These are all thin wrappers. Wherever there's an offset pointer, a
+ * `nullptr` means to use and update the file position instead, and a non-null
+ * one is updated to just past the data transferred while the file position is
+ * left alone.
+ *
+ * Like `read` and `write`, they can transfer less than was asked for, and
+ * return how much they did transfer. `transfer` is the one that keeps going.
+ */
+///@{
+
+//! See sendfile(2), `in` must be something that can be mmap'ed.
+expected<::std::size_t>
+inline sendfile(fd const &out, fd const &in, ::std::size_t count,
+                ::std::int64_t *offset = nullptr) noexcept
+{
+   return error_cascade(
+        ::syscalls::linux::sendfile(out.as_fd(), in.as_fd(), offset, count),
+        [](auto r) { return static_cast<::std::size_t>(r); }
+   );
+}
+
+//! See splice(2), one of `in` or `out` must be a pipe.
+expected<::std::size_t>
+inline splice(fd const &in, ::std::int64_t *off_in,
+              fd const &out, ::std::int64_t *off_out,
+              ::std::size_t len, spliceflags flags = spliceflags{}) noexcept
+{
+   auto const bits = static_cast<unsigned>(flags.getbits());
+   return error_cascade(
+        ::syscalls::linux::splice(in.as_fd(), off_in, out.as_fd(), off_out,
+                                  len, bits),
+        [](auto r) { return static_cast<::std::size_t>(r); }
+   );
+}
+
+//! See tee(2), copy data between two pipes without consuming it from `in`.
+expected<::std::size_t>
+inline tee(fd const &in, fd const &out, ::std::size_t len,
+           spliceflags flags = spliceflags{}) noexcept
+{
+   auto const bits = static_cast<unsigned>(flags.getbits());
+   return error_cascade(
+        ::syscalls::linux::tee(in.as_fd(), out.as_fd(), len, bits),
+        [](auto r) { return static_cast<::std::size_t>(r); }
+   );
+}
+
+/**
+ * \brief See vmsplice(2), map user memory into a pipe.
+ *
+ * Without `spliceflags::gift` the data is still copied, but with one system
+ * call for many pieces. With it, the pages must not be touched again.
+ */
+expected<::std::size_t>
+inline vmsplice(fd const &pipe, ::std::span<const_iovec const> iov,
+                spliceflags flags = spliceflags{}) noexcept
+{
+   auto const bits = static_cast<unsigned>(flags.getbits());
+   return error_cascade(
+        ::syscalls::linux::vmsplice(pipe.as_fd(), iov.data(), iov.size(), bits),
+        [](auto r) { return static_cast<::std::size_t>(r); }
+   );
+}
+
+/**
+ * \brief See copy_file_range(2), copy between regular files.
+ *
+ * Filesystems that support it (btrfs, XFS, NFS, ...) can share the blocks
+ * instead of copying them.
+ */
+expected<::std::size_t>
+inline copy_file_range(fd const &in, ::std::int64_t *off_in,
+                       fd const &out, ::std::int64_t *off_out,
+                       ::std::size_t len) noexcept
+{
+   return error_cascade(
+        ::syscalls::linux::copy_file_range(in.as_fd(), off_in,
+                                           out.as_fd(), off_out, len, 0),
+        [](auto r) { return static_cast<::std::size_t>(r); }
+   );
+}
+///@}
+
+//! The two ends of a pipe.
+struct pipe_fds {
+   fd read_end;
+   fd write_end;
+};
+
+//! See pipe2(2), `flags` can have `fdflags::cloexec` and `fdflags::nonblock`.
+[[nodiscard]] inline expected<pipe_fds> pipe(fdflags flags = fdflags{}) noexcept
+{
+   using errtag = expected<pipe_fds>::err_tag;
+   int fds[2];
+   auto const result =
+        ::syscalls::linux::pipe2(fds, static_cast<int>(flags.getbits()));
+   if (result.has_error()) {
+      return expected<pipe_fds>{errtag{}, result.error()};
+   }
+   return expected<pipe_fds>{pipe_fds{fd{fds[0]}, fd{fds[1]}}};
+}
+
+namespace priv_ {
+//! Errors meaning a mechanism doesn't work for these kinds of fds.
+inline bool is_unsupported_transfer(int ec) noexcept
+{
+   using ::std::errc;
+   return ec == static_cast<int>(errc::invalid_argument)
+          || ec == static_cast<int>(errc::cross_device_link)
+          || ec == static_cast<int>(errc::function_not_supported)
+          || ec == static_cast<int>(errc::operation_not_supported);
+}
+
+enum class transfer_step { done, next, failed };
+
+/**
+ * \brief Keep calling `step(remaining)` until `total` reaches `n`, EOF or an
+ * error.
+ *
+ * If the mechanism says it isn't supported before any data has been moved,
+ * returns `transfer_step::next` so the caller can try something else. With
+ * `zero_unsupported`, moving nothing on the first try counts as saying so.
+ */
+template <typename Step>
+transfer_step transfer_with(Step step, ::std::size_t n,
+                            ::std::size_t &total, int &error,
+                            bool zero_unsupported = false) noexcept
+{
+   using ::std::errc;
+   while (total < n) {
+      expected<::std::size_t> const result = step(n - total);
+      if (result.has_error()) {
+         if (result.error() == static_cast<int>(errc::interrupted)) {
+            continue;
+         }
+         error = result.error();
+         if (total == 0 && is_unsupported_transfer(error)) {
+            return transfer_step::next;
+         }
+         return transfer_step::failed;
+      }
+      if (result.result() == 0) {
+         if (total == 0 && zero_unsupported) {
+            return transfer_step::next;
+         }
+         break;
+      }
+      total += result.result();
+   }
+   return transfer_step::done;
+}
+} // namespace priv_
+
+/**
+ * \brief Copy up to `n` bytes from `src` to `dst`, using their file
+ * positions, with the fastest mechanism that works for them.
+ *
+ * In order, this tries copy_file_range (both regular files), sendfile (`src`
+ * is a regular file), splice (either one is a pipe) and finally read and
+ * write through a buffer. Which ones work is found out by trying them, since
+ * the kernel's rules for each change from version to version, and a mechanism
+ * is only abandoned if it fails before moving any data.
+ *
+ * It stops early at the end of `src`, and returns how much was copied.
+ */
+inline expected<::std::size_t>
+transfer(fd const &src, fd const &dst, ::std::size_t n) noexcept
+{
+   using priv_::transfer_step;
+   using ::std::errc;
+   using errtag = expected<::std::size_t>::err_tag;
+   // The kernel won't do more than this in one call anyway.
+   constexpr ::std::size_t max_chunk = 0x7ffff000;
+   auto const chunk = [](::std::size_t left) {
+      return left < max_chunk ? left : max_chunk;
+   };
+   ::std::size_t total = 0;
+   int error = 0;
+
+   // From 5.3 to 5.18 copy_file_range copies nothing from procfs and sysfs
+   // files, which look empty to it, so a 0 first off isn't believed.
+   auto step = priv_::transfer_with(
+        [&](::std::size_t left) {
+           return copy_file_range(src, nullptr, dst, nullptr, chunk(left));
+        }, n, total, error, true);
+   if (step == transfer_step::next) {
+      step = priv_::transfer_with(
+           [&](::std::size_t left) {
+              return sendfile(dst, src, chunk(left));
+           }, n, total, error);
+   }
+   if (step == transfer_step::next) {
+      step = priv_::transfer_with(
+           [&](::std::size_t left) {
+              return splice(src, nullptr, dst, nullptr, chunk(left),
+                            spliceflags::move);
+           }, n, total, error);
+   }
+   if (step == transfer_step::next) {
+      char buf[16 * 1024];
+      step = priv_::transfer_with(
+           [&](::std::size_t left) -> expected<::std::size_t> {
+              ::std::size_t const want = left < sizeof(buf) ? left : sizeof(buf);
+              auto const got = read(src, buf, want);
+              if (got.has_error() || got.result() == 0) {
+                 return got;
+              }
+              for (::std::size_t done = 0; done < got.result(); ) {
+                 auto const put = write(dst, buf + done, got.result() - done);
+                 if (!put.has_error()) {
+                    done += put.result();
+                 } else if (put.error() != static_cast<int>(errc::interrupted)) {
+                    return put;
+                 }
+              }
+              return got;
+           }, n, total, error);
+   }
+   if (step != transfer_step::done) {
+      return expected<::std::size_t>{errtag{}, error};
+   }
+   return expected<::std::size_t>{total};
+}
+
+} // namespace posixpp
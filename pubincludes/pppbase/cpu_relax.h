@@ -0,0 +1,17 @@
+#pragma once  /*-*-c++-*-*/
+
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+namespace pppbase {
+
+//! Tell the CPU this is a spin-wait loop, so it can save power or yield to a
+//! sibling hyperthread.
+inline void cpu_relax() noexcept
+{
+#if defined(__x86_64__) || defined(__i386__)
+   __builtin_ia32_pause();
+#endif
+}
+
+} // namespace pppbase
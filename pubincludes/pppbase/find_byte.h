@@ -0,0 +1,57 @@
+#pragma once  /*-*-c++-*-*/
+
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace pppbase {
+
+/**
+ * \brief Find the first `c` in [first, last), or return `last`.
+ *
+ * This looks at 32 bytes at a time when compiled with AVX2 enabled, and 16 at
+ * a time with SSE2 (which every x86_64 CPU has). It doesn't need libc, and
+ * being inline it avoids a call for the short searches typical of splitting
+ * lines.
+ */
+inline char const *find_byte(char const *first, char const *last,
+                             char c) noexcept
+{
+#if defined(__AVX2__)
+   __m256i const needle32 = _mm256_set1_epi8(c);
+   while (last - first >= 32) {
+      __m256i const chunk =
+           _mm256_loadu_si256(reinterpret_cast<__m256i const *>(first));
+      auto const mask = static_cast<unsigned>(
+           _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle32))
+      );
+      if (mask != 0) {
+         return first + __builtin_ctz(mask);
+      }
+      first += 32;
+   }
+#endif
+#if defined(__SSE2__)
+   __m128i const needle16 = _mm_set1_epi8(c);
+   while (last - first >= 16) {
+      __m128i const chunk =
+           _mm_loadu_si128(reinterpret_cast<__m128i const *>(first));
+      auto const mask = static_cast<unsigned>(
+           _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle16))
+      );
+      if (mask != 0) {
+         return first + __builtin_ctz(mask);
+      }
+      first += 16;
+   }
+#endif
+   while (first != last && *first != c) {
+      ++first;
+   }
+   return first;
+}
+
+} // namespace pppbase
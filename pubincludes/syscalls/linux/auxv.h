@@ -0,0 +1,72 @@
+// Copyright 2021 by Eric Hopper
+// Distributed under the terms of the LGPLv3.
+#pragma once  // -*- c++ -*-
+
+#include <cstdint>
+#include <optional>
+
+namespace syscalls::linux {
+
+//! The types of entries in the auxiliary vector, see getauxval(3).
+enum class auxv_type : ::std::uint64_t {
+   null = 0,
+   ignore = 1,
+   execfd = 2,
+   phdr = 3,
+   phent = 4,
+   phnum = 5,
+   pagesz = 6,
+   base = 7,
+   flags = 8,
+   entry = 9,
+   notelf = 10,
+   uid = 11,
+   euid = 12,
+   gid = 13,
+   egid = 14,
+   platform = 15,
+   hwcap = 16,
+   clktck = 17,
+   secure = 23,
+   base_platform = 24,
+   random = 25,
+   hwcap2 = 26,
+   execfn = 31,
+   sysinfo_ehdr = 33,
+   minsigstksz = 51
+};
+
+//! One entry in the auxiliary vector the kernel places after the environment.
+struct auxv_entry {
+   auxv_type a_type;
+   ::std::uint64_t a_val;
+};
+
+/**
+ * \brief Find the auxiliary vector given the `envp` handed to `main`.
+ *
+ * The kernel places the auxiliary vector immediately after the `nullptr` that
+ * terminates the initial environment. This only works with the original
+ * `envp`, not one that's been altered by something like setenv(3).
+ */
+inline auxv_entry const *auxv_from_envp(char const * const *envp) noexcept
+{
+   while (*envp != nullptr) {
+      ++envp;
+   }
+   return reinterpret_cast<auxv_entry const *>(envp + 1);
+}
+
+//! Find the value associated with `type`, if there is one.
+inline ::std::optional<::std::uint64_t>
+auxv_lookup(auxv_entry const *auxv, auxv_type type) noexcept
+{
+   for (; auxv->a_type != auxv_type::null; ++auxv) {
+      if (auxv->a_type == type) {
+         return auxv->a_val;
+      }
+   }
+   return ::std::nullopt;
+}
+
+} // namespace syscalls::linux
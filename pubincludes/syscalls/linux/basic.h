@@ -17,4 +17,9 @@ inline void exit_group [[noreturn]](int status) noexcept {
    __builtin_unreachable();
 }
 
+//! Let other threads run first, see sched_yield(2). It can't fail.
+inline void sched_yield() noexcept {
+   static_cast<void>(syscall_expected(call_id::sched_yield));
+}
+
 } // namespace syscalls::linux
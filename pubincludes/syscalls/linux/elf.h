@@ -0,0 +1,99 @@
+// Copyright 2021 by Eric Hopper
+// Distributed under the terms of the LGPLv3.
+#pragma once  // -*- c++ -*-
+
+#include <cstdint>
+
+// Just enough of the ELF64 format to find things in images the kernel has
+// already loaded, like the vDSO or the program's own headers. See elf(5).
+
+namespace syscalls::linux::elf {
+
+struct ehdr {
+   unsigned char e_ident[16];
+   ::std::uint16_t e_type;
+   ::std::uint16_t e_machine;
+   ::std::uint32_t e_version;
+   ::std::uint64_t e_entry;
+   ::std::uint64_t e_phoff;
+   ::std::uint64_t e_shoff;
+   ::std::uint32_t e_flags;
+   ::std::uint16_t e_ehsize;
+   ::std::uint16_t e_phentsize;
+   ::std::uint16_t e_phnum;
+   ::std::uint16_t e_shentsize;
+   ::std::uint16_t e_shnum;
+   ::std::uint16_t e_shstrndx;
+};
+
+struct phdr {
+   ::std::uint32_t p_type;
+   ::std::uint32_t p_flags;
+   ::std::uint64_t p_offset;
+   ::std::uint64_t p_vaddr;
+   ::std::uint64_t p_paddr;
+   ::std::uint64_t p_filesz;
+   ::std::uint64_t p_memsz;
+   ::std::uint64_t p_align;
+};
+
+struct dyn {
+   ::std::int64_t d_tag;
+   ::std::uint64_t d_val;
+};
+
+struct sym {
+   ::std::uint32_t st_name;
+   unsigned char st_info;
+   unsigned char st_other;
+   ::std::uint16_t st_shndx;
+   ::std::uint64_t st_value;
+   ::std::uint64_t st_size;
+};
+
+struct verdef {
+   ::std::uint16_t vd_version;
+   ::std::uint16_t vd_flags;
+   ::std::uint16_t vd_ndx;
+   ::std::uint16_t vd_cnt;
+   ::std::uint32_t vd_hash;
+   ::std::uint32_t vd_aux;
+   ::std::uint32_t vd_next;
+};
+
+struct verdaux {
+   ::std::uint32_t vda_name;
+   ::std::uint32_t vda_next;
+};
+
+static_assert(sizeof(ehdr) == 64);
+static_assert(sizeof(phdr) == 56);
+static_assert(sizeof(dyn) == 16);
+static_assert(sizeof(sym) == 24);
+
+// Values for `phdr::p_type`
+inline constexpr ::std::uint32_t pt_load = 1;
+inline constexpr ::std::uint32_t pt_dynamic = 2;
+inline constexpr ::std::uint32_t pt_phdr = 6;
+inline constexpr ::std::uint32_t pt_tls = 7;
+
+// Values for `dyn::d_tag`
+inline constexpr ::std::int64_t dt_null = 0;
+inline constexpr ::std::int64_t dt_hash = 4;
+inline constexpr ::std::int64_t dt_strtab = 5;
+inline constexpr ::std::int64_t dt_symtab = 6;
+inline constexpr ::std::int64_t dt_gnu_hash = 0x6ffffef5;
+inline constexpr ::std::int64_t dt_versym = 0x6ffffff0;
+inline constexpr ::std::int64_t dt_verdef = 0x6ffffffc;
+
+// Pieces of `sym::st_info` and `sym::st_shndx`
+inline constexpr unsigned char stt_func = 2;
+inline constexpr unsigned char stb_global = 1;
+inline constexpr unsigned char stb_weak = 2;
+inline constexpr ::std::uint16_t shn_undef = 0;
+
+// Bits in a versym entry
+inline constexpr ::std::uint16_t versym_hidden = 0x8000;
+inline constexpr ::std::uint16_t verdef_base = 0x1;
+
+} // namespace syscalls::linux::elf
@@ -0,0 +1,52 @@
+// Copyright 2021 by Eric Hopper
+// Distributed under the terms of the LGPLv3.
+#pragma once  // -*- c++ -*-
+
+#include <cstdint>
+#include <syscalls/linux/syscall.h>
+
+namespace syscalls::linux {
+
+/**
+ * \brief Same layout as `struct epoll_event`.
+ *
+ * On x86_64 (and only there) the kernel's structure is packed, so `data`
+ * isn't 8 byte aligned.
+ */
+struct [[gnu::packed]] epoll_event {
+   ::std::uint32_t events;
+   ::std::uint64_t data;
+};
+static_assert(sizeof(epoll_event) == 12);
+
+//! Operations for epoll_ctl(2)
+enum class epoll_op : int {
+   add = 1,
+   del = 2,
+   mod = 3
+};
+
+inline expected_t epoll_create1(int flags) noexcept
+{
+   return syscall_expected(call_id::epoll_create1, flags);
+}
+
+inline ::posixpp::expected<void>
+epoll_ctl(int epfd, epoll_op op, int fd, epoll_event *event) noexcept
+{
+   return error_cascade_void(
+        syscall_expected(call_id::epoll_ctl, epfd, static_cast<int>(op), fd,
+                         static_cast<void *>(event))
+   );
+}
+
+//! The signal mask is always null, which makes this the same as epoll_wait(2).
+inline expected_t epoll_pwait(int epfd, epoll_event *events, int maxevents,
+                              int timeout_ms) noexcept
+{
+   return syscall_expected(call_id::epoll_pwait, epfd,
+                           static_cast<void *>(events), maxevents, timeout_ms,
+                           static_cast<void *>(nullptr), 8);
+}
+
+} // namespace syscalls::linux
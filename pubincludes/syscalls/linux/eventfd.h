@@ -0,0 +1,14 @@
+// Copyright 2021 by Eric Hopper
+// Distributed under the terms of the LGPLv3.
+#pragma once  // -*- c++ -*-
+
+#include <syscalls/linux/syscall.h>
+
+namespace syscalls::linux {
+
+inline expected_t eventfd2(unsigned initval, int flags) noexcept
+{
+   return syscall_expected(call_id::eventfd2, initval, flags);
+}
+
+} // namespace syscalls::linux
@@ -0,0 +1,86 @@
+// Copyright 2021 by Eric Hopper
+// Distributed under the terms of the LGPLv3.
+#pragma once  // -*- c++ -*-
+
+#include <cstdint>
+#include <syscalls/linux/syscall.h>
+#include <syscalls/linux/time.h>
+
+namespace syscalls::linux {
+
+//! The futex operations, see futex(2).
+enum class futex_op : int {
+   wait = 0,
+   wake,
+   fd,
+   requeue,
+   cmp_requeue,
+   wake_op,
+   lock_pi,
+   unlock_pi,
+   trylock_pi,
+   wait_bitset,
+   wake_bitset,
+   wait_requeue_pi,
+   cmp_requeue_pi
+};
+
+// Bits that can be or'ed into a futex_op.
+inline constexpr int futex_private_flag = 128;
+inline constexpr int futex_clock_realtime = 256;
+
+//! A bitset for wait_bitset and wake_bitset that matches everything.
+inline constexpr ::std::uint32_t futex_bitset_match_any = 0xffffffffU;
+
+/**
+ * \brief The raw futex system call.
+ *
+ * @param process_private Whether the futex is only used within this process.
+ * This is much cheaper for the kernel, but a waiter and waker have to agree on
+ * it or the waiter will never be woken.
+ *
+ * @param timeout Either a `timespec const *` or a count, depending on `op`.
+ */
+inline expected_t futex(::std::uint32_t *uaddr, futex_op op,
+                        bool process_private, ::std::uint32_t val,
+                        void const *timeout,
+                        ::std::uint32_t *uaddr2, ::std::uint32_t val3) noexcept
+{
+   int const opval = static_cast<int>(op)
+                     | (process_private ? futex_private_flag : 0);
+   return syscall_expected(call_id::futex,
+                           uaddr, opval, val, timeout, uaddr2, val3);
+}
+
+// Flags for a futex_waitv_entry.
+inline constexpr ::std::uint32_t futex2_size_u32 = 0x02;
+inline constexpr ::std::uint32_t futex2_private = 128;
+
+//! Most futexes futex_waitv(2) will wait on at once.
+inline constexpr unsigned futex_waitv_max = 128;
+
+//! The kernel's `struct futex_waitv`, one futex for futex_waitv(2).
+struct futex_waitv_entry {
+   //! What the futex word has to contain for the wait to start.
+   ::std::uint64_t val;
+   ::std::uint64_t uaddr;
+   ::std::uint32_t flags;
+   ::std::uint32_t reserved;
+};
+
+/**
+ * \brief Wait until any of `nr_futexes` futexes is woken, see futex_waitv(2).
+ *
+ * Returns the index of the one that was woken. `timeout` is absolute, on
+ * `clock` (which must be monotonic or realtime), and may be null to wait
+ * forever. Needs Linux 5.16.
+ */
+inline expected_t futex_waitv(futex_waitv_entry *waiters, unsigned nr_futexes,
+                              timespec const *timeout, clockid clock) noexcept
+{
+   // The flags argument is unused and must be 0.
+   return syscall_expected(call_id::futex_waitv, waiters, nr_futexes, 0,
+                           timeout, static_cast<int>(clock));
+}
+
+} // namespace syscalls::linux
@@ -0,0 +1,177 @@
+// Copyright 2021 by Eric Hopper
+// Distributed under the terms of the LGPLv3.
+#pragma once  // -*- c++ -*-
+
+#include <cstdint>
+#include <syscalls/linux/syscall.h>
+
+// The io_uring ABI is the same on every architecture, so unlike the flag
+// values in the architecture specific directories, it lives here.
+
+namespace syscalls::linux {
+
+//! Offsets of the interesting fields in the submission queue ring mapping.
+struct io_sqring_offsets {
+   ::std::uint32_t head;
+   ::std::uint32_t tail;
+   ::std::uint32_t ring_mask;
+   ::std::uint32_t ring_entries;
+   ::std::uint32_t flags;
+   ::std::uint32_t dropped;
+   ::std::uint32_t array;
+   ::std::uint32_t resv1;
+   ::std::uint64_t resv2;
+};
+
+//! Offsets of the interesting fields in the completion queue ring mapping.
+struct io_cqring_offsets {
+   ::std::uint32_t head;
+   ::std::uint32_t tail;
+   ::std::uint32_t ring_mask;
+   ::std::uint32_t ring_entries;
+   ::std::uint32_t overflow;
+   ::std::uint32_t cqes;
+   ::std::uint32_t flags;
+   ::std::uint32_t resv1;
+   ::std::uint64_t resv2;
+};
+
+//! Filled in by io_uring_setup(2) to describe the rings.
+struct io_uring_params {
+   ::std::uint32_t sq_entries;
+   ::std::uint32_t cq_entries;
+   ::std::uint32_t flags;
+   ::std::uint32_t sq_thread_cpu;
+   ::std::uint32_t sq_thread_idle;
+   ::std::uint32_t features;
+   ::std::uint32_t wq_fd;
+   ::std::uint32_t resv[3];
+   io_sqring_offsets sq_off;
+   io_cqring_offsets cq_off;
+};
+
+//! A submission queue entry.
+///
+/// The kernel has a lot of unions in here. Since they're all the same size,
+/// only one name is given for each, with the other uses noted.
+struct io_uring_sqe {
+   ::std::uint8_t opcode;
+   ::std::uint8_t flags;
+   ::std::uint16_t ioprio;
+   ::std::int32_t fd;
+   ::std::uint64_t off;        // Also addr2
+   ::std::uint64_t addr;       // Also splice_off_in
+   ::std::uint32_t len;
+   ::std::uint32_t op_flags;   // rw_flags, fsync_flags, open_flags, etc...
+   ::std::uint64_t user_data;
+   ::std::uint16_t buf_index;
+   ::std::uint16_t personality;
+   ::std::int32_t splice_fd_in;
+   ::std::uint64_t pad2[2];
+};
+
+//! A completion queue entry.
+struct io_uring_cqe {
+   ::std::uint64_t user_data;
+   ::std::int32_t res;
+   ::std::uint32_t flags;
+};
+
+static_assert(sizeof(io_uring_params) == 120);
+static_assert(sizeof(io_uring_sqe) == 64);
+static_assert(sizeof(io_uring_cqe) == 16);
+
+//! The operations that can be placed in `io_uring_sqe::opcode`.
+enum class io_uring_op : ::std::uint8_t {
+   nop = 0,
+   readv,
+   writev,
+   fsync,
+   read_fixed,
+   write_fixed,
+   poll_add,
+   poll_remove,
+   sync_file_range,
+   sendmsg,
+   recvmsg,
+   timeout,
+   timeout_remove,
+   accept,
+   async_cancel,
+   link_timeout,
+   connect,
+   fallocate,
+   openat,
+   close,
+   files_update,
+   statx,
+   read,
+   write,
+   fadvise,
+   madvise,
+   send,
+   recv,
+   openat2,
+   epoll_ctl,
+   splice,
+   provide_buffers,
+   remove_buffers,
+   tee
+};
+
+//! The operations that can be passed to io_uring_register(2).
+enum class io_uring_register_op : unsigned {
+   register_buffers = 0,
+   unregister_buffers,
+   register_files,
+   unregister_files,
+   register_eventfd,
+   unregister_eventfd,
+   register_files_update,
+   register_eventfd_async,
+   register_probe,
+   register_personality,
+   unregister_personality
+};
+
+// Magic offsets for mmap(2) of the various parts of the ring.
+inline constexpr ::std::int64_t ioring_off_sq_ring = 0;
+inline constexpr ::std::int64_t ioring_off_cq_ring = 0x8000000;
+inline constexpr ::std::int64_t ioring_off_sqes = 0x10000000;
+
+// Bits for `io_uring_params::features`
+inline constexpr ::std::uint32_t ioring_feat_single_mmap = 1U << 0U;
+inline constexpr ::std::uint32_t ioring_feat_nodrop = 1U << 1U;
+
+// Bits for the `flags` argument of io_uring_enter(2)
+inline constexpr unsigned ioring_enter_getevents = 1U << 0U;
+inline constexpr unsigned ioring_enter_sq_wakeup = 1U << 1U;
+
+// Bits for `io_uring_sqe::op_flags` when the opcode is fsync.
+inline constexpr ::std::uint32_t ioring_fsync_datasync = 1U << 0U;
+
+inline expected_t io_uring_setup(unsigned entries, io_uring_params *p) noexcept
+{
+   return syscall_expected(call_id::io_uring_setup, entries, p);
+}
+
+inline expected_t io_uring_enter(int fd,
+                                 unsigned to_submit, unsigned min_complete,
+                                 unsigned flags) noexcept
+{
+   // The last two arguments are a signal mask to atomically set during the
+   // wait, and its size. No signal mask is the same as not changing it.
+   constexpr ::std::int64_t sigset_size = 64 / 8;
+   return syscall_expected(call_id::io_uring_enter,
+                           fd, to_submit, min_complete, flags,
+                           static_cast<void *>(nullptr), sigset_size);
+}
+
+inline expected_t io_uring_register(int fd, io_uring_register_op opcode,
+                                    void const *arg, unsigned nr_args) noexcept
+{
+   return syscall_expected(call_id::io_uring_register,
+                           fd, static_cast<unsigned>(opcode), arg, nr_args);
+}
+
+} // namespace syscalls::linux
@@ -0,0 +1,68 @@
+// Copyright 2021 by Eric Hopper
+// Distributed under the terms of the LGPLv3.
+#pragma once  // -*- c++ -*-
+
+#include <cstdint>
+#include <cstddef>
+#include <syscalls/linux/syscall.h>
+
+namespace syscalls::linux {
+
+inline expected_t mmap(void *addr, ::std::size_t length, int prot, int flags,
+                       int fd, ::std::int64_t offset) noexcept
+{
+   return syscall_expected(call_id::mmap, addr, length, prot, flags, fd, offset);
+}
+
+inline ::posixpp::expected<void> munmap(void *addr, ::std::size_t length) noexcept
+{
+   return error_cascade_void(syscall_expected(call_id::munmap, addr, length));
+}
+
+inline ::posixpp::expected<void>
+mprotect(void *addr, ::std::size_t length, int prot) noexcept
+{
+   return error_cascade_void(syscall_expected(call_id::mprotect, addr, length, prot));
+}
+
+//! The advice argument to madvise(2).
+enum class madvice : int {
+   normal = 0,
+   random = 1,
+   sequential = 2,
+   willneed = 3,
+   dontneed = 4,
+   free = 8,
+   remove = 9,
+   dontfork = 10,
+   dofork = 11,
+   mergeable = 12,
+   unmergeable = 13,
+   hugepage = 14,
+   nohugepage = 15,
+   dontdump = 16,
+   dodump = 17,
+   cold = 20,
+   pageout = 21,
+   populate_read = 22,
+   populate_write = 23
+};
+
+inline ::posixpp::expected<void>
+madvise(void *addr, ::std::size_t length, madvice advice) noexcept
+{
+   return error_cascade_void(
+        syscall_expected(call_id::madvise, addr, length, static_cast<int>(advice))
+   );
+}
+
+//! See mremap(2), returns the new address.
+inline expected_t mremap(void *old_addr, ::std::size_t old_size,
+                         ::std::size_t new_size, int flags,
+                         void *new_addr) noexcept
+{
+   return syscall_expected(call_id::mremap, old_addr, old_size, new_size,
+                           flags, new_addr);
+}
+
+} // namespace syscalls::linux
@@ -1,5 +1,6 @@
 #pragma once // -*- c++ -*-
 
+#include <cstddef>
 #include <cstdint>
 #include <syscalls/linux/syscall.h>
 
@@ -25,6 +26,65 @@ inline expected_t write(int fd, char const *data, ::std::int64_t size) noexcept
    return syscall_expected(call_id::write, fd, data, size);
 }
 
+//! Same layout as `struct iovec`, see readv(2).
+struct iovec {
+   void *iov_base;
+   ::std::size_t iov_len;
+};
+
+//! `struct iovec` for memory that will only be read from, as by writev(2).
+struct const_iovec {
+   void const *iov_base;
+   ::std::size_t iov_len;
+};
+static_assert(sizeof(iovec) == 16 && sizeof(const_iovec) == 16);
+
+inline expected_t pread64(int fd, char *data, ::std::int64_t size,
+                          ::std::int64_t offset) noexcept
+{
+   return syscall_expected(call_id::pread64, fd, data, size, offset);
+}
+
+inline expected_t pwrite64(int fd, char const *data, ::std::int64_t size,
+                           ::std::int64_t offset) noexcept
+{
+   return syscall_expected(call_id::pwrite64, fd, data, size, offset);
+}
+
+inline expected_t readv(int fd, iovec const *iov, int iovcnt) noexcept
+{
+   return syscall_expected(call_id::readv, fd,
+                           static_cast<void const *>(iov), iovcnt);
+}
+
+inline expected_t writev(int fd, const_iovec const *iov, int iovcnt) noexcept
+{
+   return syscall_expected(call_id::writev, fd,
+                           static_cast<void const *>(iov), iovcnt);
+}
+
+// The kernel splits the offset into two registers for the benefit of 32 bit
+// platforms, on x86_64 the whole thing goes in the first and the second is
+// ignored.
+
+//! An `offset` of -1 means to use and update the file position.
+inline expected_t preadv2(int fd, iovec const *iov, int iovcnt,
+                          ::std::int64_t offset, int flags) noexcept
+{
+   return syscall_expected(call_id::preadv2, fd,
+                           static_cast<void const *>(iov), iovcnt,
+                           offset, 0, flags);
+}
+
+//! An `offset` of -1 means to use and update the file position.
+inline expected_t pwritev2(int fd, const_iovec const *iov, int iovcnt,
+                           ::std::int64_t offset, int flags) noexcept
+{
+   return syscall_expected(call_id::pwritev2, fd,
+                           static_cast<void const *>(iov), iovcnt,
+                           offset, 0, flags);
+}
+
 inline ::posixpp::expected<void> close(int fd) noexcept
 {
    return error_cascade_void(syscall_expected(call_id::close, fd));
@@ -45,9 +105,19 @@ inline expected_t dup3(int oldfd, int newfd, int flags) noexcept
    return syscall_expected(call_id::dup3, oldfd, newfd, flags);
 }
 
-inline expected_t fcntl(int fd, int cmd, void *val) noexcept
+//! Commands for fcntl(2)
+enum class fcntl_cmd : int {
+   dupfd = 0,
+   getfd = 1,
+   setfd = 2,
+   getfl = 3,
+   setfl = 4,
+   dupfd_cloexec = 1030
+};
+
+inline expected_t fcntl(int fd, fcntl_cmd cmd, void *val) noexcept
 {
-   return syscall_expected(call_id::fcntl, fd, val);
+   return syscall_expected(call_id::fcntl, fd, static_cast<int>(cmd), val);
 }
 
 } // namespace syscalls::linux
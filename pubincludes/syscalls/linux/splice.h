@@ -0,0 +1,62 @@
+// Copyright 2021 by Eric Hopper
+// Distributed under the terms of the LGPLv3.
+#pragma once  // -*- c++ -*-
+
+#include <cstddef>
+#include <cstdint>
+#include <syscalls/linux/simple_io.h>
+#include <syscalls/linux/syscall.h>
+
+namespace syscalls::linux {
+
+// For all of these, a null offset pointer means to use and update the file
+// position instead.
+
+inline expected_t sendfile(int out_fd, int in_fd, ::std::int64_t *offset,
+                           ::std::size_t count) noexcept
+{
+   return syscall_expected(call_id::sendfile, out_fd, in_fd,
+                           static_cast<void *>(offset), count);
+}
+
+inline expected_t splice(int fd_in, ::std::int64_t *off_in,
+                         int fd_out, ::std::int64_t *off_out,
+                         ::std::size_t len, unsigned flags) noexcept
+{
+   return syscall_expected(call_id::splice,
+                           fd_in, static_cast<void *>(off_in),
+                           fd_out, static_cast<void *>(off_out),
+                           len, flags);
+}
+
+inline expected_t tee(int fd_in, int fd_out, ::std::size_t len,
+                      unsigned flags) noexcept
+{
+   return syscall_expected(call_id::tee, fd_in, fd_out, len, flags);
+}
+
+inline expected_t vmsplice(int fd, const_iovec const *iov,
+                           ::std::size_t nr_segs, unsigned flags) noexcept
+{
+   return syscall_expected(call_id::vmsplice, fd,
+                           static_cast<void const *>(iov), nr_segs, flags);
+}
+
+inline expected_t copy_file_range(int fd_in, ::std::int64_t *off_in,
+                                  int fd_out, ::std::int64_t *off_out,
+                                  ::std::size_t len, unsigned flags) noexcept
+{
+   return syscall_expected(call_id::copy_file_range,
+                           fd_in, static_cast<void *>(off_in),
+                           fd_out, static_cast<void *>(off_out),
+                           len, flags);
+}
+
+inline ::posixpp::expected<void> pipe2(int pipefd[2], int flags) noexcept
+{
+   return error_cascade_void(
+        syscall_expected(call_id::pipe2, static_cast<void *>(pipefd), flags)
+   );
+}
+
+} // namespace syscalls::linux
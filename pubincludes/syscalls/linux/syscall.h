@@ -12,6 +12,7 @@
 namespace syscalls::linux {
 
 using x86_64::syscall_expected;
+using x86_64::syscall_val;
 using x86_64::expected_t;
 using x86_64::call_id;
 
@@ -0,0 +1,65 @@
+// Copyright 2021 by Eric Hopper
+// Distributed under the terms of the LGPLv3.
+#pragma once  // -*- c++ -*-
+
+#include <cstdint>
+#include <syscalls/linux/syscall.h>
+
+namespace syscalls::linux {
+
+//! The kernel's `struct timespec`.
+struct timespec {
+   ::std::int64_t tv_sec;
+   ::std::int64_t tv_nsec;
+};
+
+//! The kernel's `struct timeval`.
+struct timeval {
+   ::std::int64_t tv_sec;
+   ::std::int64_t tv_usec;
+};
+
+//! Clocks that can be handed to clock_gettime(2) and friends.
+enum class clockid : int {
+   realtime = 0,
+   monotonic = 1,
+   process_cputime_id = 2,
+   thread_cputime_id = 3,
+   monotonic_raw = 4,
+   realtime_coarse = 5,
+   monotonic_coarse = 6,
+   boottime = 7,
+   realtime_alarm = 8,
+   boottime_alarm = 9,
+   tai = 11
+};
+
+inline expected_t clock_gettime(clockid clock, timespec *tp) noexcept
+{
+   return syscall_expected(call_id::clock_gettime, static_cast<int>(clock), tp);
+}
+
+inline expected_t clock_getres(clockid clock, timespec *res) noexcept
+{
+   return syscall_expected(call_id::clock_getres, static_cast<int>(clock), res);
+}
+
+inline expected_t gettimeofday(timeval *tv) noexcept
+{
+   // The timezone argument is obsolete, and always NULL.
+   return syscall_expected(call_id::gettimeofday, tv, static_cast<void *>(nullptr));
+}
+
+inline expected_t time(::std::int64_t *tloc) noexcept
+{
+   return syscall_expected(call_id::time, tloc);
+}
+
+inline expected_t getcpu(unsigned *cpu, unsigned *node) noexcept
+{
+   // The last argument is an obsolete cache that's ignored by the kernel.
+   return syscall_expected(call_id::getcpu, cpu, node,
+                           static_cast<void *>(nullptr));
+}
+
+} // namespace syscalls::linux
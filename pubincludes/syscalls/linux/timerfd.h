@@ -0,0 +1,35 @@
+// Copyright 2021 by Eric Hopper
+// Distributed under the terms of the LGPLv3.
+#pragma once  // -*- c++ -*-
+
+#include <syscalls/linux/syscall.h>
+#include <syscalls/linux/time.h>
+
+namespace syscalls::linux {
+
+//! The kernel's `struct itimerspec`.
+struct itimerspec {
+   timespec it_interval;
+   timespec it_value;
+};
+
+inline expected_t timerfd_create(clockid clock, int flags) noexcept
+{
+   return syscall_expected(call_id::timerfd_create, static_cast<int>(clock),
+                           flags);
+}
+
+inline expected_t timerfd_settime(int fd, int flags,
+                                  itimerspec const *new_value,
+                                  itimerspec *old_value) noexcept
+{
+   return syscall_expected(call_id::timerfd_settime,
+                           fd, flags, new_value, old_value);
+}
+
+inline expected_t timerfd_gettime(int fd, itimerspec *curr_value) noexcept
+{
+   return syscall_expected(call_id::timerfd_gettime, fd, curr_value);
+}
+
+} // namespace syscalls::linux
@@ -0,0 +1,184 @@
+// Copyright 2021 by Eric Hopper
+// Distributed under the terms of the LGPLv3.
+#pragma once  // -*- c++ -*-
+
+#include <cstdint>
+#include <syscalls/linux/elf.h>
+
+namespace syscalls::linux {
+
+/**
+ * \brief Symbol lookup in the vDSO the kernel maps into every process.
+ *
+ * See vdso(7). The vDSO is a tiny, already relocated shared library, so
+ * finding a symbol only requires walking its dynamic symbol table. This does
+ * the same job as the kernel's own `parse_vdso.c`, but without libc.
+ */
+class vdso_image {
+ public:
+   //! An image that doesn't contain any symbols.
+   constexpr vdso_image() noexcept = default;
+
+   //! \brief Parse the image at `base`, the value of `AT_SYSINFO_EHDR`.
+   explicit vdso_image(void const *base) noexcept {
+      namespace elf = ::syscalls::linux::elf;
+      auto const *const bytes = static_cast<char const *>(base);
+      auto const *const eh = static_cast<elf::ehdr const *>(base);
+      auto const *const ph =
+           reinterpret_cast<elf::phdr const *>(bytes + eh->e_phoff);
+
+      elf::dyn const *dynamic = nullptr;
+      bool found_load = false;
+      for (unsigned i = 0; i < eh->e_phnum; ++i) {
+         if (ph[i].p_type == elf::pt_load && !found_load) {
+            found_load = true;
+            load_offset_ = reinterpret_cast<::std::uintptr_t>(bytes)
+                           + ph[i].p_offset - ph[i].p_vaddr;
+         } else if (ph[i].p_type == elf::pt_dynamic) {
+            dynamic = reinterpret_cast<elf::dyn const *>(bytes + ph[i].p_offset);
+         }
+      }
+      if (!found_load || dynamic == nullptr) {
+         return;
+      }
+
+      ::std::uint32_t const *hash = nullptr;
+      ::std::uint32_t const *gnu_hash = nullptr;
+      for (auto const *d = dynamic; d->d_tag != elf::dt_null; ++d) {
+         switch (d->d_tag) {
+          case elf::dt_strtab:
+            strtab_ = as_ptr<char>(d->d_val);
+            break;
+          case elf::dt_symtab:
+            symtab_ = as_ptr<elf::sym>(d->d_val);
+            break;
+          case elf::dt_hash:
+            hash = as_ptr<::std::uint32_t>(d->d_val);
+            break;
+          case elf::dt_gnu_hash:
+            gnu_hash = as_ptr<::std::uint32_t>(d->d_val);
+            break;
+          case elf::dt_versym:
+            versym_ = as_ptr<::std::uint16_t>(d->d_val);
+            break;
+          case elf::dt_verdef:
+            verdef_ = as_ptr<elf::verdef>(d->d_val);
+            break;
+          default:
+            break;
+         }
+      }
+      if (strtab_ == nullptr || symtab_ == nullptr) {
+         symtab_ = nullptr;
+      } else if (hash != nullptr) {
+         // The second word of the SysV hash table is the number of symbols.
+         nsyms_ = hash[1];
+      } else if (gnu_hash != nullptr) {
+         nsyms_ = gnu_hash_symbol_count(gnu_hash);
+      }
+   }
+
+   //! Whether a symbol table was found at all.
+   [[nodiscard]] bool is_valid() const noexcept { return nsyms_ > 0; }
+
+   /**
+    * \brief Find the address of a function, or `nullptr` if it isn't there.
+    *
+    * @param name The name of the symbol, like `__vdso_clock_gettime`.
+    *
+    * @param version The symbol version, like `LINUX_2.6`. If the image
+    * doesn't have version information, this is ignored.
+    */
+   [[nodiscard]] void *
+   lookup(char const *name, char const *version) const noexcept {
+      namespace elf = ::syscalls::linux::elf;
+      for (::std::uint32_t i = 0; i < nsyms_; ++i) {
+         elf::sym const &s = symtab_[i];
+         unsigned char const type = s.st_info & 0xfU;
+         unsigned char const bind = s.st_info >> 4U;
+         if (type != elf::stt_func
+             || (bind != elf::stb_global && bind != elf::stb_weak)
+             || s.st_shndx == elf::shn_undef
+             || !equal(strtab_ + s.st_name, name)
+             || !version_matches(i, version))
+         {
+            continue;
+         }
+         return reinterpret_cast<void *>(load_offset_ + s.st_value);
+      }
+      return nullptr;
+   }
+
+ private:
+   template <typename T>
+   T const *as_ptr(::std::uint64_t vaddr) const noexcept {
+      return reinterpret_cast<T const *>(load_offset_ + vaddr);
+   }
+
+   static bool equal(char const *a, char const *b) noexcept {
+      while (*a != '\0' && *a == *b) {
+         ++a;
+         ++b;
+      }
+      return *a == *b;
+   }
+
+   //! The GNU hash table doesn't store the symbol count, so it's computed.
+   static ::std::uint32_t
+   gnu_hash_symbol_count(::std::uint32_t const *gnu_hash) noexcept {
+      ::std::uint32_t const nbuckets = gnu_hash[0];
+      ::std::uint32_t const symoffset = gnu_hash[1];
+      ::std::uint32_t const bloom_size = gnu_hash[2];
+      // The bloom filter words are 64 bits, so two 32 bit words each.
+      ::std::uint32_t const *const buckets = gnu_hash + 4 + bloom_size * 2;
+      ::std::uint32_t const *const chains = buckets + nbuckets;
+      ::std::uint32_t last = 0;
+      for (::std::uint32_t b = 0; b < nbuckets; ++b) {
+         if (buckets[b] > last) {
+            last = buckets[b];
+         }
+      }
+      if (last < symoffset) {
+         return symoffset;
+      }
+      // The low bit marks the end of a chain.
+      while ((chains[last - symoffset] & 1U) == 0) {
+         ++last;
+      }
+      return last + 1;
+   }
+
+   [[nodiscard]] bool
+   version_matches(::std::uint32_t symidx, char const *version) const noexcept
+   {
+      namespace elf = ::syscalls::linux::elf;
+      if (versym_ == nullptr || verdef_ == nullptr) {
+         return true;
+      }
+      ::std::uint16_t const ver = versym_[symidx] & ~elf::versym_hidden;
+      auto const *def = verdef_;
+      for (;;) {
+         if ((def->vd_flags & elf::verdef_base) == 0 && def->vd_ndx == ver) {
+            auto const *const aux = reinterpret_cast<elf::verdaux const *>(
+                 reinterpret_cast<char const *>(def) + def->vd_aux
+            );
+            return equal(strtab_ + aux->vda_name, version);
+         }
+         if (def->vd_next == 0) {
+            return false;
+         }
+         def = reinterpret_cast<elf::verdef const *>(
+              reinterpret_cast<char const *>(def) + def->vd_next
+         );
+      }
+   }
+
+   ::std::uintptr_t load_offset_ = 0;
+   char const *strtab_ = nullptr;
+   elf::sym const *symtab_ = nullptr;
+   ::std::uint16_t const *versym_ = nullptr;
+   elf::verdef const *verdef_ = nullptr;
+   ::std::uint32_t nsyms_ = 0;
+};
+
+} // namespace syscalls::linux
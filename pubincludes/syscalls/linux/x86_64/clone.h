@@ -0,0 +1,183 @@
+#pragma once  /*-*-c++-*-*/
+
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+#include <cstdint>
+#include <pppbase/flagset.h>
+#include <syscalls/linux/x86_64/syscall.h>
+
+namespace syscalls::linux::x86_64 {
+
+/** Flags for clone(2) and clone3(2) saying what parent and child share. */
+class cloneflags : public pppbase::specific_flagset_crtp<cloneflags> {
+ private:
+   using base_t = pppbase::specific_flagset_crtp<cloneflags>;
+   friend base_t;
+
+ public:
+   //! Default empty set
+   constexpr cloneflags() : base_t{0} {}
+
+   static const cloneflags vm;             //!< CLONE_VM
+   static const cloneflags fs;             //!< CLONE_FS
+   static const cloneflags files;          //!< CLONE_FILES
+   static const cloneflags sighand;        //!< CLONE_SIGHAND
+   static const cloneflags pidfd;          //!< CLONE_PIDFD
+   static const cloneflags ptrace;         //!< CLONE_PTRACE
+   static const cloneflags vfork;          //!< CLONE_VFORK
+   static const cloneflags parent;         //!< CLONE_PARENT
+   static const cloneflags thread;         //!< CLONE_THREAD
+   static const cloneflags newns;          //!< CLONE_NEWNS
+   static const cloneflags sysvsem;        //!< CLONE_SYSVSEM
+   static const cloneflags settls;         //!< CLONE_SETTLS
+   static const cloneflags parent_settid;  //!< CLONE_PARENT_SETTID
+   static const cloneflags child_cleartid; //!< CLONE_CHILD_CLEARTID
+   static const cloneflags untraced;       //!< CLONE_UNTRACED
+   static const cloneflags child_settid;   //!< CLONE_CHILD_SETTID
+   static const cloneflags io;             //!< CLONE_IO
+
+   //! Avoid using this function, it's awkward for a reason.
+   static constexpr
+   cloneflags create_from_int(bitvec_t val) { return cloneflags{val}; }
+
+   using base_t::getbits;
+
+ protected:
+   explicit constexpr cloneflags(bitvec_t val) : base_t(val) {}
+};
+
+constexpr const cloneflags cloneflags::vm{0x00000100};
+constexpr const cloneflags cloneflags::fs{0x00000200};
+constexpr const cloneflags cloneflags::files{0x00000400};
+constexpr const cloneflags cloneflags::sighand{0x00000800};
+constexpr const cloneflags cloneflags::pidfd{0x00001000};
+constexpr const cloneflags cloneflags::ptrace{0x00002000};
+constexpr const cloneflags cloneflags::vfork{0x00004000};
+constexpr const cloneflags cloneflags::parent{0x00008000};
+constexpr const cloneflags cloneflags::thread{0x00010000};
+constexpr const cloneflags cloneflags::newns{0x00020000};
+constexpr const cloneflags cloneflags::sysvsem{0x00040000};
+constexpr const cloneflags cloneflags::settls{0x00080000};
+constexpr const cloneflags cloneflags::parent_settid{0x00100000};
+constexpr const cloneflags cloneflags::child_cleartid{0x00200000};
+constexpr const cloneflags cloneflags::untraced{0x00800000};
+constexpr const cloneflags cloneflags::child_settid{0x01000000};
+constexpr const cloneflags cloneflags::io{0x80000000};
+
+//! The first version of the argument structure for clone3(2).
+struct clone_args {
+   ::std::uint64_t flags;
+   ::std::uint64_t pidfd;
+   ::std::uint64_t child_tid;
+   ::std::uint64_t parent_tid;
+   ::std::uint64_t exit_signal;
+   ::std::uint64_t stack;       //!< Lowest address of the stack.
+   ::std::uint64_t stack_size;
+   ::std::uint64_t tls;
+};
+static_assert(sizeof(clone_args) == 64);
+
+//! A function for a new thread to run. It must not unwind out.
+using thread_entry_t = void (*)(void *) noexcept;
+
+/**
+ * \brief Start a thread with clone3(2) and have it call `entry(arg)`.
+ *
+ * The child can't return from the system call into C++ code, because that
+ * code would expect the parent's stack. So the child's half of things is all
+ * in the inline assembly: call `entry(arg)` on the new stack, then exit the
+ * thread (not the process) when it returns.
+ *
+ * The top of the stack (`args.stack + args.stack_size`) must be 16 byte
+ * aligned, as the ABI requires at the `call`.
+ *
+ * @return The child's thread id in the parent.
+ */
+inline expected_t clone3_thread(clone_args const &args,
+                                thread_entry_t entry, void *arg) noexcept
+{
+   val_t retval;
+   register thread_entry_t rentry asm ("r12") = entry;
+   register void *rarg asm ("r13") = arg;
+   asm volatile (
+      "syscall\n\t"
+      "test %%rax, %%rax\n\t"
+      "jnz 1f\n\t"
+      // Only the child gets here, on its new stack.
+      "xor %%ebp, %%ebp\n\t"
+      "mov %%r13, %%rdi\n\t"
+      "call *%%r12\n\t"
+      "mov %[exit_nr], %%eax\n\t"
+      "xor %%edi, %%edi\n\t"
+      "syscall\n\t"
+      "hlt\n"
+      "1:\n\t"
+      :"=a"(retval)
+      :"a"(static_cast<::std::uint64_t>(call_id::clone3)),
+       "D"(&args), "S"(sizeof(args)), "r"(rentry), "r"(rarg),
+       [exit_nr]"i"(static_cast<int>(call_id::exit))
+      :"%rcx", "%r11", "memory"
+      );
+   if (retval < 0) {
+      return expected_t(expected_t::err_tag(), static_cast<int>(-retval));
+   } else {
+      return expected_t(syscall_val{retval});
+   }
+}
+
+/**
+ * \brief Like `clone3_thread`, but using the older clone(2).
+ *
+ * This is for kernels before 5.3 that don't have clone3. The arguments mean
+ * the same thing, but `args.pidfd` and `args.exit_signal` must be 0.
+ */
+inline expected_t clone_thread(clone_args const &args,
+                               thread_entry_t entry, void *arg) noexcept
+{
+   val_t retval;
+   register val_t rchild_tid asm ("r10") = static_cast<val_t>(args.child_tid);
+   register val_t rtls asm ("r8") = static_cast<val_t>(args.tls);
+   register thread_entry_t rentry asm ("r12") = entry;
+   register void *rarg asm ("r13") = arg;
+   asm volatile (
+      "syscall\n\t"
+      "test %%rax, %%rax\n\t"
+      "jnz 1f\n\t"
+      "xor %%ebp, %%ebp\n\t"
+      "mov %%r13, %%rdi\n\t"
+      "call *%%r12\n\t"
+      "mov %[exit_nr], %%eax\n\t"
+      "xor %%edi, %%edi\n\t"
+      "syscall\n\t"
+      "hlt\n"
+      "1:\n\t"
+      :"=a"(retval)
+      :"a"(static_cast<::std::uint64_t>(call_id::clone)),
+       "D"(args.flags), "S"(args.stack + args.stack_size),
+       "d"(args.parent_tid), "r"(rchild_tid), "r"(rtls),
+       "r"(rentry), "r"(rarg),
+       [exit_nr]"i"(static_cast<int>(call_id::exit))
+      :"%rcx", "%r11", "memory"
+      );
+   if (retval < 0) {
+      return expected_t(expected_t::err_tag(), static_cast<int>(-retval));
+   } else {
+      return expected_t(syscall_val{retval});
+   }
+}
+
+//! Codes for arch_prctl(2)
+enum class arch_prctl_code : int {
+   set_gs = 0x1001,
+   set_fs = 0x1002,
+   get_fs = 0x1003,
+   get_gs = 0x1004
+};
+
+inline expected_t arch_prctl(arch_prctl_code code, void *addr) noexcept
+{
+   return syscall_expected(call_id::arch_prctl, static_cast<int>(code), addr);
+}
+
+} // namespace syscalls::linux::x86_64
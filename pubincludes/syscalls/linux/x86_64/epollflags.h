@@ -0,0 +1,52 @@
+#pragma once  /*-*-c++-*-*/
+
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+#include <pppbase/flagset.h>
+
+namespace syscalls::linux::x86_64 {
+
+/** Event types and options for epoll_ctl(2) and epoll_wait(2). */
+class epollevents : public pppbase::specific_flagset_crtp<epollevents> {
+ private:
+   using base_t = pppbase::specific_flagset_crtp<epollevents>;
+   friend base_t;
+
+ public:
+   //! Default empty set
+   constexpr epollevents() : base_t{0} {}
+
+   static const epollevents in;         //!< EPOLLIN
+   static const epollevents pri;        //!< EPOLLPRI
+   static const epollevents out;        //!< EPOLLOUT
+   static const epollevents err;        //!< EPOLLERR
+   static const epollevents hup;        //!< EPOLLHUP
+   static const epollevents rdhup;      //!< EPOLLRDHUP
+   static const epollevents exclusive;  //!< EPOLLEXCLUSIVE
+   static const epollevents wakeup;     //!< EPOLLWAKEUP
+   static const epollevents oneshot;    //!< EPOLLONESHOT
+   static const epollevents et;         //!< EPOLLET
+
+   //! Avoid using this function, it's awkward for a reason.
+   static constexpr
+   epollevents create_from_int(bitvec_t val) { return epollevents{val}; }
+
+   using base_t::getbits;
+
+ protected:
+   explicit constexpr epollevents(bitvec_t val) : base_t(val) {}
+};
+
+constexpr const epollevents epollevents::in{0x001};
+constexpr const epollevents epollevents::pri{0x002};
+constexpr const epollevents epollevents::out{0x004};
+constexpr const epollevents epollevents::err{0x008};
+constexpr const epollevents epollevents::hup{0x010};
+constexpr const epollevents epollevents::rdhup{0x2000};
+constexpr const epollevents epollevents::exclusive{1u << 28};
+constexpr const epollevents epollevents::wakeup{1u << 29};
+constexpr const epollevents epollevents::oneshot{1u << 30};
+constexpr const epollevents epollevents::et{1u << 31};
+
+} // namespace syscalls::linux::x86_64
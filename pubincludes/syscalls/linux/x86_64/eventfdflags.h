@@ -0,0 +1,38 @@
+#pragma once  /*-*-c++-*-*/
+
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+#include <pppbase/flagset.h>
+
+namespace syscalls::linux::x86_64 {
+
+/** Flags for eventfd2, see eventfd(2). */
+class eventfdflags : public pppbase::specific_flagset_crtp<eventfdflags> {
+ private:
+   using base_t = pppbase::specific_flagset_crtp<eventfdflags>;
+   friend base_t;
+
+ public:
+   //! Default empty set
+   constexpr eventfdflags() : base_t{0} {}
+
+   static const eventfdflags semaphore;  //!< EFD_SEMAPHORE
+   static const eventfdflags nonblock;   //!< EFD_NONBLOCK
+   static const eventfdflags cloexec;    //!< EFD_CLOEXEC
+
+   //! Avoid using this function, it's awkward for a reason.
+   static constexpr
+   eventfdflags create_from_int(bitvec_t val) { return eventfdflags{val}; }
+
+   using base_t::getbits;
+
+ protected:
+   explicit constexpr eventfdflags(bitvec_t val) : base_t(val) {}
+};
+
+constexpr const eventfdflags eventfdflags::semaphore{1};
+constexpr const eventfdflags eventfdflags::nonblock{04000};
+constexpr const eventfdflags eventfdflags::cloexec{02000000};
+
+} // namespace syscalls::linux::x86_64
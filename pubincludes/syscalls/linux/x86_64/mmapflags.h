@@ -0,0 +1,124 @@
+#pragma once  /*-*-c++-*-*/
+
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+#include <pppbase/flagset.h>
+
+namespace syscalls::linux::x86_64 {
+
+/** Memory protection flags for mmap(2) and mprotect(2). */
+class protflags : public pppbase::specific_flagset_crtp<protflags> {
+ private:
+   using base_t = pppbase::specific_flagset_crtp<protflags>;
+   friend base_t;
+
+ public:
+   //! Default empty set (which happens to also be PROT_NONE).
+   constexpr protflags() : base_t{0} {}
+
+   static const protflags none;   //!< PROT_NONE
+   static const protflags read;   //!< PROT_READ
+   static const protflags write;  //!< PROT_WRITE
+   static const protflags exec;   //!< PROT_EXEC
+
+   //! Avoid using this function, it's awkward for a reason.
+   static constexpr
+   protflags create_from_int(bitvec_t val) { return protflags{val}; }
+
+   using base_t::getbits;
+
+ protected:
+   explicit constexpr protflags(bitvec_t val) : base_t(val) {}
+};
+
+
+/** Flags controlling how a mapping is created by mmap(2). */
+class mapflags : public pppbase::specific_flagset_crtp<mapflags> {
+ private:
+   using base_t = pppbase::specific_flagset_crtp<mapflags>;
+   friend base_t;
+
+ public:
+   //! Default empty set
+   constexpr mapflags() : base_t{0} {}
+
+   static const mapflags shared;           //!< MAP_SHARED
+   static const mapflags private_;         //!< MAP_PRIVATE
+   static const mapflags shared_validate;  //!< MAP_SHARED_VALIDATE
+   static const mapflags fixed;            //!< MAP_FIXED
+   static const mapflags anonymous;        //!< MAP_ANONYMOUS
+   static const mapflags growsdown;        //!< MAP_GROWSDOWN
+   static const mapflags denywrite;        //!< MAP_DENYWRITE
+   static const mapflags executable;       //!< MAP_EXECUTABLE
+   static const mapflags locked;           //!< MAP_LOCKED
+   static const mapflags noreserve;        //!< MAP_NORESERVE
+   static const mapflags populate;         //!< MAP_POPULATE
+   static const mapflags nonblock;         //!< MAP_NONBLOCK
+   static const mapflags stack;            //!< MAP_STACK
+   static const mapflags hugetlb;          //!< MAP_HUGETLB
+   static const mapflags sync;             //!< MAP_SYNC
+   static const mapflags fixed_noreplace;  //!< MAP_FIXED_NOREPLACE
+
+   //! Avoid using this function, it's awkward for a reason.
+   static constexpr
+   mapflags create_from_int(bitvec_t val) { return mapflags{val}; }
+
+   using base_t::getbits;
+
+ protected:
+   explicit constexpr mapflags(bitvec_t val) : base_t(val) {}
+};
+
+
+/** Flags for mremap(2). */
+class remapflags : public pppbase::specific_flagset_crtp<remapflags> {
+ private:
+   using base_t = pppbase::specific_flagset_crtp<remapflags>;
+   friend base_t;
+
+ public:
+   //! Default empty set
+   constexpr remapflags() : base_t{0} {}
+
+   static const remapflags maymove;    //!< MREMAP_MAYMOVE
+   static const remapflags fixed;      //!< MREMAP_FIXED
+   static const remapflags dontunmap;  //!< MREMAP_DONTUNMAP
+
+   //! Avoid using this function, it's awkward for a reason.
+   static constexpr
+   remapflags create_from_int(bitvec_t val) { return remapflags{val}; }
+
+   using base_t::getbits;
+
+ protected:
+   explicit constexpr remapflags(bitvec_t val) : base_t(val) {}
+};
+
+constexpr const protflags protflags::none{0x0};
+constexpr const protflags protflags::read{0x1};
+constexpr const protflags protflags::write{0x2};
+constexpr const protflags protflags::exec{0x4};
+
+constexpr const mapflags mapflags::shared{0x01};
+constexpr const mapflags mapflags::private_{0x02};
+constexpr const mapflags mapflags::shared_validate{0x03};
+constexpr const mapflags mapflags::fixed{0x10};
+constexpr const mapflags mapflags::anonymous{0x20};
+constexpr const mapflags mapflags::growsdown{0x00100};
+constexpr const mapflags mapflags::denywrite{0x00800};
+constexpr const mapflags mapflags::executable{0x01000};
+constexpr const mapflags mapflags::locked{0x02000};
+constexpr const mapflags mapflags::noreserve{0x04000};
+constexpr const mapflags mapflags::populate{0x08000};
+constexpr const mapflags mapflags::nonblock{0x10000};
+constexpr const mapflags mapflags::stack{0x20000};
+constexpr const mapflags mapflags::hugetlb{0x40000};
+constexpr const mapflags mapflags::sync{0x80000};
+constexpr const mapflags mapflags::fixed_noreplace{0x100000};
+
+constexpr const remapflags remapflags::maymove{0x1};
+constexpr const remapflags remapflags::fixed{0x2};
+constexpr const remapflags remapflags::dontunmap{0x4};
+
+} // namespace syscalls::linux::x86_64
@@ -0,0 +1,44 @@
+#pragma once  /*-*-c++-*-*/
+
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+#include <pppbase/flagset.h>
+
+namespace syscalls::linux::x86_64 {
+
+/** Per call flags for preadv2(2) and pwritev2(2). */
+class rwflags : public pppbase::specific_flagset_crtp<rwflags> {
+ private:
+   using base_t = pppbase::specific_flagset_crtp<rwflags>;
+   friend base_t;
+
+ public:
+   //! Default empty set
+   constexpr rwflags() : base_t{0} {}
+
+   static const rwflags hipri;     //!< RWF_HIPRI
+   static const rwflags dsync;     //!< RWF_DSYNC
+   static const rwflags sync;      //!< RWF_SYNC
+   static const rwflags nowait;    //!< RWF_NOWAIT
+   static const rwflags append;    //!< RWF_APPEND
+   static const rwflags noappend;  //!< RWF_NOAPPEND
+
+   //! Avoid using this function, it's awkward for a reason.
+   static constexpr
+   rwflags create_from_int(bitvec_t val) { return rwflags{val}; }
+
+   using base_t::getbits;
+
+ protected:
+   explicit constexpr rwflags(bitvec_t val) : base_t(val) {}
+};
+
+constexpr const rwflags rwflags::hipri{0x01};
+constexpr const rwflags rwflags::dsync{0x02};
+constexpr const rwflags rwflags::sync{0x04};
+constexpr const rwflags rwflags::nowait{0x08};
+constexpr const rwflags rwflags::append{0x10};
+constexpr const rwflags rwflags::noappend{0x20};
+
+} // namespace syscalls::linux::x86_64
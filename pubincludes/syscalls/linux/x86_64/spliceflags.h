@@ -0,0 +1,40 @@
+#pragma once  /*-*-c++-*-*/
+
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+#include <pppbase/flagset.h>
+
+namespace syscalls::linux::x86_64 {
+
+/** Flags for splice(2), tee(2) and vmsplice(2). */
+class spliceflags : public pppbase::specific_flagset_crtp<spliceflags> {
+ private:
+   using base_t = pppbase::specific_flagset_crtp<spliceflags>;
+   friend base_t;
+
+ public:
+   //! Default empty set
+   constexpr spliceflags() : base_t{0} {}
+
+   static const spliceflags move;      //!< SPLICE_F_MOVE
+   static const spliceflags nonblock;  //!< SPLICE_F_NONBLOCK
+   static const spliceflags more;      //!< SPLICE_F_MORE
+   static const spliceflags gift;      //!< SPLICE_F_GIFT
+
+   //! Avoid using this function, it's awkward for a reason.
+   static constexpr
+   spliceflags create_from_int(bitvec_t val) { return spliceflags{val}; }
+
+   using base_t::getbits;
+
+ protected:
+   explicit constexpr spliceflags(bitvec_t val) : base_t(val) {}
+};
+
+constexpr const spliceflags spliceflags::move{0x1};
+constexpr const spliceflags spliceflags::nonblock{0x2};
+constexpr const spliceflags spliceflags::more{0x4};
+constexpr const spliceflags spliceflags::gift{0x8};
+
+} // namespace syscalls::linux::x86_64
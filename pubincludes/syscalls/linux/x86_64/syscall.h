@@ -1,8 +1,13 @@
 #pragma once  // -*- c++ -*-
 
+#include <concepts>
 #include <cstdint>
+#include <type_traits>
 #include <utility>
 #include <posixpp/expected.h>
+#ifdef POSIXPP_SYSCALL_STATS
+#include <syscalls/linux/x86_64/syscall_stats.h>
+#endif
 
 namespace syscalls::linux::x86_64 {
 
@@ -12,21 +17,33 @@ enum class call_id : ::std::uint16_t;
 // The fundamental type of a system call argument.
 using val_t = ::std::int64_t;
 
-// A wrapper that allows treating pointers and integers interchangeably.
-// There are several comments to prompt the compiler to turn off warnings about
-// bad conversions and use of `reinterpret_cast`.
-struct syscall_param {
-   syscall_param(val_t v) noexcept : value(v) { } // NOLINT
-   // NOLINTNEXTLINE
-   syscall_param(void *v) noexcept : value(reinterpret_cast<val_t>(v)) {
-      static_assert(sizeof(void *) == sizeof(val_t));
-   }
-   // NOLINTNEXTLINE
-   syscall_param(void const *v) noexcept : value(reinterpret_cast<val_t>(v)) {
-      static_assert(sizeof(void *) == sizeof(val_t));
+// Anything that fits in a register and can be handed to the kernel as is:
+// integers, enums and pointers. Everything is passed by value so the compiler
+// never has to put an argument in memory just to take its address.
+template <typename T>
+concept syscall_arg = (::std::integral<T> && !::std::same_as<T, bool>)
+                      || ::std::is_enum_v<T>
+                      || ::std::is_pointer_v<T>
+                      || ::std::is_null_pointer_v<T>;
+
+// Turn an argument into the register value the kernel expects. Signed
+// integers are sign extended, unsigned ones zero extended, like any other
+// conversion to `val_t`.
+template <syscall_arg T>
+inline val_t to_val(T v) noexcept
+{
+   static_assert(sizeof(T) <= sizeof(val_t));
+   if constexpr (::std::is_enum_v<T>) {
+      return static_cast<val_t>(static_cast<::std::underlying_type_t<T>>(v));
+   } else if constexpr (::std::is_null_pointer_v<T>) {
+      return 0;
+   } else if constexpr (::std::is_pointer_v<T>) {
+      // NOLINTNEXTLINE
+      return reinterpret_cast<val_t>(v);
+   } else {
+      return static_cast<val_t>(v);
    }
-   val_t value;
-};
+}
 
 
 // The full 6 argument system call comments the inline assembly more thoroughly.
@@ -45,106 +62,102 @@ inline val_t do_syscall(call_id callnum) noexcept
 }
 
 // Single argument system call.
-inline val_t do_syscall(call_id callnum,
-                           syscall_param const &p1) noexcept
+template <syscall_arg P1>
+inline val_t do_syscall(call_id callnum, P1 p1) noexcept
 {
    val_t retval;
    asm volatile (
       "syscall\n\t"
        :"=a"(retval)
-       :"a"(static_cast<::std::uint64_t>(callnum)), "D"(p1.value)
+       :"a"(static_cast<::std::uint64_t>(callnum)), "D"(to_val(p1))
        :"%rcx", "%r11", "memory"
       );
    return retval;
 }
 
 // Two argument system call.
-inline val_t do_syscall(call_id callnum,
-                           syscall_param const &p1,
-                           syscall_param const &p2) noexcept
+template <syscall_arg P1, syscall_arg P2>
+inline val_t do_syscall(call_id callnum, P1 p1, P2 p2) noexcept
 {
    val_t retval;
    asm volatile (
       "syscall\n\t"
        :"=a"(retval)
-       :"a"(static_cast<::std::uint64_t>(callnum)), "D"(p1.value), "S"(p2.value)
+       :"a"(static_cast<::std::uint64_t>(callnum)),
+        "D"(to_val(p1)), "S"(to_val(p2))
        :"%rcx", "%r11", "memory"
       );
    return retval;
 }
 
 // Three argument system call.
-inline val_t do_syscall(call_id callnum,
-                           syscall_param const &p1,
-                           syscall_param const &p2,
-                           syscall_param const &p3) noexcept
+template <syscall_arg P1, syscall_arg P2, syscall_arg P3>
+inline val_t do_syscall(call_id callnum, P1 p1, P2 p2, P3 p3) noexcept
 {
    val_t retval;
    asm volatile (
       "syscall\n\t"
        :"=a"(retval)
-       :"a"(static_cast<::std::uint64_t>(callnum)), "D"(p1.value), "S"(p2.value), "d"(p3.value)
+       :"a"(static_cast<::std::uint64_t>(callnum)),
+        "D"(to_val(p1)), "S"(to_val(p2)), "d"(to_val(p3))
        :"%rcx", "%r11", "memory"
       );
    return retval;
 }
 
 // Four argument system call.
-inline val_t do_syscall(call_id callnum,
-                           syscall_param const &p1,
-                           syscall_param const &p2,
-                           syscall_param const &p3,
-                           syscall_param const &p4) noexcept
+template <syscall_arg P1, syscall_arg P2, syscall_arg P3, syscall_arg P4>
+inline val_t do_syscall(call_id callnum, P1 p1, P2 p2, P3 p3, P4 p4) noexcept
 {
    val_t retval;
-   register val_t rp4 asm ("r10") = p4.value;
+   register val_t rp4 asm ("r10") = to_val(p4);
    asm volatile (
       "syscall\n\t"
        :"=a"(retval)
-      :"a"(static_cast<::std::uint64_t>(callnum)), "D"(p1.value), "S"(p2.value), "d"(p3.value), "r"(rp4)
+       :"a"(static_cast<::std::uint64_t>(callnum)),
+        "D"(to_val(p1)), "S"(to_val(p2)), "d"(to_val(p3)), "r"(rp4)
        :"%rcx", "%r11", "memory"
       );
    return retval;
 }
 
 // Five argument system call.
+template <syscall_arg P1, syscall_arg P2, syscall_arg P3, syscall_arg P4,
+          syscall_arg P5>
 inline val_t do_syscall(call_id callnum,
-                           syscall_param const &p1,
-                           syscall_param const &p2,
-                           syscall_param const &p3,
-                           syscall_param const &p4,
-                           syscall_param const &p5) noexcept
+                        P1 p1, P2 p2, P3 p3, P4 p4, P5 p5) noexcept
 {
    val_t retval;
-   register volatile val_t rp4 asm ("r10") = p4.value;
-   register volatile val_t rp5 asm ("r8") = p5.value;
+   register val_t rp4 asm ("r10") = to_val(p4);
+   register val_t rp5 asm ("r8") = to_val(p5);
    asm volatile (
       "syscall\n\t"
-      :"=a"(retval)
-      :"a"(static_cast<::std::uint64_t>(callnum)), "D"(p1.value), "S"(p2.value), "d"(p3.value), "r"(rp4), "r"(rp5)
-      :"%rcx", "%r11", "memory"
+       :"=a"(retval)
+       :"a"(static_cast<::std::uint64_t>(callnum)),
+        "D"(to_val(p1)), "S"(to_val(p2)), "d"(to_val(p3)), "r"(rp4), "r"(rp5)
+       :"%rcx", "%r11", "memory"
       );
    return retval;
 }
 
 // Six argument system call.
+template <syscall_arg P1, syscall_arg P2, syscall_arg P3, syscall_arg P4,
+          syscall_arg P5, syscall_arg P6>
 inline val_t do_syscall(call_id callnum,
-                           syscall_param const &p1,
-                           syscall_param const &p2,
-                           syscall_param const &p3,
-                           syscall_param const &p4,
-                           syscall_param const &p5,
-                           syscall_param const &p6) noexcept
+                        P1 p1, P2 p2, P3 p3, P4 p4, P5 p5, P6 p6) noexcept
 {
    // Declare this, though when the assembly is inlined, it should just
    // magically be assigned to the `%rax` register.
    val_t retval;
 
    // Declare alternate names for various registers and assign them the last few
-   // arguments for the system call.
-   register volatile val_t rp4 asm ("r10") = p4.value;
-   register volatile val_t rp5 asm ("r8") = p5.value;
-   register volatile val_t rp6 asm ("r9") = p6.value;
+   // arguments for the system call. These are only promised to be in those
+   // registers when used as operands of the `asm` statement, which is all
+   // that's needed. Making them `volatile` as well only forces them to be
+   // spilled to the stack and loaded back.
+   register val_t rp4 asm ("r10") = to_val(p4);
+   register val_t rp5 asm ("r8") = to_val(p5);
+   register val_t rp6 asm ("r9") = to_val(p6);
 
    // This inline assembly is just a single instruction with lots of hints to
    // the compiler about how things should be set up before the instruction
@@ -160,9 +173,9 @@ inline val_t do_syscall(call_id callnum,
 
        // Declaring various input registers and where they come from.
       :"a"(static_cast<::std::uint64_t>(callnum)), // %rax contains callnum
-       "D"(p1.value), // %rdi contains p1.value
-       "S"(p2.value), // %rsi contains p2.value
-       "d"(p3.value), // %rdx contains p3.value
+       "D"(to_val(p1)), // %rdi contains p1
+       "S"(to_val(p2)), // %rsi contains p2
+       "d"(to_val(p3)), // %rdx contains p3
        "r"(rp4), // What rp4 means has already been declared above.
        "r"(rp5), // What rp5 means has already been declared above.
        "r"(rp6)  // What rp6 means has already been declared above
@@ -178,23 +191,65 @@ inline val_t do_syscall(call_id callnum,
    return retval;
 }
 
+// What a system call leaves in %rax. It's a type of its own so that
+// `expected_t` can keep errors where the kernel does, -4095 to -1, without
+// that applying to every `expected<val_t>`. It converts to `val_t` wherever
+// one is wanted.
+struct syscall_val {
+   val_t val;
+
+   constexpr operator val_t() const noexcept { return val; }
+};
+
+} // namespace syscalls::linux::x86_64
+
+template <>
+struct posixpp::expected_niche<::syscalls::linux::x86_64::syscall_val> {
+   using syscall_val = ::syscalls::linux::x86_64::syscall_val;
+
+   static constexpr bool enabled = true;
+
+   static constexpr syscall_val from_error(int ec) noexcept {
+      return syscall_val{-ec};
+   }
+   static constexpr bool is_error(syscall_val v) noexcept {
+      return static_cast<::std::uint64_t>(v.val)
+             > static_cast<::std::uint64_t>(-4096);
+   }
+   static constexpr int to_error(syscall_val v) noexcept {
+      return -static_cast<int>(v.val);
+   }
+};
+
+namespace syscalls::linux::x86_64 {
 
 // This is where errno will go now, or the system call result.
-using expected_t = ::posixpp::expected<val_t>;
+using expected_t = ::posixpp::expected<syscall_val>;
 
 // This effectively creates 6 new functions that will each call the appropriate
 // `do_syscall` overload. They then check for an error return and set up
 // `::posixpp::expected` in the correct way for an error vs. normal return.
-template <typename... T>
+// Since `expected_t` keeps errors the same way the kernel does, both branches
+// build the same bits and the check disappears.
+//
+// With `POSIXPP_SYSCALL_STATS` defined, each call is also counted, along with
+// its error and how long it took. See syscall_stats.h.
+template <syscall_arg... T>
 expected_t
-syscall_expected(call_id callnum, T &&... args) noexcept
+syscall_expected(call_id callnum, T... args) noexcept
 {
-   val_t result = do_syscall(callnum, ::std::forward<T>(args)...);
-
-   if (result < 0) {
+#ifdef POSIXPP_SYSCALL_STATS
+   ::std::uint64_t const start = stats::cycles();
+#endif
+   val_t result = do_syscall(callnum, args...);
+#ifdef POSIXPP_SYSCALL_STATS
+   stats::record(callnum, result, start);
+#endif
+
+   if (::posixpp::expected_niche<syscall_val>::is_error(syscall_val{result})) {
       return expected_t(expected_t::err_tag(), static_cast<int>(-result));
    } else {
-      return expected_t(result);
+      return expected_t(syscall_val{result});
    }
 }
 
@@ -362,12 +417,17 @@ enum class call_id : ::std::uint16_t {
    adjtimex,
    setrlimit,
 
-   futex = 202,
+   time = 201,
+   futex,
 
    epoll_create = 213,
    epoll_ctl_old,
    epoll_wait_old,
 
+   clock_settime = 227,
+   clock_gettime,
+   clock_getres,
+   clock_nanosleep,
    exit_group = 231,
    epoll_wait = 232,
    epoll_ctl,
@@ -388,11 +448,39 @@ enum class call_id : ::std::uint16_t {
    pselect6,
    ppoll,
    unshare,
-   epoll_pwait = 281,
-   epoll_create1 = 291,
+   set_robust_list,
+   get_robust_list,
+   splice,
+   tee,
+   sync_file_range,
+   vmsplice,
+   move_pages,
+   utimensat,
+   epoll_pwait,
+   timerfd_create = 283,
+   timerfd_settime = 286,
+   timerfd_gettime,
+   eventfd2 = 290,
+   epoll_create1,
    dup3 = 292,
+   pipe2,
+   inotify_init1,
+   preadv,
+   pwritev,
    syncfs = 306,
-   setns = 308
+   setns = 308,
+   getcpu,
+   copy_file_range = 326,
+   preadv2,
+   pwritev2,
+
+   io_uring_setup = 425,
+   io_uring_enter,
+   io_uring_register,
+
+   clone3 = 435,
+
+   futex_waitv = 449
 };
 
 namespace priv_ {
@@ -406,6 +494,21 @@ inline void compiletime_tests()
    static_assert(static_cast<::std::uint16_t>(call_id::getresgid) == 120);
    static_assert(static_cast<::std::uint16_t>(call_id::setrlimit) == 160);
    static_assert(static_cast<::std::uint16_t>(call_id::faccessat) == 269);
+   static_assert(static_cast<::std::uint16_t>(call_id::futex) == 202);
+   static_assert(static_cast<::std::uint16_t>(call_id::clock_nanosleep) == 230);
+   static_assert(static_cast<::std::uint16_t>(call_id::getcpu) == 309);
+   static_assert(static_cast<::std::uint16_t>(call_id::io_uring_register) == 427);
+   static_assert(static_cast<::std::uint16_t>(call_id::arch_prctl) == 158);
+   static_assert(static_cast<::std::uint16_t>(call_id::pwritev) == 296);
+   static_assert(static_cast<::std::uint16_t>(call_id::pwrite64) == 18);
+   static_assert(static_cast<::std::uint16_t>(call_id::epoll_pwait) == 281);
+   static_assert(static_cast<::std::uint16_t>(call_id::pipe2) == 293);
+   static_assert(static_cast<::std::uint16_t>(call_id::pwritev2) == 328);
+   static_assert(static_cast<::std::uint16_t>(call_id::futex_waitv) == 449);
+   static_assert(static_cast<::std::uint16_t>(call_id::eventfd2) == 290);
+   static_assert(static_cast<::std::uint16_t>(call_id::epoll_create1) == 291);
+   static_assert(static_cast<::std::uint16_t>(call_id::timerfd_create) == 283);
+   static_assert(static_cast<::std::uint16_t>(call_id::timerfd_gettime) == 287);
 }
 } // namespace priv_
 
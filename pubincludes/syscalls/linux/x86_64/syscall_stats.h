@@ -0,0 +1,77 @@
+#pragma once  // -*- c++ -*-
+
+#include <atomic>
+#include <bit>
+#include <cstdint>
+
+// Counters kept by `syscall_expected` when `POSIXPP_SYSCALL_STATS` is
+// defined. Nothing here is used otherwise, and `syscall_expected` compiles to
+// exactly what it would without this file.
+//
+// The macro changes what every inline wrapper compiles to, so it has to be
+// defined (or not) for the whole program.
+
+namespace syscalls::linux::x86_64 {
+
+enum class call_id : ::std::uint16_t;
+
+namespace stats {
+
+//! System call numbers at or above this aren't counted.
+constexpr unsigned max_calls = 512;
+//! Errors at or above this are counted together in the last slot.
+constexpr unsigned max_errno = 134;
+//! Latency bucket `n` counts calls that took fewer than `2**n` cycles.
+constexpr unsigned latency_buckets = 64;
+
+//! Everything counted about one system call.
+struct call_stats {
+   ::std::uint64_t calls;
+   ::std::uint64_t errors;
+   ::std::uint64_t errno_counts[max_errno];
+   ::std::uint64_t latency[latency_buckets];
+};
+
+// About 800K of zeroed memory, but only the pages for calls that are actually
+// made are ever touched.
+inline constinit call_stats table[max_calls] = {};
+
+//! The time stamp counter, in cycles.
+inline ::std::uint64_t cycles() noexcept
+{
+   ::std::uint32_t lo, hi;
+   asm volatile ("rdtsc" : "=a"(lo), "=d"(hi));
+   return (static_cast<::std::uint64_t>(hi) << 32) | lo;
+}
+
+inline void bump(::std::uint64_t &counter) noexcept
+{
+   ::std::atomic_ref<::std::uint64_t>{counter}.fetch_add(
+        1, ::std::memory_order_relaxed
+   );
+}
+
+//! Count a call to `callnum` that started at `start` and returned `result`.
+inline void record(call_id callnum, ::std::int64_t result,
+                   ::std::uint64_t start) noexcept
+{
+   ::std::uint64_t const elapsed = cycles() - start;
+   auto const idx = static_cast<unsigned>(callnum);
+   if (idx >= max_calls) {
+      return;
+   }
+   call_stats &stats = table[idx];
+   bump(stats.calls);
+   if (result < 0 && result >= -4095) {
+      bump(stats.errors);
+      auto const err = static_cast<unsigned>(-result);
+      bump(stats.errno_counts[err < max_errno ? err : max_errno - 1]);
+   }
+   unsigned const bucket = ::std::bit_width(elapsed);
+   bump(stats.latency[bucket < latency_buckets ? bucket
+                                               : latency_buckets - 1]);
+}
+
+} // namespace stats
+
+} // namespace syscalls::linux::x86_64
@@ -0,0 +1,62 @@
+#pragma once  /*-*-c++-*-*/
+
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+#include <pppbase/flagset.h>
+
+namespace syscalls::linux::x86_64 {
+
+/** Flags for timerfd_create, see timerfd_create(2). */
+class timerfdflags : public pppbase::specific_flagset_crtp<timerfdflags> {
+ private:
+   using base_t = pppbase::specific_flagset_crtp<timerfdflags>;
+   friend base_t;
+
+ public:
+   //! Default empty set
+   constexpr timerfdflags() : base_t{0} {}
+
+   static const timerfdflags nonblock;   //!< TFD_NONBLOCK
+   static const timerfdflags cloexec;    //!< TFD_CLOEXEC
+
+   //! Avoid using this function, it's awkward for a reason.
+   static constexpr
+   timerfdflags create_from_int(bitvec_t val) { return timerfdflags{val}; }
+
+   using base_t::getbits;
+
+ protected:
+   explicit constexpr timerfdflags(bitvec_t val) : base_t(val) {}
+};
+
+constexpr const timerfdflags timerfdflags::nonblock{04000};
+constexpr const timerfdflags timerfdflags::cloexec{02000000};
+
+/** Flags for timerfd_settime, see timerfd_create(2). */
+class timersetflags : public pppbase::specific_flagset_crtp<timersetflags> {
+ private:
+   using base_t = pppbase::specific_flagset_crtp<timersetflags>;
+   friend base_t;
+
+ public:
+   //! Default empty set
+   constexpr timersetflags() : base_t{0} {}
+
+   static const timersetflags abstime;        //!< TFD_TIMER_ABSTIME
+   static const timersetflags cancel_on_set;  //!< TFD_TIMER_CANCEL_ON_SET
+
+   //! Avoid using this function, it's awkward for a reason.
+   static constexpr
+   timersetflags create_from_int(bitvec_t val) { return timersetflags{val}; }
+
+   using base_t::getbits;
+
+ protected:
+   explicit constexpr timersetflags(bitvec_t val) : base_t(val) {}
+};
+
+constexpr const timersetflags timersetflags::abstime{1};
+constexpr const timersetflags timersetflags::cancel_on_set{2};
+
+} // namespace syscalls::linux::x86_64
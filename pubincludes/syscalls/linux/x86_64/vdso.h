@@ -0,0 +1,19 @@
+#pragma once  /*-*-c++-*-*/
+
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+// The names of the functions in the vDSO differ between architectures. These
+// are the x86_64 ones, see vdso(7).
+
+namespace syscalls::linux::x86_64::vdso_names {
+
+inline constexpr char version[] = "LINUX_2.6";
+
+inline constexpr char clock_gettime[] = "__vdso_clock_gettime";
+inline constexpr char clock_getres[] = "__vdso_clock_getres";
+inline constexpr char gettimeofday[] = "__vdso_gettimeofday";
+inline constexpr char time[] = "__vdso_time";
+inline constexpr char getcpu[] = "__vdso_getcpu";
+
+} // namespace syscalls::linux::x86_64::vdso_names
@@ -0,0 +1,94 @@
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+#include <posixpp/arena.h>
+#include <posixpp/arena_resource.h>
+#include <catch2/catch.hpp>
+#include <cstdint>
+#include <cstring>
+#include <memory_resource>
+#include <new>
+#include <vector>
+
+SCENARIO("An arena bumps allocations through one mapping.", "[arena]")
+{
+   GIVEN("A 64K arena.") {
+      auto a{::posixpp::arena::create(64 * 1024).result()};
+      REQUIRE(a.capacity() == 64 * 1024);
+      REQUIRE(a.used() == 0);
+      WHEN("Allocations with different alignments are made.") {
+         void *const one = a.allocate(1, 1);
+         void *const aligned = a.allocate(8, 64);
+         void *const plain = a.allocate(3);
+         THEN("They're in the arena, aligned, and in order.") {
+            REQUIRE(a.owns(one));
+            REQUIRE(a.owns(aligned));
+            REQUIRE(a.owns(plain));
+            auto const addr = reinterpret_cast<::std::uintptr_t>(aligned);
+            REQUIRE(addr % 64 == 0);
+            REQUIRE(aligned > one);
+            REQUIRE(plain > aligned);
+            REQUIRE(a.used() >= 12);
+         }
+      }
+      WHEN("It's filled up.") {
+         void *const all = a.allocate(a.capacity(), 1);
+         THEN("The next allocation fails, even a huge one.") {
+            REQUIRE(all != nullptr);
+            REQUIRE(a.allocate(1, 1) == nullptr);
+            REQUIRE(a.allocate(~::std::size_t{0}, 1) == nullptr);
+         }
+         AND_WHEN("It's reset.") {
+            REQUIRE_FALSE(a.reset().has_error());
+            THEN("The same memory is handed out again.") {
+               REQUIRE(a.used() == 0);
+               REQUIRE(a.allocate(16, 1) == all);
+            }
+         }
+      }
+      WHEN("Memory is written and the arena reset with release.") {
+         auto *const block = static_cast<char *>(a.allocate(8192, 1));
+         ::std::memset(block, 'x', 8192);
+         REQUIRE_FALSE(a.reset(true).has_error());
+         THEN("The pages were given back, and read as zero.") {
+            auto *const again = static_cast<char *>(a.allocate(8192, 1));
+            REQUIRE(again == block);
+            REQUIRE(again[0] == '\0');
+            REQUIRE(again[8191] == '\0');
+         }
+      }
+   }
+   GIVEN("An arena with a guard page.") {
+      auto a{::posixpp::arena::create(5000, true).result()};
+      THEN("The guard page isn't part of the capacity.") {
+         REQUIRE(a.capacity() == 2 * ::posixpp::arena::page_size);
+         auto *const all = static_cast<char *>(a.allocate(a.capacity(), 1));
+         all[a.capacity() - 1] = 'x';
+         REQUIRE(a.allocate(1, 1) == nullptr);
+      }
+   }
+}
+
+SCENARIO("A pmr container can allocate from an arena.", "[arena]")
+{
+   GIVEN("A 1M arena used by a pmr vector.") {
+      auto a{::posixpp::arena::create(1024 * 1024).result()};
+      ::posixpp::arena_resource resource{a};
+      ::std::pmr::vector<int> numbers{&resource};
+      WHEN("Lots of numbers are added.") {
+         for (int i = 0; i < 10000; ++i) {
+            numbers.push_back(i);
+         }
+         THEN("They're stored in the arena.") {
+            REQUIRE(numbers[9999] == 9999);
+            REQUIRE(a.owns(numbers.data()));
+            REQUIRE(a.used() >= 10000 * sizeof(int));
+         }
+      }
+      WHEN("More is asked for than the arena holds.") {
+         THEN("bad_alloc is thrown.") {
+            REQUIRE_THROWS_AS(numbers.reserve(1024 * 1024), ::std::bad_alloc);
+         }
+      }
+   }
+}
@@ -0,0 +1,200 @@
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+#include <posixpp/async_io.h>
+#include <posixpp/transfer.h>
+#include "tempdir.h"
+#include <catch2/catch.hpp>
+#include <cerrno>
+#include <memory>
+#include <string>
+
+namespace {
+
+using ::posixpp::task;
+using ::posixpp::frame_pool;
+
+task<int> add_one(::std::allocator_arg_t, frame_pool &, int n)
+{
+   co_return n + 1;
+}
+
+task<int> add_three(::std::allocator_arg_t alloc, frame_pool &pool, int n)
+{
+   n = co_await add_one(alloc, pool, n);
+   n = co_await add_one(alloc, pool, n);
+   co_return co_await add_one(alloc, pool, n);
+}
+
+//! Adds its own amount, from a member function coroutine.
+struct adder {
+   task<int> add(::std::allocator_arg_t, frame_pool &, int n) const
+   {
+      co_return n + amount;
+   }
+
+   int amount;
+};
+
+//! Write `msg` to a new file, then read it back, all through the ring.
+task<::std::string> round_trip(::std::allocator_arg_t, frame_pool &,
+                               ::posixpp::io_uring &ring,
+                               ::posixpp::fd const &dir, ::std::string msg)
+{
+   using of = ::posixpp::openflags;
+   using fdf = ::posixpp::fdflags;
+   using ::posixpp::modeflags;
+   auto opened = co_await async_openat(ring, dir, "foo",
+                                       of::creat | fdf::rdwr,
+                                       modeflags::irwall);
+   if (opened.has_error()) {
+      co_return "open failed";
+   }
+   auto file{opened.result()};
+   auto const written = co_await async_write(ring, file,
+                                             msg.data(), msg.size(), 0);
+   if (written.has_error() || written.result() != msg.size()) {
+      co_return "write failed";
+   }
+   ::std::string readback(msg.size() + 10, '\0');
+   auto const nread = co_await async_read(ring, file,
+                                          readback.data(), readback.size(), 0);
+   if (nread.has_error()) {
+      co_return "read failed";
+   }
+   readback.resize(nread.result());
+   auto const closed = co_await async_close(ring, file);
+   if (closed.has_error() || file.is_valid()) {
+      co_return "close failed";
+   }
+   co_return readback;
+}
+
+task<::std::string> read_all(::posixpp::reactor &r, ::posixpp::fd const &file)
+{
+   ::std::string data;
+   for (;;) {
+      char buf[16];
+      auto const nread = co_await async_read(r, file, buf, sizeof(buf));
+      if (nread.has_error()) {
+         co_return "read failed";
+      } else if (nread.result() == 0) {
+         co_return data;
+      }
+      data.append(buf, nread.result());
+   }
+}
+
+//! Writes `msg` in a few pieces, then closes the pipe.
+task<void> write_pieces(::posixpp::reactor &r, ::posixpp::pipe_fds &p,
+                        ::std::string const &msg)
+{
+   for (::std::size_t i = 0; i < msg.size(); i += 5) {
+      auto const piece = msg.substr(i, 5);
+      (void)co_await async_write(r, p.write_end, piece.data(), piece.size());
+   }
+   (void)co_await async_close(r, p.write_end);
+}
+
+} // namespace
+
+SCENARIO("Tasks can await other tasks.", "[task]")
+{
+   GIVEN("A frame pool.") {
+      frame_pool pool;
+      WHEN("A task awaiting three nested tasks is run to completion.") {
+         auto t = add_three(::std::allocator_arg, pool, 5);
+         t.start();
+         THEN("It finishes with their combined result.") {
+            REQUIRE(t.done());
+            REQUIRE(t.result() == 8);
+         }
+      }
+      WHEN("The same tasks are run many times.") {
+         for (int i = 0; i < 3; ++i) {
+            auto t = add_three(::std::allocator_arg, pool, i);
+            t.start();
+         }
+         auto const warmed_up = pool.upstream_allocations();
+         for (int i = 0; i < 1000; ++i) {
+            auto t = add_three(::std::allocator_arg, pool, i);
+            t.start();
+            REQUIRE(t.result() == i + 3);
+         }
+         THEN("The frames are reused instead of allocated again.") {
+            REQUIRE(warmed_up > 0);
+            REQUIRE(pool.upstream_allocations() == warmed_up);
+         }
+      }
+      WHEN("A member function task is run.") {
+         adder const add_ten{10};
+         auto t = add_ten.add(::std::allocator_arg, pool, 5);
+         t.start();
+         THEN("It finishes, with its frame from the pool.") {
+            REQUIRE(t.result() == 15);
+            REQUIRE(pool.upstream_allocations() == 1);
+         }
+      }
+   }
+}
+
+SCENARIO("File operations can be awaited using an io_uring.", "[async_io]")
+{
+   GIVEN("A ring and a temporary directory.") {
+      auto ring{::posixpp::io_uring::create(4).result()};
+      tempdir testdir;
+      auto dir{
+           ::posixpp::open(testdir.get_name().native().c_str(),
+                           ::posixpp::fdflags::rdonly).result()
+      };
+      frame_pool pool;
+      WHEN("A task opens, writes, reads and closes a file.") {
+         ::std::string const msg = "awaited io_uring stuff\n";
+         auto t = round_trip(::std::allocator_arg, pool, ring, dir, msg);
+         auto const ran = run(ring, t);
+         THEN("The data read back matches the data written.") {
+            REQUIRE_FALSE(ran.has_error());
+            REQUIRE(t.done());
+            REQUIRE(t.result() == msg);
+         }
+      }
+      WHEN("A read is awaited on a file that isn't open.") {
+         ::posixpp::fd bad;
+         auto t = [](::posixpp::io_uring &ring, ::posixpp::fd const &file)
+                  -> task<int> {
+            char buf[1];
+            auto const result = co_await async_read(ring, file, buf, 1);
+            co_return result.has_error() ? result.error() : 0;
+         }(ring, bad);
+         REQUIRE_FALSE(run(ring, t).has_error());
+         THEN("The error is what the task gets.") {
+            REQUIRE(t.result() == EBADF);
+         }
+      }
+   }
+}
+
+SCENARIO("Pipe operations can be awaited using a reactor.", "[async_io]")
+{
+   using ::posixpp::fdflags;
+   GIVEN("A reactor and a non-blocking pipe.") {
+      auto r{::posixpp::reactor::create().result()};
+      auto p{::posixpp::pipe(fdflags::nonblock | fdflags::cloexec).result()};
+      WHEN("One task reads everything another writes a piece at a time.") {
+         ::std::string const msg = "A message in several pieces.";
+         auto reader = read_all(r, p.read_end);
+         reader.start();
+         REQUIRE_FALSE(reader.done());
+         // The pipe never fills up, so the writer never has to wait.
+         auto writer = write_pieces(r, p, msg);
+         REQUIRE_FALSE(run(r, writer).has_error());
+         while (!reader.done()) {
+            REQUIRE(r.poll(1000).result() == 1);
+         }
+         THEN("The reader gets the whole message.") {
+            REQUIRE(reader.done());
+            REQUIRE(reader.result() == msg);
+         }
+      }
+   }
+}
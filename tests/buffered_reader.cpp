@@ -0,0 +1,130 @@
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+#include <posixpp/buffered_reader.h>
+#include <posixpp/simpleio.h>
+#include <pppbase/find_byte.h>
+#include "tempdir.h"
+#include <catch2/catch.hpp>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+SCENARIO("find_byte agrees with memchr.", "[buffered_reader]")
+{
+   GIVEN("A buffer with a byte to find at every possible position.") {
+      char buf[100];
+      ::std::memset(buf, 'a', sizeof(buf));
+      THEN("Every start, end and position gives the same answer as memchr.") {
+         for (unsigned pos = 0; pos < sizeof(buf); ++pos) {
+            buf[pos] = '\n';
+            for (unsigned start = 0; start < 40; ++start) {
+               for (unsigned end = start; end <= sizeof(buf); end += 7) {
+                  auto const expected = static_cast<char const *>(
+                       ::std::memchr(buf + start, '\n', end - start)
+                  );
+                  auto const found =
+                       ::pppbase::find_byte(buf + start, buf + end, '\n');
+                  REQUIRE(found == (expected ? expected : buf + end));
+               }
+            }
+            buf[pos] = 'a';
+         }
+      }
+   }
+}
+
+SCENARIO("A buffered_reader splits a file into records.", "[buffered_reader]")
+{
+   GIVEN("A file in a temporary directory.") {
+      tempdir testdir;
+      auto fooname = testdir.get_name() / "foo";
+      using of = ::posixpp::openflags;
+      using fdf = ::posixpp::fdflags;
+      using ::posixpp::modeflags;
+      auto const write_file = [&fooname](::std::string_view contents) {
+         auto foo{
+              ::posixpp::open(fooname.native().c_str(),
+                              of::creat | of::trunc | fdf::wronly,
+                              modeflags::irwall).result()
+         };
+         REQUIRE(::posixpp::write(foo, contents.data(), contents.size())
+                 .result() == contents.size());
+      };
+      auto const open_file = [&fooname]() {
+         return ::posixpp::open(fooname.native().c_str(), fdf::rdonly)
+              .result();
+      };
+
+      WHEN("It has three lines, the last without a newline.") {
+         write_file("one\ntwo\n\nthree");
+         auto foo{open_file()};
+         auto reader{::posixpp::buffered_reader::create(foo).result()};
+         THEN("The lines come back with their newlines, then an empty view.") {
+            REQUIRE(reader.read_line().result() == "one\n");
+            REQUIRE(reader.read_line().result() == "two\n");
+            REQUIRE(reader.read_line().result() == "\n");
+            REQUIRE(reader.read_line().result() == "three");
+            REQUIRE(reader.at_eof());
+            REQUIRE(reader.read_line().result().empty());
+            REQUIRE(reader.read_line().result().empty());
+         }
+      }
+      WHEN("It's empty.") {
+         write_file("");
+         auto foo{open_file()};
+         auto reader{::posixpp::buffered_reader::create(foo).result()};
+         THEN("The first read is an empty view.") {
+            REQUIRE(reader.read_line().result().empty());
+         }
+      }
+      WHEN("It has records separated by something other than newline.") {
+         write_file("a,bc,,d\n");
+         auto foo{open_file()};
+         auto reader{::posixpp::buffered_reader::create(foo).result()};
+         THEN("read_until splits on that instead.") {
+            REQUIRE(reader.read_until(',').result() == "a,");
+            REQUIRE(reader.read_until(',').result() == "bc,");
+            REQUIRE(reader.read_until(',').result() == ",");
+            REQUIRE(reader.read_until(',').result() == "d\n");
+            REQUIRE(reader.read_until(',').result().empty());
+         }
+      }
+      WHEN("It has many lines, some much longer than the buffer.") {
+         ::std::string contents;
+         for (unsigned i = 0; i < 2000; ++i) {
+            contents += ::std::string(i % 97 == 0 ? 10000 : i % 61, 'x');
+            contents += ::std::to_string(i);
+            contents += '\n';
+         }
+         write_file(contents);
+         auto foo{open_file()};
+         auto reader{::posixpp::buffered_reader::create(foo, 4096).result()};
+         THEN("Every line is read correctly and the buffer grows to fit.") {
+            ::std::string_view rest = contents;
+            unsigned lines = 0;
+            for (auto line = reader.read_line().result();
+                 !line.empty();
+                 line = reader.read_line().result())
+            {
+               auto const nl = rest.find('\n');
+               REQUIRE(line == rest.substr(0, nl + 1));
+               rest.remove_prefix(nl + 1);
+               ++lines;
+            }
+            REQUIRE(lines == 2000);
+            REQUIRE(rest.empty());
+            REQUIRE(reader.capacity() >= 10000);
+         }
+      }
+   }
+   GIVEN("A file descriptor that isn't open.") {
+      ::posixpp::fd const bad{};
+      auto reader{::posixpp::buffered_reader::create(bad).result()};
+      THEN("Reading returns the error from read.") {
+         auto const line = reader.read_line();
+         REQUIRE(line.has_error());
+         REQUIRE(line.error() == EBADF);
+      }
+   }
+}
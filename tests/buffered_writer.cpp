@@ -0,0 +1,108 @@
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+#include <posixpp/buffered_writer.h>
+#include <posixpp/simpleio.h>
+#include "tempdir.h"
+#include <catch2/catch.hpp>
+#include <string>
+#include <string_view>
+
+SCENARIO("A buffered_writer collects writes into writev calls.",
+         "[buffered_writer]")
+{
+   GIVEN("A file in a temporary directory.") {
+      tempdir testdir;
+      auto fooname = testdir.get_name() / "foo";
+      using of = ::posixpp::openflags;
+      using fdf = ::posixpp::fdflags;
+      using ::posixpp::modeflags;
+      auto foo{
+           ::posixpp::open(fooname.native().c_str(),
+                           of::creat | fdf::wronly,
+                           modeflags::irwall).result()
+      };
+      auto const contents = [&fooname]() {
+         auto in{
+              ::posixpp::open(fooname.native().c_str(), fdf::rdonly).result()
+         };
+         ::std::string result;
+         char buf[4096];
+         for (::std::size_t n;
+              (n = ::posixpp::read(in, buf, sizeof(buf)).result()) > 0; )
+         {
+            result.append(buf, n);
+         }
+         return result;
+      };
+
+      WHEN("A few small pieces are written.") {
+         auto writer{::posixpp::buffered_writer::create(foo).result()};
+         REQUIRE_FALSE(writer.write("Hello").has_error());
+         REQUIRE_FALSE(writer.write(", ").has_error());
+         REQUIRE_FALSE(writer.write("world\n").has_error());
+         THEN("Nothing reaches the file until a flush.") {
+            REQUIRE(writer.pending() == 13);
+            REQUIRE(contents().empty());
+            REQUIRE_FALSE(writer.flush().has_error());
+            REQUIRE(writer.pending() == 0);
+            REQUIRE(contents() == "Hello, world\n");
+         }
+      }
+      WHEN("Copied and referenced pieces are interleaved.") {
+         ::std::string const big(100000, 'B');
+         {
+            auto writer{::posixpp::buffered_writer::create(foo).result()};
+            REQUIRE_FALSE(writer.write("head:").has_error());
+            REQUIRE_FALSE(writer.write_ref(big).has_error());
+            REQUIRE_FALSE(writer.write(":middle:").has_error());
+            REQUIRE_FALSE(writer.write_ref("ref").has_error());
+            REQUIRE_FALSE(writer.write(":tail").has_error());
+            REQUIRE(writer.pending() == 5 + big.size() + 8 + 3 + 5);
+         }
+         THEN("The destructor writes them all, in order.") {
+            REQUIRE(contents() == "head:" + big + ":middle:ref:tail");
+         }
+      }
+      WHEN("More pieces are referenced than fit in one writev.") {
+         ::std::string expected;
+         static char const digits[] = "0123456789";
+         auto writer{::posixpp::buffered_writer::create(foo).result()};
+         for (unsigned i = 0; i < 3 * writer.max_iov; ++i) {
+            REQUIRE_FALSE(writer.write_ref(digits + i % 10, 1).has_error());
+            REQUIRE_FALSE(writer.write(",").has_error());
+            expected += digits[i % 10];
+            expected += ',';
+         }
+         REQUIRE_FALSE(writer.flush().has_error());
+         THEN("They're all written, in order.") {
+            REQUIRE(contents() == expected);
+         }
+      }
+      WHEN("Small copies overflow the buffer.") {
+         ::std::string expected;
+         auto writer{::posixpp::buffered_writer::create(foo, 4096).result()};
+         for (unsigned i = 0; i < 1000; ++i) {
+            auto const piece = ::std::to_string(i) + " ";
+            REQUIRE_FALSE(writer.write(piece).has_error());
+            expected += piece;
+         }
+         REQUIRE(writer.pending() < 4096);
+         REQUIRE_FALSE(writer.flush().has_error());
+         THEN("Everything is written, in order.") {
+            REQUIRE(contents() == expected);
+         }
+      }
+   }
+   GIVEN("A file descriptor that isn't open.") {
+      ::posixpp::fd const bad{};
+      auto writer{::posixpp::buffered_writer::create(bad).result()};
+      REQUIRE_FALSE(writer.write("lost").has_error());
+      THEN("The error shows up when flushing, and the data is dropped.") {
+         auto const flushed = writer.flush();
+         REQUIRE(flushed.has_error());
+         REQUIRE(flushed.error() == EBADF);
+         REQUIRE(writer.pending() == 0);
+      }
+   }
+}
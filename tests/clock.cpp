@@ -0,0 +1,84 @@
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+#include <posixpp/clock.h>
+#include <syscalls/linux/time.h>
+#include <catch2/catch.hpp>
+#include <unistd.h>
+#include <cerrno>
+
+SCENARIO("The vDSO can be found through the auxiliary vector.", "[clock]")
+{
+   GIVEN("The auxiliary vector found from the original environment.") {
+      ::posixpp::init_auxv(environ);
+      THEN("The page size entry matches what libc says it is.") {
+         auto const pagesz = ::posixpp::getauxval(::posixpp::auxv_type::pagesz);
+         REQUIRE(pagesz.has_value());
+         REQUIRE(pagesz.value() == static_cast<::std::uint64_t>(::getpagesize()));
+      }
+      WHEN("The vDSO is initialized.") {
+         REQUIRE(::posixpp::init_vdso());
+         THEN("The functions every x86_64 kernel provides were found.") {
+            REQUIRE(::posixpp::priv_::vdso.clock_gettime != nullptr);
+            REQUIRE(::posixpp::priv_::vdso.gettimeofday != nullptr);
+            REQUIRE(::posixpp::priv_::vdso.time != nullptr);
+            REQUIRE(::posixpp::priv_::vdso.getcpu != nullptr);
+         }
+         THEN("Functions that aren't there aren't found.") {
+            namespace sl = ::syscalls::linux;
+            auto const base =
+                 ::posixpp::getauxval(::posixpp::auxv_type::sysinfo_ehdr);
+            sl::vdso_image const image{
+                 reinterpret_cast<void const *>(base.value())
+            };
+            REQUIRE(image.lookup("__vdso_not_a_function", "LINUX_2.6") == nullptr);
+            REQUIRE(image.lookup("__vdso_clock_gettime", "LINUX_0.0") == nullptr);
+         }
+      }
+   }
+}
+
+SCENARIO("Time and CPU functions give sensible answers.", "[clock]")
+{
+   using ::posixpp::clockid;
+   ::posixpp::init_auxv(environ);
+   bool const use_vdso = GENERATE(true, false);
+   if (use_vdso) {
+      REQUIRE(::posixpp::init_vdso());
+   } else {
+      ::posixpp::priv_::vdso = ::posixpp::priv_::vdso_functions{};
+   }
+   GIVEN("Two readings of the monotonic clock.") {
+      auto const t1 = ::posixpp::clock_gettime(clockid::monotonic).result();
+      auto const t2 = ::posixpp::clock_gettime(clockid::monotonic).result();
+      THEN("The second is not before the first.") {
+         REQUIRE((t2.tv_sec > t1.tv_sec ||
+                  (t2.tv_sec == t1.tv_sec && t2.tv_nsec >= t1.tv_nsec)));
+         REQUIRE(t1.tv_nsec < 1000000000);
+      }
+   }
+   GIVEN("An invalid clock.") {
+      auto const bad = static_cast<clockid>(-9999);
+      THEN("clock_gettime reports EINVAL.") {
+         auto const result = ::posixpp::clock_gettime(bad);
+         REQUIRE(result.has_error());
+         REQUIRE(result.error() == EINVAL);
+      }
+   }
+   GIVEN("The realtime clock, gettimeofday and time read close together.") {
+      auto const ts = ::posixpp::clock_gettime(clockid::realtime).result();
+      auto const tv = ::posixpp::gettimeofday().result();
+      auto const secs = ::posixpp::time().result();
+      THEN("They agree to within a couple of seconds.") {
+         REQUIRE(tv.tv_sec - ts.tv_sec <= 2);
+         REQUIRE(secs - ts.tv_sec <= 2);
+         REQUIRE(secs >= ts.tv_sec);
+      }
+   }
+   GIVEN("The CPU this thread is running on.") {
+      auto const loc = ::posixpp::getcpu().result();
+      THEN("It's one of the configured CPUs.") {
+         REQUIRE(loc.cpu < static_cast<unsigned>(::sysconf(_SC_NPROCESSORS_CONF)));
+      }
+   }
+}
@@ -0,0 +1,74 @@
+# Compile SOURCE to assembly with CXX and check the functions in it whose
+# names start with `codegen_` make a system call, and contain no stores to
+# memory, no use of the stack, no calls and no branches. Functions whose names
+# start with `codegen_checked_` may also have one compare and one conditional
+# branch, for looking at the result of the system call. Run with:
+#   cmake -DCXX=<compiler> -DINCLUDE=<dir> -DSOURCE=<file> -P check_asm.cmake
+
+execute_process(
+        COMMAND ${CXX} -std=c++20 -O2 -fno-asynchronous-unwind-tables
+                -I${INCLUDE} -S -o - ${SOURCE}
+        OUTPUT_VARIABLE asm
+        ERROR_VARIABLE errors
+        RESULT_VARIABLE status)
+if(NOT status EQUAL 0)
+    message(FATAL_ERROR "Compiling ${SOURCE} failed:\n${errors}")
+endif()
+
+# Lines are easier to deal with as a list, but ';' is a list separator.
+string(REPLACE ";" "," asm "${asm}")
+string(REPLACE "\n" ";" lines "${asm}")
+
+set(function "")
+set(branches_left 0)
+set(compares_left 0)
+set(checked 0)
+set(failed 0)
+set(no_syscall "")
+foreach(line IN LISTS lines)
+    if(line MATCHES "^([_A-Za-z0-9.$]+):")
+        set(label "${CMAKE_MATCH_1}")
+        if(label MATCHES "codegen_")
+            set(function "${label}")
+            if(label MATCHES "codegen_checked_")
+                set(branches_left 1)
+                set(compares_left 1)
+            else()
+                set(branches_left 0)
+                set(compares_left 0)
+            endif()
+            list(APPEND no_syscall "${label}")
+            math(EXPR checked "${checked} + 1")
+        elseif(NOT label MATCHES "^\\.L")
+            set(function "")
+        endif()
+    elseif(function AND line MATCHES "^\t[a-z]")
+        # In AT&T syntax the destination comes last, so a memory operand
+        # after the last comma is a store.
+        if(line MATCHES "^\t(cmp|test)[a-z]*[ \t]" AND compares_left GREATER 0)
+            math(EXPR compares_left "${compares_left} - 1")
+        elseif(line MATCHES "^\tj[a-ln-z][a-z]*[ \t]"
+               AND branches_left GREATER 0)
+            math(EXPR branches_left "${branches_left} - 1")
+        elseif(line MATCHES ",[^,]*\\(" OR line MATCHES "%rsp"
+           OR line MATCHES "^\t(call|push|pop|j[a-z]+)[a-z]*[ \t]")
+            message(SEND_ERROR "${function}: unexpected instruction:${line}")
+            set(failed 1)
+        elseif(line MATCHES "^\tsyscall")
+            list(REMOVE_ITEM no_syscall "${function}")
+        endif()
+    endif()
+endforeach()
+
+foreach(function IN LISTS no_syscall)
+    message(SEND_ERROR "${function}: no syscall instruction")
+    set(failed 1)
+endforeach()
+
+if(checked EQUAL 0)
+    message(FATAL_ERROR "No codegen_ functions found in ${SOURCE}")
+endif()
+if(failed)
+    message(FATAL_ERROR "Generated code in ${SOURCE} isn't as lean as it should be.")
+endif()
+message(STATUS "${checked} functions in ${SOURCE} look right.")
@@ -0,0 +1,43 @@
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+// Compiled to assembly by check_asm.cmake, which looks at every function whose
+// name starts with `codegen_`. Each one should be nothing but the system call
+// and moving things into the right registers; the result goes back to the
+// caller in registers without being stored anywhere.
+//
+// The raw layer hands back %rax without even checking it for an error.
+// `::posixpp::read` and friends return an ordinary `expected<size_t>`, which
+// keeps its error in a separate tag, so they're allowed the one compare and
+// branch that moves the error out of %rax, and nothing more.
+
+#include <posixpp/simpleio.h>
+
+static_assert(sizeof(::syscalls::linux::expected_t) ==
+              sizeof(::syscalls::linux::x86_64::val_t));
+
+::syscalls::linux::expected_t
+codegen_raw_read(int fd, char *buf, ::std::size_t size) noexcept
+{
+   return ::syscalls::linux::read(fd, buf, size);
+}
+
+::syscalls::linux::expected_t
+codegen_raw_write(int fd, char const *buf, ::std::size_t size) noexcept
+{
+   return ::syscalls::linux::write(fd, buf, size);
+}
+
+::posixpp::expected<::std::size_t>
+codegen_checked_read(::posixpp::fd const &file, char *buf,
+                     ::std::size_t size) noexcept
+{
+   return ::posixpp::read(file, buf, size);
+}
+
+::posixpp::expected<::std::size_t>
+codegen_checked_write(::posixpp::fd const &file, char const *buf,
+                      ::std::size_t size) noexcept
+{
+   return ::posixpp::write(file, buf, size);
+}
@@ -0,0 +1,58 @@
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+// Compiled to assembly by check_asm.cmake, which looks at every function whose
+// name starts with `codegen_`. There's one for each number of system call
+// arguments, and each should just move its arguments into the registers the
+// kernel wants them in, with nothing going through the stack.
+
+#include <syscalls/linux/memory.h>
+#include <syscalls/linux/simple_io.h>
+#include <syscalls/linux/splice.h>
+#include <syscalls/linux/syscall.h>
+
+namespace sl = ::syscalls::linux;
+using sl::call_id;
+using sl::x86_64::do_syscall;
+using sl::x86_64::val_t;
+
+val_t codegen_args0() noexcept
+{
+   return do_syscall(call_id::getpid);
+}
+
+sl::expected_t codegen_args1(int fd) noexcept
+{
+   return sl::dup(fd);
+}
+
+sl::expected_t codegen_args3(int fd, char *buf, ::std::int64_t size) noexcept
+{
+   return sl::read(fd, buf, size);
+}
+
+sl::expected_t codegen_args4(int fd, char *buf, ::std::int64_t size,
+                             ::std::int64_t offset) noexcept
+{
+   return sl::pread64(fd, buf, size, offset);
+}
+
+val_t codegen_args5(unsigned a, int b, void *c, call_id d,
+                    ::std::uint16_t e) noexcept
+{
+   return do_syscall(call_id::getpid, a, b, c, d, e);
+}
+
+sl::expected_t codegen_args6_mmap(void *addr, ::std::size_t length, int prot,
+                                  int flags, int fd,
+                                  ::std::int64_t offset) noexcept
+{
+   return sl::mmap(addr, length, prot, flags, fd, offset);
+}
+
+sl::expected_t codegen_args6_splice(int fd_in, ::std::int64_t *off_in,
+                                    int fd_out, ::std::int64_t *off_out,
+                                    ::std::size_t len, unsigned flags) noexcept
+{
+   return sl::splice(fd_in, off_in, fd_out, off_out, len, flags);
+}
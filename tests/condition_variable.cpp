@@ -0,0 +1,113 @@
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+#include <posixpp/condition_variable.h>
+#include <posixpp/clock.h>
+#include <catch2/catch.hpp>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+::posixpp::timespec monotonic_after(::std::int64_t nsecs)
+{
+   auto ts = ::posixpp::clock_gettime(::posixpp::clockid::monotonic).result();
+   ts.tv_nsec += nsecs;
+   ts.tv_sec += ts.tv_nsec / 1000000000;
+   ts.tv_nsec %= 1000000000;
+   return ts;
+}
+
+} // namespace
+
+SCENARIO("A posixpp::condition_variable wakes threads waiting on it.",
+         "[condition_variable]")
+{
+   GIVEN("A mutex and condition variable protecting a simple queue.") {
+      ::posixpp::mutex m;
+      ::posixpp::condition_variable cv;
+      constexpr unsigned items = 10000;
+      unsigned produced = 0;
+      unsigned consumed = 0;
+
+      WHEN("A consumer waits for items a producer hands over one at a time.") {
+         ::std::thread consumer{[&]() {
+            ::std::lock_guard<::posixpp::mutex> lock{m};
+            while (consumed < items) {
+               cv.wait(m, [&]() { return produced > consumed; }).throw_if_error();
+               consumed = produced;
+               cv.notify_one().throw_if_error();
+            }
+         }};
+         for (unsigned i = 0; i < items; ++i) {
+            ::std::lock_guard<::posixpp::mutex> lock{m};
+            cv.wait(m, [&]() { return consumed == produced; }).throw_if_error();
+            ++produced;
+            cv.notify_one().throw_if_error();
+         }
+         consumer.join();
+         THEN("Everything produced was consumed.") {
+            REQUIRE(consumed == items);
+         }
+      }
+      WHEN("Several threads wait for a flag that's set with notify_all.") {
+         constexpr unsigned nthreads = 8;
+         bool go = false;
+         unsigned woke = 0;
+         ::std::vector<::std::thread> threads;
+         for (unsigned t = 0; t < nthreads; ++t) {
+            threads.emplace_back([&]() {
+               ::std::lock_guard<::posixpp::mutex> lock{m};
+               cv.wait(m, [&go]() { return go; }).throw_if_error();
+               ++woke;
+            });
+         }
+         {
+            ::std::lock_guard<::posixpp::mutex> lock{m};
+            go = true;
+            cv.notify_all().throw_if_error();
+         }
+         for (auto &thread : threads) {
+            thread.join();
+         }
+         THEN("All of them woke up.") {
+            REQUIRE(woke == nthreads);
+            REQUIRE(m.try_lock());
+            REQUIRE_FALSE(m.unlock().has_error());
+         }
+      }
+      WHEN("A thread waits with a deadline nobody notifies before.") {
+         ::std::lock_guard<::posixpp::mutex> lock{m};
+         auto const deadline = monotonic_after(10000000);
+         auto const status = cv.wait_until(m, deadline).result();
+         THEN("It times out after the deadline, holding the mutex.") {
+            REQUIRE(status == ::posixpp::cv_status::timeout);
+            auto const now = monotonic_after(0);
+            REQUIRE((now.tv_sec > deadline.tv_sec ||
+                     (now.tv_sec == deadline.tv_sec &&
+                      now.tv_nsec >= deadline.tv_nsec)));
+            REQUIRE_FALSE(m.try_lock());
+         }
+      }
+      WHEN("A thread waits with a far deadline for a predicate that comes true.") {
+         bool ready = false;
+         ::std::thread setter{[&]() {
+            ::std::lock_guard<::posixpp::mutex> lock{m};
+            ready = true;
+            cv.notify_all().throw_if_error();
+         }};
+         bool result;
+         {
+            ::std::lock_guard<::posixpp::mutex> lock{m};
+            auto const deadline = monotonic_after(10000000000);
+            result = cv.wait_until(m, deadline, [&ready]() { return ready; })
+                          .result();
+         }
+         setter.join();
+         THEN("The predicate was true when the wait ended.") {
+            REQUIRE(result);
+         }
+      }
+   }
+}
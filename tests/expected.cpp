@@ -1,5 +1,9 @@
 #include <posixpp/expected.h>
+#include <posixpp/fd.h>
+#include <syscalls/linux/syscall.h>
 #include <cerrno>
+#include <cstdint>
+#include <type_traits>
 #include <catch2/catch.hpp>
 
 class move_detector {
@@ -123,3 +127,137 @@ SCENARIO( "expected holds results and throws exceptions", "[expected]" ) {
       }
    }
 }
+
+// The raw system call result keeps errors where the kernel puts them.
+static_assert(sizeof(::syscalls::linux::expected_t) == 8);
+// Other types keep a separate tag, however much room they have.
+static_assert(sizeof(::posixpp::expected<::std::int64_t>) > 8);
+static_assert(sizeof(::posixpp::expected<::std::size_t>) > 8);
+static_assert(sizeof(::posixpp::expected<::posixpp::fd>) > sizeof(int));
+// And trivial types stay trivial, so they can be passed in registers.
+static_assert(::std::is_trivially_copyable_v<::posixpp::expected<int>>);
+static_assert(
+     ::std::is_trivially_copyable_v<::posixpp::expected<::std::size_t>>
+);
+static_assert(::std::is_trivially_copyable_v<::syscalls::linux::expected_t>);
+static_assert(!::std::is_copy_constructible_v<::posixpp::expected<cant_copy>>);
+static_assert(!::std::is_trivially_destructible_v<
+                   ::posixpp::expected<::posixpp::fd>>);
+
+SCENARIO( "A system call result keeps errors in the return value",
+          "[expected]" )
+{
+   using expected_t = ::syscalls::linux::expected_t;
+   using ::syscalls::linux::syscall_val;
+   GIVEN( "One holding the largest possible error" ) {
+      expected_t const result{expected_t::err_tag{}, 4095};
+      THEN(" the error comes back out ") {
+         CHECK(result.has_error());
+         CHECK(result.error() == 4095);
+      }
+   }
+   GIVEN( "One holding -4096, just below the errors" ) {
+      expected_t const result{syscall_val{-4096}};
+      THEN(" it's a value, not an error ") {
+         CHECK_FALSE(result.has_error());
+         CHECK(result.result() == -4096);
+      }
+   }
+   GIVEN( "One holding EPERM" ) {
+      expected_t const result{expected_t::err_tag{}, EPERM};
+      THEN(" it's an error ") {
+         CHECK(result.has_error());
+         CHECK(result.error() == EPERM);
+      }
+   }
+}
+
+SCENARIO( "expected keeps any value of a type apart from errors",
+          "[expected]" )
+{
+   GIVEN( "An expected<size_t> holding what would be an error from the "
+          "kernel" )
+   {
+      using expected_t = ::posixpp::expected<::std::size_t>;
+      auto const big = static_cast<::std::size_t>(-3);
+      expected_t const result{big};
+      THEN(" it's a size, not an error ") {
+         CHECK_FALSE(result.has_error());
+         CHECK(result.result() == big);
+      }
+   }
+   GIVEN( "An expected<int64_t> holding -5 and one holding -5 as an error" ) {
+      using expected_t = ::posixpp::expected<::std::int64_t>;
+      expected_t const value{-5};
+      expected_t const error{expected_t::err_tag{}, 5};
+      THEN(" only the second is an error ") {
+         CHECK_FALSE(value.has_error());
+         CHECK(value.result() == -5);
+         CHECK(error.has_error());
+         CHECK(error.error() == 5);
+      }
+   }
+   GIVEN( "An expected<fd> holding an invalid fd" ) {
+      using expected_t = ::posixpp::expected<::posixpp::fd>;
+      expected_t result{::posixpp::fd{}};
+      THEN(" it's not an error ") {
+         CHECK_FALSE(result.has_error());
+         CHECK_FALSE(result.result().is_valid());
+      }
+   }
+   GIVEN( "An expected<fd> holding EBADF that's moved" ) {
+      using expected_t = ::posixpp::expected<::posixpp::fd>;
+      expected_t result{expected_t::err_tag{}, EBADF};
+      expected_t moved{::std::move(result)};
+      THEN(" both are still errors ") {
+         CHECK(moved.has_error());
+         CHECK(moved.error() == EBADF);
+         CHECK(result.has_error());
+         CHECK(result.error() == EBADF);
+      }
+   }
+}
+
+namespace {
+void ignore_error(int) noexcept {}
+} // namespace
+
+SCENARIO( "The error handler can be replaced", "[expected]" ) {
+   GIVEN( "A new error handler that's been installed" ) {
+      auto const original = ::posixpp::set_error_handler(ignore_error);
+      THEN(" installing the original again gives back the new one ") {
+         CHECK(original != nullptr);
+         CHECK(::posixpp::set_error_handler(original) == ignore_error);
+      }
+   }
+#ifndef POSIXPP_NO_EXCEPTIONS
+   GIVEN( "Exceptions are available" ) {
+      auto const original = ::posixpp::set_error_handler(ignore_error);
+      using expected_t = ::posixpp::expected<int>;
+      expected_t const result{expected_t::err_tag{}, EBADF};
+      THEN(" errors are still thrown instead of handled ") {
+         CHECK_THROWS_AS(result.result(), ::std::system_error);
+      }
+      ::posixpp::set_error_handler(original);
+   }
+#endif
+}
+
+SCENARIO( "expected<void> only holds an error", "[expected]" ) {
+   GIVEN( "A default constructed expected<void>" ) {
+      ::posixpp::expected<void> const result;
+      THEN(" it has no error, and asking for one throws no_error_here ") {
+         CHECK_FALSE(result.has_error());
+         CHECK_NOTHROW(result.result());
+         CHECK_THROWS_AS(result.error(), ::posixpp::no_error_here);
+      }
+   }
+   GIVEN( "An expected<void> holding EBADF" ) {
+      ::posixpp::expected<void> const result{EBADF};
+      THEN(" the error is EBADF, and asking for the result throws ") {
+         CHECK(result.has_error());
+         CHECK(result.error() == EBADF);
+         CHECK_THROWS_AS(result.result(), ::std::system_error);
+      }
+   }
+}
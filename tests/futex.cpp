@@ -0,0 +1,68 @@
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+#include <posixpp/futex.h>
+#include <posixpp/clock.h>
+#include <catch2/catch.hpp>
+#include <atomic>
+#include <thread>
+
+SCENARIO("wait_any sleeps on several futex words at once.", "[futex]")
+{
+   GIVEN("A queue length and a shutdown flag, both zero.") {
+      ::posixpp::futex_word queued{0};
+      ::posixpp::futex_word shutdown{0};
+      WHEN("One of them already has a different value.") {
+         shutdown.store(1);
+         ::posixpp::futex_waiter waiters[] = {{queued, 0}, {shutdown, 0}};
+         auto const result = ::posixpp::wait_any(waiters);
+         THEN("The wait doesn't start.") {
+            REQUIRE(result.has_error());
+            REQUIRE(result.error()
+                    == static_cast<int>(::std::errc::resource_unavailable_try_again));
+         }
+      }
+      WHEN("Another thread sets the shutdown flag and wakes it.") {
+         ::std::atomic<bool> started = false;
+         ::std::thread setter{[&]() {
+            while (!started.load()) {
+               ::std::this_thread::yield();
+            }
+            shutdown.store(1);
+            static_cast<void>(::posixpp::futex_wake(shutdown, 1));
+         }};
+         unsigned woken = ~0U;
+         for (;;) {
+            ::posixpp::futex_waiter waiters[] = {{queued, 0}, {shutdown, 0}};
+            started.store(true);
+            auto const result = ::posixpp::wait_any(waiters);
+            if (!result.has_error()) {
+               woken = result.result();
+               break;
+            } else if (shutdown.load() != 0) {
+               // It was set before the wait started.
+               woken = 1;
+               break;
+            }
+         }
+         setter.join();
+         THEN("wait_any says it was the shutdown flag.") {
+            REQUIRE(woken == 1);
+         }
+      }
+      WHEN("Nobody wakes either one.") {
+         auto deadline = ::posixpp::clock_gettime(
+              ::posixpp::clockid::monotonic
+         ).result();
+         deadline.tv_nsec += 10'000'000;
+         deadline.tv_sec += deadline.tv_nsec / 1'000'000'000;
+         deadline.tv_nsec %= 1'000'000'000;
+         ::posixpp::futex_waiter waiters[] = {{queued, 0}, {shutdown, 0}};
+         auto const result = ::posixpp::wait_any_until(waiters, deadline);
+         THEN("A timed wait gives up with ETIMEDOUT.") {
+            REQUIRE(result.has_error());
+            REQUIRE(result.error() == static_cast<int>(::std::errc::timed_out));
+         }
+      }
+   }
+}
@@ -0,0 +1,132 @@
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+#include <posixpp/heap.h>
+#include <catch2/catch.hpp>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace heap = ::posixpp::heap;
+
+namespace {
+constexpr bool classes_fit()
+{
+   for (::std::size_t size = 0; size <= heap::max_small_size; ++size) {
+      unsigned const idx = heap::size_class_of(size);
+      if (idx >= heap::num_size_classes || heap::class_size(idx) < size
+          || (idx > 0 && heap::class_size(idx - 1) >= size))
+      {
+         return false;
+      }
+   }
+   return true;
+}
+static_assert(classes_fit());
+static_assert(heap::class_size(heap::num_size_classes - 1)
+              == heap::max_small_size);
+
+bool is_aligned(void *ptr, ::std::size_t align)
+{
+   return reinterpret_cast<::std::uintptr_t>(ptr) % align == 0;
+}
+} // namespace
+
+SCENARIO("The heap hands out and takes back memory.", "[heap]")
+{
+   GIVEN("Small objects of every size class.") {
+      ::std::vector<void *> objects;
+      for (unsigned idx = 0; idx < heap::num_size_classes; ++idx) {
+         ::std::size_t const size = heap::class_size(idx);
+         void *const obj = heap::allocate(size);
+         REQUIRE(obj != nullptr);
+         ::std::memset(obj, static_cast<int>(idx), size);
+         objects.push_back(obj);
+      }
+      THEN("Each is aligned, the right size, and wasn't overwritten.") {
+         for (unsigned idx = 0; idx < heap::num_size_classes; ++idx) {
+            auto *const obj = static_cast<unsigned char *>(objects[idx]);
+            REQUIRE(is_aligned(obj, heap::min_align));
+            REQUIRE(heap::usable_size(obj) == heap::class_size(idx));
+            REQUIRE(obj[0] == idx);
+            REQUIRE(obj[heap::class_size(idx) - 1] == idx);
+         }
+      }
+      for (void *obj : objects) {
+         heap::deallocate(obj);
+      }
+   }
+   GIVEN("An object that was just freed.") {
+      void *const first = heap::allocate(100);
+      heap::deallocate(first);
+      THEN("The next one the same size reuses it.") {
+         void *const second = heap::allocate(100);
+         REQUIRE(second == first);
+         heap::deallocate(second);
+      }
+   }
+   GIVEN("Requests with more alignment than usual.") {
+      for (::std::size_t align : {32, 64, 128, 4096, 65536}) {
+         void *const obj = heap::allocate(24, align);
+         REQUIRE(obj != nullptr);
+         REQUIRE(is_aligned(obj, align));
+         REQUIRE(heap::usable_size(obj) >= 24);
+         heap::deallocate(obj);
+      }
+   }
+   GIVEN("A block too big for any size class.") {
+      auto const before = heap::big_block_stats();
+      ::std::size_t const size = 1024 * 1024 + 1;
+      auto *const block = static_cast<char *>(heap::allocate(size));
+      REQUIRE(block != nullptr);
+      block[0] = 'a';
+      block[size - 1] = 'z';
+      THEN("It has its own mapping, which goes away when it's freed.") {
+         REQUIRE(heap::usable_size(block) >= size);
+         auto const during = heap::big_block_stats();
+         REQUIRE(during.allocations == before.allocations + 1);
+         REQUIRE(during.bytes_mapped > before.bytes_mapped);
+         heap::deallocate(block);
+         auto const after = heap::big_block_stats();
+         REQUIRE(after.deallocations == before.deallocations + 1);
+         REQUIRE(after.bytes_mapped == before.bytes_mapped);
+      }
+   }
+   GIVEN("A request the kernel can't satisfy.") {
+      THEN("It fails instead of crashing.") {
+         REQUIRE(heap::allocate(~::std::size_t{0} - 4096) == nullptr);
+      }
+   }
+}
+
+SCENARIO("Objects can be freed by a different thread.", "[heap]")
+{
+   GIVEN("Lots of objects allocated on another thread.") {
+      unsigned const idx = heap::size_class_of(48);
+      heap::flush_thread_cache();
+      auto const before = heap::stats(idx);
+      ::std::vector<void *> objects(1000);
+      ::std::thread{[&objects] {
+         for (void *&obj : objects) {
+            obj = heap::allocate(48);
+         }
+         heap::flush_thread_cache();
+      }}.join();
+      WHEN("They're freed on this one.") {
+         for (void *obj : objects) {
+            REQUIRE(heap::usable_size(obj) == 48);
+            heap::deallocate(obj);
+         }
+         heap::flush_thread_cache();
+         THEN("The counts add up, and they're all back on the central list.") {
+            auto const after = heap::stats(idx);
+            REQUIRE(after.object_size == 48);
+            REQUIRE(after.allocations - before.allocations == 1000);
+            REQUIRE(after.deallocations - before.deallocations == 1000);
+            REQUIRE(after.central_free >= 1000);
+            REQUIRE(after.slabs >= 1);
+         }
+      }
+   }
+}
@@ -0,0 +1,107 @@
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+#include <posixpp/io_uring.h>
+#include <posixpp/simpleio.h>
+#include "tempdir.h"
+#include <catch2/catch.hpp>
+#include <cerrno>
+#include <algorithm>
+
+SCENARIO("An io_uring can submit operations and collect their results.",
+         "[io_uring]")
+{
+   GIVEN("A new io_uring with 8 entries.") {
+      using ::posixpp::io_uring;
+      auto ring{io_uring::create(8).result()};
+
+      THEN("It has a valid fd and at least 8 submission queue entries.") {
+         REQUIRE(ring.ring_fd().is_valid());
+         REQUIRE(ring.sq_entries() >= 8);
+      }
+      WHEN("Three nops are prepared and submitted in one batch.") {
+         REQUIRE(ring.prep_nop(1));
+         REQUIRE(ring.prep_nop(2));
+         REQUIRE(ring.prep_nop(3));
+         REQUIRE(ring.pending() == 3);
+         REQUIRE(ring.submit(3).result() == 3);
+         REQUIRE(ring.pending() == 0);
+         THEN("Three successful completions with the right user data arrive.") {
+            ::std::uint64_t seen[3] = {};
+            auto count = ring.for_each_completion(
+                 [&seen](::posixpp::io_completion &&c) {
+                    REQUIRE(c.result.result() == 0);
+                    seen[c.user_data - 1] = c.user_data;
+                 }
+            );
+            REQUIRE(count == 3);
+            REQUIRE(seen[0] == 1);
+            REQUIRE(seen[1] == 2);
+            REQUIRE(seen[2] == 3);
+            REQUIRE_FALSE(ring.peek_completion().has_value());
+         }
+      }
+      WHEN("More operations are prepared than there are entries.") {
+         unsigned prepared = 0;
+         while (ring.prep_nop(prepared)) {
+            ++prepared;
+         }
+         THEN("Preparation stops exactly when the queue is full.") {
+            REQUIRE(prepared == ring.sq_entries());
+            REQUIRE(ring.submit().result() == prepared);
+            REQUIRE(ring.prep_nop(prepared));
+         }
+      }
+      WHEN("A read from an invalid file descriptor is submitted.") {
+         char buf[1];
+         REQUIRE(ring.prep_read(::posixpp::fd{}, buf, sizeof(buf), 0, 42));
+         auto comp{ring.wait_completion().result()};
+         THEN("The completion carries EBADF instead of a result.") {
+            REQUIRE(comp.user_data == 42);
+            REQUIRE(comp.result.has_error());
+            REQUIRE(comp.result.error() == EBADF);
+         }
+      }
+      AND_GIVEN("A file opened for read and write in a temporary directory.") {
+         tempdir testdir;
+         auto fooname = testdir.get_name() / "foo";
+         using of = ::posixpp::openflags;
+         using fdf = ::posixpp::fdflags;
+         using ::posixpp::modeflags;
+         auto foo{
+              ::posixpp::open(fooname.native().c_str(),
+                              of::creat | fdf::rdwr,
+                              modeflags::irwall).result()
+         };
+         static const char msg[] = "io_uring stuff\n";
+         WHEN("A message is written at offset 0 through the ring.") {
+            REQUIRE(ring.prep_write(foo, msg, sizeof(msg) - 1, 0, 7));
+            auto wcomp{ring.wait_completion().result()};
+            REQUIRE(wcomp.user_data == 7);
+            REQUIRE(wcomp.result.result() == sizeof(msg) - 1);
+            AND_WHEN("It is read back with a read and an fsync in a batch.") {
+               char readmsg[sizeof(msg)] = {};
+               REQUIRE(ring.prep_fsync(foo, true, 8));
+               REQUIRE(ring.prep_read(foo, readmsg, sizeof(readmsg), 0, 9));
+               REQUIRE(ring.submit(2).result() == 2);
+               THEN("The data read matches the data written.") {
+                  int reads = 0;
+                  ring.for_each_completion(
+                       [&](::posixpp::io_completion &&c) {
+                          if (c.user_data == 9) {
+                             ++reads;
+                             REQUIRE(c.result.result() == sizeof(msg) - 1);
+                          } else {
+                             REQUIRE(c.user_data == 8);
+                             REQUIRE_FALSE(c.result.has_error());
+                          }
+                       }
+                  );
+                  REQUIRE(reads == 1);
+                  REQUIRE(::std::equal(msg, msg + sizeof(msg) - 1, readmsg));
+               }
+            }
+         }
+      }
+   }
+}
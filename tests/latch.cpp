@@ -0,0 +1,96 @@
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+#include <posixpp/latch.h>
+#include <posixpp/barrier.h>
+#include <catch2/catch.hpp>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+SCENARIO("A posixpp::latch releases its waiters once it counts down.",
+         "[latch]")
+{
+   GIVEN("A latch expecting 8 threads.") {
+      constexpr unsigned nthreads = 8;
+      ::posixpp::latch done{nthreads};
+      THEN("It fits in one 32 bit word, and isn't done yet.") {
+         STATIC_REQUIRE(sizeof(done) == 4);
+         REQUIRE_FALSE(done.try_wait());
+      }
+      WHEN("The threads each count down and wait.") {
+         ::std::atomic<unsigned> before = 0;
+         ::std::atomic<unsigned> early = 0;
+         ::std::vector<::std::thread> threads;
+         for (unsigned t = 0; t < nthreads; ++t) {
+            threads.emplace_back([&]() {
+               before.fetch_add(1);
+               static_cast<void>(done.arrive_and_wait());
+               if (before.load() != nthreads) {
+                  early.fetch_add(1);
+               }
+            });
+         }
+         REQUIRE_FALSE(done.wait().has_error());
+         for (auto &thread : threads) {
+            thread.join();
+         }
+         THEN("Nobody got past it before everybody arrived.") {
+            REQUIRE(done.try_wait());
+            REQUIRE(early.load() == 0);
+         }
+      }
+   }
+}
+
+SCENARIO("A posixpp::barrier holds threads together phase by phase.",
+         "[barrier]")
+{
+   GIVEN("A barrier for 4 threads that counts its phases.") {
+      constexpr unsigned nthreads = 4;
+      constexpr unsigned nphases = 1000;
+      unsigned phases = 0;
+      auto count_phase = [&phases]() noexcept { ++phases; };
+      ::posixpp::barrier<decltype(count_phase)> sync{nthreads, count_phase};
+      WHEN("Each thread records its phase, many times over.") {
+         ::std::atomic<unsigned> mismatches = 0;
+         ::std::vector<::std::thread> threads;
+         for (unsigned t = 0; t < nthreads; ++t) {
+            threads.emplace_back([&]() {
+               for (unsigned i = 0; i < nphases; ++i) {
+                  if (phases != i) {
+                     mismatches.fetch_add(1);
+                  }
+                  static_cast<void>(sync.arrive_and_wait());
+               }
+            });
+         }
+         for (auto &thread : threads) {
+            thread.join();
+         }
+         THEN("Every thread saw every phase finish before starting the next.") {
+            REQUIRE(phases == nphases);
+            REQUIRE(mismatches.load() == 0);
+         }
+      }
+      WHEN("One thread drops out after the first phase.") {
+         ::std::vector<::std::thread> threads;
+         threads.emplace_back([&]() {
+            sync.arrive_and_drop();
+         });
+         for (unsigned t = 1; t < nthreads; ++t) {
+            threads.emplace_back([&]() {
+               for (unsigned i = 0; i < 10; ++i) {
+                  static_cast<void>(sync.arrive_and_wait());
+               }
+            });
+         }
+         for (auto &thread : threads) {
+            thread.join();
+         }
+         THEN("The rest carry on without it.") {
+            REQUIRE(phases == 10);
+         }
+      }
+   }
+}
@@ -0,0 +1,120 @@
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+#include <posixpp/mapping.h>
+#include <posixpp/simpleio.h>
+#include "tempdir.h"
+#include <catch2/catch.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <string_view>
+#include <utility>
+
+SCENARIO("A file can be mapped into memory.", "[mapping]")
+{
+   GIVEN("A file with some text in it.") {
+      tempdir testdir;
+      auto fooname = testdir.get_name() / "foo";
+      using of = ::posixpp::openflags;
+      using fdf = ::posixpp::fdflags;
+      using ::posixpp::modeflags;
+      using ::posixpp::protflags;
+      using ::posixpp::mapflags;
+      using ::posixpp::madvice;
+      auto foo{
+           ::posixpp::open(fooname.native().c_str(),
+                           of::creat | fdf::rdwr,
+                           modeflags::irwall).result()
+      };
+      static constexpr ::std::string_view msg = "mapped file contents\n";
+      REQUIRE(::posixpp::write(foo, msg.data(), msg.size()).result()
+              == msg.size());
+
+      WHEN("It's mapped for reading.") {
+         auto map{
+              ::posixpp::mmap(foo, msg.size(), 0, protflags::read,
+                              mapflags::shared | mapflags::populate).result()
+         };
+         THEN("The mapping has the contents of the file.") {
+            REQUIRE(map.is_valid());
+            REQUIRE(map.size() == msg.size());
+            REQUIRE(::std::string_view(map.data(), map.size()) == msg);
+         }
+         THEN("Advice about how it will be used is accepted.") {
+            REQUIRE_FALSE(map.advise(madvice::sequential).has_error());
+            REQUIRE_FALSE(map.advise(madvice::willneed).has_error());
+            REQUIRE_FALSE(map.advise(madvice::dontneed, 5, 3).has_error());
+            REQUIRE(::std::string_view(map.data(), map.size()) == msg);
+         }
+         THEN("Moving it transfers ownership, and unmap reports success.") {
+            ::posixpp::mapping other{::std::move(map)};
+            REQUIRE_FALSE(map.is_valid());
+            REQUIRE(other.is_valid());
+            REQUIRE_FALSE(other.unmap().has_error());
+            REQUIRE_FALSE(other.is_valid());
+         }
+      }
+      WHEN("It's mapped shared and writeable, and changed through the map.") {
+         {
+            auto map{
+                 ::posixpp::mmap(foo, msg.size(), 0,
+                                 protflags::read | protflags::write,
+                                 mapflags::shared).result()
+            };
+            ::std::fill(map.begin(), map.begin() + 6, 'X');
+         }
+         THEN("The file changes.") {
+            char buf[msg.size()];
+            auto reread{
+                 ::posixpp::open(fooname.native().c_str(), fdf::rdonly).result()
+            };
+            REQUIRE(::posixpp::read(reread, buf, sizeof(buf)).result()
+                    == msg.size());
+            REQUIRE(::std::string_view(buf, 6) == "XXXXXX");
+            REQUIRE(::std::string_view(buf + 6, msg.size() - 6)
+                    == msg.substr(6));
+         }
+      }
+      WHEN("It's mapped at an offset that isn't page aligned.") {
+         auto map{::posixpp::mmap(foo, msg.size(), 1, protflags::read,
+                                  mapflags::shared)};
+         THEN("The kernel refuses.") {
+            REQUIRE(map.has_error());
+            REQUIRE(map.error() == EINVAL);
+         }
+      }
+   }
+}
+
+SCENARIO("Anonymous mappings can be advised and resized.", "[mapping]")
+{
+   GIVEN("An anonymous mapping of a few pages.") {
+      constexpr ::std::size_t page = ::posixpp::mapping::page_size;
+      auto map{::posixpp::mmap_anonymous(4 * page).result()};
+      REQUIRE(map.size() == 4 * page);
+      THEN("It starts out zero filled.") {
+         REQUIRE(::std::all_of(map.begin(), map.end(),
+                               [](char c) { return c == 0; }));
+      }
+      WHEN("It's populated for writing and written to.") {
+         REQUIRE_FALSE(map.populate(true).has_error());
+         map.data()[0] = 'a';
+         map.data()[4 * page - 1] = 'z';
+         AND_WHEN("It's grown to many times its size.") {
+            REQUIRE_FALSE(map.resize(256 * page).has_error());
+            THEN("The contents are kept and the new part is zero.") {
+               REQUIRE(map.size() == 256 * page);
+               REQUIRE(map.data()[0] == 'a');
+               REQUIRE(map.data()[4 * page - 1] == 'z');
+               REQUIRE(map.data()[4 * page] == 0);
+            }
+         }
+         AND_WHEN("The pages are discarded.") {
+            REQUIRE_FALSE(map.advise(::posixpp::madvice::dontneed).has_error());
+            THEN("They read as zero again.") {
+               REQUIRE(map.data()[0] == 0);
+            }
+         }
+      }
+   }
+}
@@ -0,0 +1,49 @@
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+#include <posixpp/mutex.h>
+#include <catch2/catch.hpp>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+SCENARIO("A posixpp::mutex provides mutual exclusion.", "[mutex]")
+{
+   GIVEN("An unlocked mutex.") {
+      ::posixpp::mutex m;
+      THEN("It fits in one 32 bit word.") {
+         STATIC_REQUIRE(sizeof(m) == 4);
+      }
+      WHEN("It's locked.") {
+         REQUIRE_FALSE(m.lock().has_error());
+         THEN("try_lock fails until it's unlocked.") {
+            REQUIRE_FALSE(m.try_lock());
+            REQUIRE_FALSE(m.unlock().has_error());
+            REQUIRE(m.try_lock());
+            REQUIRE_FALSE(m.unlock().has_error());
+         }
+      }
+      WHEN("Several threads increment a counter while holding it.") {
+         constexpr unsigned nthreads = 8;
+         constexpr unsigned per_thread = 20000;
+         unsigned long counter = 0;
+         ::std::vector<::std::thread> threads;
+         for (unsigned t = 0; t < nthreads; ++t) {
+            threads.emplace_back([&m, &counter]() {
+               for (unsigned i = 0; i < per_thread; ++i) {
+                  ::std::lock_guard<::posixpp::mutex> lock{m};
+                  ++counter;
+               }
+            });
+         }
+         for (auto &thread : threads) {
+            thread.join();
+         }
+         THEN("No increments were lost.") {
+            REQUIRE(counter == nthreads * per_thread);
+            REQUIRE(m.try_lock());
+            REQUIRE_FALSE(m.unlock().has_error());
+         }
+      }
+   }
+}
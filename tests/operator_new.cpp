@@ -0,0 +1,87 @@
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+// Built as its own program, linked with posixpp_new, since replacing the
+// global operator new and operator delete is for a whole program.
+
+#define CATCH_CONFIG_MAIN
+#include <posixpp/heap.h>
+#include <catch2/catch.hpp>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+namespace heap = ::posixpp::heap;
+
+namespace {
+
+//! Allocations the heap has counted for objects of `size` bytes.
+::std::uint64_t heap_allocations(::std::size_t size)
+{
+   heap::flush_thread_cache();
+   return heap::stats(heap::size_class_of(size)).allocations;
+}
+
+struct alignas(256) overaligned {
+   char bytes[256];
+};
+
+} // namespace
+
+SCENARIO("posixpp_new makes new and delete use posixpp::heap.",
+         "[operator_new]")
+{
+   GIVEN("The number of 200 byte objects the heap has allocated so far.") {
+      auto const before = heap_allocations(200);
+      WHEN("An array of 200 chars is newed and deleted.") {
+         auto *const chars = new char[200];
+         chars[0] = 'a';
+         chars[199] = 'z';
+         REQUIRE(chars[0] == 'a');
+         REQUIRE(chars[199] == 'z');
+         delete[] chars;
+         THEN("The heap allocated it.") {
+            REQUIRE(heap_allocations(200) > before);
+         }
+      }
+   }
+   GIVEN("A type that needs 256 byte alignment.") {
+      WHEN("A few of them are newed.") {
+         ::std::vector<overaligned *> objects;
+         for (int i = 0; i < 10; ++i) {
+            objects.push_back(new overaligned{});
+         }
+         THEN("Every one is properly aligned.") {
+            for (auto *obj : objects) {
+               auto const addr = reinterpret_cast<::std::uintptr_t>(obj);
+               REQUIRE(addr % alignof(overaligned) == 0);
+            }
+         }
+         for (auto *obj : objects) {
+            delete obj;
+         }
+      }
+   }
+   GIVEN("A std::vector that grows a lot.") {
+      ::std::vector<::std::uint64_t> numbers;
+      for (::std::uint64_t i = 0; i < 100000; ++i) {
+         numbers.push_back(i);
+      }
+      THEN("It holds what was put in it.") {
+         REQUIRE(numbers.size() == 100000);
+         ::std::uint64_t sum = 0;
+         for (auto n : numbers) {
+            sum += n;
+         }
+         REQUIRE(sum == 100000ULL * 99999 / 2);
+      }
+      WHEN("It's shrunk to fit a few.") {
+         numbers.resize(10);
+         numbers.shrink_to_fit();
+         THEN("The few are still there.") {
+            REQUIRE(numbers.size() == 10);
+            REQUIRE(numbers[9] == 9);
+         }
+      }
+   }
+}
@@ -0,0 +1,135 @@
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+#include <posixpp/reactor.h>
+#include <posixpp/simpleio.h>
+#include <posixpp/transfer.h>
+#include <catch2/catch.hpp>
+#include <cerrno>
+#include <functional>
+#include <string>
+
+namespace {
+
+//! Reads everything available on a pipe each time it's ready.
+class pipe_reader : public ::posixpp::event_handler {
+ public:
+   explicit pipe_reader(::posixpp::fd const &file) : file_{file} {}
+
+   void on_events(::posixpp::epollevents events) noexcept override {
+      ++calls;
+      last_events = events;
+      char buf[64];
+      for (;;) {
+         auto const result = ::posixpp::read(file_, buf, sizeof(buf));
+         if (result.has_error()) {
+            last_error = result.error();
+            break;
+         } else if (result.result() == 0) {
+            saw_eof = true;
+            break;
+         }
+         data.append(buf, result.result());
+      }
+      if (on_call) {
+         on_call();
+      }
+   }
+
+   ::posixpp::fd const &file_;
+   unsigned calls = 0;
+   ::posixpp::epollevents last_events;
+   int last_error = 0;
+   bool saw_eof = false;
+   ::std::string data;
+   ::std::function<void()> on_call;
+};
+
+} // namespace
+
+SCENARIO("A reactor dispatches readiness to handlers.", "[reactor]")
+{
+   using ::posixpp::epollevents;
+   using ::posixpp::fdflags;
+   GIVEN("A reactor and two non-blocking pipes.") {
+      auto r{::posixpp::reactor::create().result()};
+      REQUIRE(r.epoll_fd().is_valid());
+      auto p1{::posixpp::pipe(fdflags::nonblock | fdflags::cloexec).result()};
+      auto p2{::posixpp::pipe(fdflags::nonblock | fdflags::cloexec).result()};
+      pipe_reader h1{p1.read_end};
+      pipe_reader h2{p2.read_end};
+      REQUIRE_FALSE(r.add(p1.read_end, h1, epollevents::in).has_error());
+      REQUIRE_FALSE(r.add(p2.read_end, h2, epollevents::in).has_error());
+
+      WHEN("Nothing has been written.") {
+         THEN("Polling with no timeout calls nobody.") {
+            REQUIRE(r.poll(0).result() == 0);
+         }
+      }
+      WHEN("Both pipes are written to.") {
+         REQUIRE(::posixpp::write(p1.write_end, "one", 3).result() == 3);
+         REQUIRE(::posixpp::write(p2.write_end, "two", 3).result() == 3);
+         THEN("One poll calls both handlers, and they drain their pipes.") {
+            REQUIRE(r.poll(1000).result() == 2);
+            REQUIRE(h1.data == "one");
+            REQUIRE(h2.data == "two");
+            REQUIRE(h1.last_error == EAGAIN);
+            REQUIRE(h1.last_events & epollevents::in);
+            AND_THEN("Being edge triggered, there's nothing more until new data.") {
+               REQUIRE(r.poll(0).result() == 0);
+               REQUIRE(::posixpp::write(p1.write_end, "!", 1).result() == 1);
+               REQUIRE(r.poll(1000).result() == 1);
+               REQUIRE(h1.data == "one!");
+               REQUIRE(h1.calls == 2);
+               REQUIRE(h2.calls == 1);
+            }
+         }
+      }
+      WHEN("The first handler to run removes the other one.") {
+         h1.on_call = [&]() { REQUIRE_FALSE(r.remove(p2.read_end, h2).has_error()); };
+         h2.on_call = [&]() { REQUIRE_FALSE(r.remove(p1.read_end, h1).has_error()); };
+         REQUIRE(::posixpp::write(p1.write_end, "a", 1).result() == 1);
+         REQUIRE(::posixpp::write(p2.write_end, "b", 1).result() == 1);
+         THEN("Only one of them is called, even though both were ready.") {
+            REQUIRE(r.poll(1000).result() == 1);
+            REQUIRE(h1.calls + h2.calls == 1);
+         }
+      }
+      WHEN("A write end is closed.") {
+         REQUIRE_FALSE(p1.write_end.close().has_error());
+         THEN("The handler hears about the hangup.") {
+            REQUIRE(r.poll(1000).result() == 1);
+            REQUIRE(h1.saw_eof);
+            REQUIRE(h1.last_events & epollevents::hup);
+         }
+      }
+      WHEN("A handler stops the reactor while it's running.") {
+         h1.on_call = [&r]() { r.stop(); };
+         REQUIRE(::posixpp::write(p1.write_end, "x", 1).result() == 1);
+         THEN("run returns.") {
+            REQUIRE_FALSE(r.run().has_error());
+            REQUIRE(h1.calls == 1);
+         }
+      }
+   }
+   GIVEN("A reactor and a blocking pipe.") {
+      auto r{::posixpp::reactor::create().result()};
+      auto p{::posixpp::pipe().result()};
+      pipe_reader h{p.read_end};
+      THEN("The pipe can't be added.") {
+         auto const added = r.add(p.read_end, h, epollevents::in);
+         REQUIRE(added.has_error());
+         REQUIRE(added.error() == EINVAL);
+      }
+      AND_WHEN("It's switched to non-blocking.") {
+         auto const flags = p.read_end.get_status_flags().result();
+         REQUIRE_FALSE(
+              p.read_end.set_status_flags(flags | fdflags::nonblock).has_error()
+         );
+         THEN("It can be added.") {
+            REQUIRE(p.read_end.get_status_flags().result() & fdflags::nonblock);
+            REQUIRE_FALSE(r.add(p.read_end, h, epollevents::in).has_error());
+         }
+      }
+   }
+}
@@ -0,0 +1,218 @@
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+#include <posixpp/ring_queue.h>
+#include <posixpp/eventfd.h>
+#include <posixpp/reactor.h>
+#include <catch2/catch.hpp>
+#include <cerrno>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using queue_t = ::posixpp::mpsc_queue<::std::uint64_t, 256,
+                                     ::posixpp::eventfd_wakeup>;
+
+//! Pops everything it can each time the queue's eventfd is readable.
+class queue_drainer : public ::posixpp::event_handler {
+ public:
+   queue_drainer(::posixpp::reactor &r, queue_t &q, unsigned want)
+        : r_{r}, q_{q}, want_{want}
+   {}
+
+   void on_events(::posixpp::epollevents) noexcept override {
+      ++calls;
+      do {
+         ::std::uint64_t item;
+         while (q_.try_pop(item)) {
+            sum += item;
+            ++got;
+         }
+      } while (!q_.arm());
+      if (got == want_) {
+         r_.stop();
+      }
+   }
+
+   unsigned calls = 0;
+   unsigned got = 0;
+   ::std::uint64_t sum = 0;
+
+ private:
+   ::posixpp::reactor &r_;
+   queue_t &q_;
+   unsigned const want_;
+};
+
+} // namespace
+
+SCENARIO("An eventfd is a counter that can be waited on.", "[eventfd]")
+{
+   using ::posixpp::eventfdflags;
+   GIVEN("A non-blocking eventfd starting at 0.") {
+      auto efd{::posixpp::eventfd(
+           0, eventfdflags::nonblock | eventfdflags::cloexec
+      ).result()};
+      THEN("Reading it fails with EAGAIN.") {
+         auto const result = ::posixpp::eventfd_read(efd);
+         REQUIRE(result.has_error());
+         REQUIRE(result.error() == EAGAIN);
+      }
+      WHEN("3 and 4 are written to it.") {
+         REQUIRE_FALSE(::posixpp::eventfd_write(efd, 3).has_error());
+         REQUIRE_FALSE(::posixpp::eventfd_write(efd, 4).has_error());
+         THEN("One read gets 7 and the next one fails.") {
+            REQUIRE(::posixpp::eventfd_read(efd).result() == 7);
+            REQUIRE(::posixpp::eventfd_read(efd).has_error());
+         }
+      }
+   }
+   GIVEN("A semaphore eventfd starting at 2.") {
+      auto efd{::posixpp::eventfd(
+           2, eventfdflags::semaphore | eventfdflags::nonblock
+      ).result()};
+      THEN("It can be read as 1 twice.") {
+         REQUIRE(::posixpp::eventfd_read(efd).result() == 1);
+         REQUIRE(::posixpp::eventfd_read(efd).result() == 1);
+         REQUIRE(::posixpp::eventfd_read(efd).has_error());
+      }
+   }
+}
+
+SCENARIO("A posixpp::spsc_queue hands items from one thread to another.",
+         "[ring_queue]")
+{
+   GIVEN("A queue of 4 unique_ptrs.") {
+      ::posixpp::spsc_queue<::std::unique_ptr<int>, 4> q;
+      THEN("It starts empty.") {
+         ::std::unique_ptr<int> out;
+         REQUIRE(q.empty());
+         REQUIRE_FALSE(q.try_pop(out));
+      }
+      WHEN("It's filled.") {
+         for (int i = 0; i < 4; ++i) {
+            REQUIRE(q.try_push(::std::make_unique<int>(i)));
+         }
+         THEN("Another push fails and leaves its item alone.") {
+            auto extra = ::std::make_unique<int>(4);
+            REQUIRE_FALSE(q.try_push(::std::move(extra)));
+            REQUIRE(extra != nullptr);
+         }
+         THEN("They come back out in order, and there's room again.") {
+            ::std::unique_ptr<int> out;
+            for (int i = 0; i < 4; ++i) {
+               REQUIRE(q.try_pop(out));
+               REQUIRE(*out == i);
+            }
+            REQUIRE(q.empty());
+            REQUIRE(q.try_push(::std::make_unique<int>(5)));
+         }
+      }
+   }
+   GIVEN("A small queue that a consumer blocks on.") {
+      ::posixpp::spsc_queue<unsigned, 16, ::posixpp::futex_wakeup> q;
+      constexpr unsigned count = 100000;
+      WHEN("A producer thread pushes a long run of numbers.") {
+         ::std::thread producer{[&q]() {
+            for (unsigned i = 0; i < count; ++i) {
+               while (!q.try_push(i)) {
+                  ::std::this_thread::yield();
+               }
+            }
+         }};
+         bool in_order = true;
+         for (unsigned i = 0; i < count; ++i) {
+            unsigned got = count;
+            REQUIRE_FALSE(q.pop(got).has_error());
+            in_order = in_order && got == i;
+         }
+         producer.join();
+         THEN("The consumer got every one of them in order.") {
+            REQUIRE(in_order);
+            REQUIRE(q.empty());
+         }
+      }
+   }
+}
+
+SCENARIO("A posixpp::mpsc_queue collects items from several threads.",
+         "[ring_queue]")
+{
+   GIVEN("A queue a consumer blocks on, and 4 producers.") {
+      constexpr unsigned nproducers = 4;
+      constexpr unsigned each = 20000;
+      ::posixpp::mpsc_queue<::std::uint32_t, 64, ::posixpp::futex_wakeup> q;
+      WHEN("Each producer pushes its own numbered run.") {
+         ::std::vector<::std::thread> producers;
+         for (unsigned p = 0; p < nproducers; ++p) {
+            producers.emplace_back([&q, p]() {
+               for (unsigned i = 0; i < each; ++i) {
+                  while (!q.try_push((p << 24) | i)) {
+                     ::std::this_thread::yield();
+                  }
+               }
+            });
+         }
+         unsigned next[nproducers] = {};
+         bool in_order = true;
+         for (unsigned i = 0; i < nproducers * each; ++i) {
+            ::std::uint32_t got = 0;
+            REQUIRE_FALSE(q.pop(got).has_error());
+            unsigned const p = got >> 24;
+            in_order = in_order && p < nproducers
+                       && (got & 0xffffff) == next[p];
+            ++next[p % nproducers];
+         }
+         for (auto &producer : producers) {
+            producer.join();
+         }
+         THEN("Everything arrived, each producer's items in their order.") {
+            REQUIRE(in_order);
+            for (unsigned p = 0; p < nproducers; ++p) {
+               REQUIRE(next[p] == each);
+            }
+            REQUIRE(q.empty());
+         }
+      }
+   }
+   GIVEN("A queue with eventfd wakeups in a reactor.") {
+      constexpr unsigned nproducers = 3;
+      constexpr unsigned each = 10000;
+      auto r{::posixpp::reactor::create().result()};
+      queue_t q{::posixpp::eventfd_wakeup::create().result()};
+      queue_drainer drainer{r, q, nproducers * each};
+      REQUIRE(q.arm());
+      REQUIRE_FALSE(
+           r.add(q.get_wakeup().get_fd(), drainer,
+                 ::posixpp::epollevents::in).has_error()
+      );
+      THEN("Polling with nothing queued calls nobody.") {
+         REQUIRE(r.poll(0).result() == 0);
+      }
+      WHEN("Producer threads push while the reactor runs.") {
+         ::std::vector<::std::thread> producers;
+         for (unsigned p = 0; p < nproducers; ++p) {
+            producers.emplace_back([&q]() {
+               for (unsigned i = 1; i <= each; ++i) {
+                  while (!q.try_push(::std::uint64_t{i})) {
+                     ::std::this_thread::yield();
+                  }
+               }
+            });
+         }
+         REQUIRE_FALSE(r.run().has_error());
+         for (auto &producer : producers) {
+            producer.join();
+         }
+         THEN("The handler drained all of it.") {
+            REQUIRE(drainer.got == nproducers * each);
+            REQUIRE(drainer.sum == nproducers * (each * (each + 1ULL) / 2));
+            REQUIRE(drainer.calls >= 1);
+            REQUIRE(q.empty());
+         }
+      }
+   }
+}
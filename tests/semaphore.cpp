@@ -0,0 +1,71 @@
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+#include <posixpp/semaphore.h>
+#include <posixpp/clock.h>
+#include <catch2/catch.hpp>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+SCENARIO("A posixpp::counting_semaphore limits how many threads get in.",
+         "[semaphore]")
+{
+   GIVEN("A semaphore with a count of 3.") {
+      ::posixpp::counting_semaphore<> slots{3};
+      THEN("It fits in one 32 bit word.") {
+         STATIC_REQUIRE(sizeof(slots) == 4);
+      }
+      THEN("try_acquire succeeds 3 times, then fails until a release.") {
+         REQUIRE(slots.try_acquire());
+         REQUIRE(slots.try_acquire());
+         REQUIRE(slots.try_acquire());
+         REQUIRE_FALSE(slots.try_acquire());
+         REQUIRE_FALSE(slots.release().has_error());
+         REQUIRE(slots.try_acquire());
+      }
+      WHEN("8 threads repeatedly take a slot.") {
+         constexpr unsigned nthreads = 8;
+         ::std::atomic<unsigned> inside = 0;
+         ::std::atomic<unsigned> most = 0;
+         ::std::vector<::std::thread> threads;
+         for (unsigned t = 0; t < nthreads; ++t) {
+            threads.emplace_back([&]() {
+               for (unsigned i = 0; i < 5000; ++i) {
+                  static_cast<void>(slots.acquire());
+                  unsigned const now = inside.fetch_add(1) + 1;
+                  unsigned seen = most.load();
+                  while (now > seen && !most.compare_exchange_weak(seen, now))
+                  {}
+                  inside.fetch_sub(1);
+                  static_cast<void>(slots.release());
+               }
+            });
+         }
+         for (auto &thread : threads) {
+            thread.join();
+         }
+         THEN("There were never more than 3 in at once.") {
+            REQUIRE(most.load() <= 3);
+            REQUIRE(slots.try_acquire());
+            REQUIRE(slots.try_acquire());
+            REQUIRE(slots.try_acquire());
+            REQUIRE_FALSE(slots.try_acquire());
+         }
+      }
+   }
+   GIVEN("An empty binary semaphore.") {
+      ::posixpp::binary_semaphore empty{0};
+      THEN("A timed acquire gives up with ETIMEDOUT.") {
+         auto deadline = ::posixpp::clock_gettime(
+              ::posixpp::clockid::monotonic
+         ).result();
+         deadline.tv_nsec += 10'000'000;
+         deadline.tv_sec += deadline.tv_nsec / 1'000'000'000;
+         deadline.tv_nsec %= 1'000'000'000;
+         auto const result = empty.try_acquire_until(deadline);
+         REQUIRE(result.has_error());
+         REQUIRE(result.error() == static_cast<int>(::std::errc::timed_out));
+      }
+   }
+}
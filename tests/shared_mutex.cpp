@@ -0,0 +1,91 @@
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+#include <posixpp/shared_mutex.h>
+#include <catch2/catch.hpp>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+SCENARIO("A posixpp::shared_mutex lets in many readers or one writer.",
+         "[shared_mutex]")
+{
+   GIVEN("An unlocked shared_mutex.") {
+      ::posixpp::shared_mutex m;
+      THEN("It fits in one 32 bit word.") {
+         STATIC_REQUIRE(sizeof(m) == 4);
+      }
+      WHEN("Two readers have it.") {
+         REQUIRE_FALSE(m.lock_shared().has_error());
+         REQUIRE(m.try_lock_shared());
+         THEN("A writer can't get it until they've both left.") {
+            REQUIRE_FALSE(m.try_lock());
+            REQUIRE_FALSE(m.unlock_shared().has_error());
+            REQUIRE_FALSE(m.try_lock());
+            REQUIRE_FALSE(m.unlock_shared().has_error());
+            REQUIRE(m.try_lock());
+            AND_THEN("Then no reader can get it.") {
+               REQUIRE_FALSE(m.try_lock_shared());
+               REQUIRE_FALSE(m.unlock().has_error());
+               REQUIRE(m.try_lock_shared());
+               REQUIRE_FALSE(m.unlock_shared().has_error());
+            }
+         }
+      }
+      WHEN("A reader has it and a writer is waiting.") {
+         REQUIRE_FALSE(m.lock_shared().has_error());
+         ::std::atomic<bool> wrote = false;
+         ::std::thread writer{[&]() {
+            ::std::lock_guard<::posixpp::shared_mutex> lock{m};
+            wrote.store(true);
+         }};
+         // Wait for the writer to register, at which point new readers are
+         // held off.
+         while (m.try_lock_shared()) {
+            REQUIRE_FALSE(m.unlock_shared().has_error());
+            ::std::this_thread::yield();
+         }
+         THEN("The writer gets in as soon as the reader leaves.") {
+            REQUIRE_FALSE(wrote.load());
+            REQUIRE_FALSE(m.unlock_shared().has_error());
+            writer.join();
+            REQUIRE(wrote.load());
+         }
+      }
+      WHEN("Readers and writers hammer on it.") {
+         constexpr unsigned nthreads = 8;
+         constexpr unsigned per_thread = 10000;
+         unsigned long a = 0, b = 0;
+         ::std::atomic<unsigned> torn = 0;
+         ::std::vector<::std::thread> threads;
+         for (unsigned t = 0; t < nthreads; ++t) {
+            threads.emplace_back([&, t]() {
+               for (unsigned i = 0; i < per_thread; ++i) {
+                  if ((i + t) % 8 == 0) {
+                     ::std::lock_guard<::posixpp::shared_mutex> lock{m};
+                     ++a;
+                     ++b;
+                  } else {
+                     ::std::shared_lock<::posixpp::shared_mutex> lock{m};
+                     if (a != b) {
+                        torn.fetch_add(1);
+                     }
+                  }
+               }
+            });
+         }
+         for (auto &thread : threads) {
+            thread.join();
+         }
+         THEN("Readers never saw a half done write, and no write was lost.") {
+            REQUIRE(torn.load() == 0);
+            REQUIRE(a == nthreads * per_thread / 8);
+            REQUIRE(b == a);
+            REQUIRE(m.try_lock());
+            REQUIRE_FALSE(m.unlock().has_error());
+         }
+      }
+   }
+}
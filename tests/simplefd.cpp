@@ -2,6 +2,8 @@
 #include <posixpp/expected.h>
 #include <posixpp/simpleio.h>
 #include <unistd.h>
+#include <cerrno>
+#include <string_view>
 #include "tempdir.h"
 #define CATCH_CONFIG_MAIN
 #include <catch2/catch.hpp>
@@ -116,6 +118,16 @@ SCENARIO(
             }
          }
       }
+      WHEN("foo.dup_to_unused(100) is called.") {
+         fd bar{ foo.dup_to_unused(100).result() };
+         THEN("The new file descriptor is at least 100 and shares the position.") {
+            REQUIRE(bar.as_fd() >= 100);
+            char buf[1];
+            REQUIRE(read(bar, buf, 1).result() == 1);
+            REQUIRE(read(foo, buf, 1).result() == 1);
+            REQUIRE(buf[0] == known_text[1]);
+         }
+      }
       WHEN("foo.dup2(foo) is called.") {
          REQUIRE_NOTHROW(foo.dup2(foo).throw_if_error());
          THEN("foo is still valid") {
@@ -171,3 +183,91 @@ SCENARIO(
       }
    }
 }
+
+SCENARIO("Positional and scatter/gather I/O work on file descriptors.",
+         "posixpp::fd")
+{
+   GIVEN("A file opened for reading and writing in a temporary directory.") {
+      tempdir testdir;
+      auto fooname = testdir.get_name() / "foo";
+      using of = ::posixpp::openflags;
+      using fdf = ::posixpp::fdflags;
+      using ::posixpp::modeflags;
+      using ::posixpp::rwflags;
+      using ::posixpp::iovec;
+      using ::posixpp::const_iovec;
+      auto foo{
+           ::posixpp::open(fooname.native().c_str(),
+                           of::creat | fdf::rdwr,
+                           modeflags::irwall).result()
+      };
+      static const char known_text[] = "0123456789abcdef";
+      REQUIRE(::posixpp::write(foo, known_text, 16).result() == 16);
+
+      WHEN("Data is read with pread at an offset.") {
+         char buf[4] = {};
+         REQUIRE(::posixpp::pread(foo, buf, sizeof(buf), 10).result() == 4);
+         THEN("It comes from that offset, and the file position is unchanged.") {
+            REQUIRE(::std::string_view(buf, 4) == "abcd");
+            char rest[1];
+            REQUIRE(::posixpp::read(foo, rest, 1).result() == 0);
+         }
+      }
+      WHEN("Data is written with pwrite at an offset.") {
+         REQUIRE(::posixpp::pwrite(foo, "XY", 2, 3).result() == 2);
+         THEN("Only those bytes change.") {
+            char buf[16];
+            REQUIRE(::posixpp::pread(foo, buf, 16, 0).result() == 16);
+            REQUIRE(::std::string_view(buf, 16) == "012XY56789abcdef");
+         }
+      }
+      WHEN("Two pieces are written with one writev.") {
+         const_iovec const iov[] = {{"-head-", 6}, {"-tail-", 6}};
+         REQUIRE(::posixpp::writev(foo, iov).result() == 12);
+         AND_WHEN("They're read back at an offset into two buffers.") {
+            char first[8], second[10];
+            iovec const riov[] = {{first, sizeof(first)},
+                                  {second, sizeof(second)}};
+            REQUIRE(::posixpp::preadv2(foo, riov, 14).result() == 14);
+            THEN("The data is scattered across both buffers in order.") {
+               REQUIRE(::std::string_view(first, 8) == "ef-head-");
+               REQUIRE(::std::string_view(second, 6) == "-tail-");
+            }
+         }
+      }
+      WHEN("A page cache read is tried with nowait.") {
+         char buf[16];
+         iovec const riov[] = {{buf, sizeof(buf)}};
+         auto const result = ::posixpp::preadv2(foo, riov, 0, rwflags::nowait);
+         THEN("It either reads the data or would have blocked.") {
+            if (result.has_error()) {
+               REQUIRE(result.error() == EAGAIN);
+            } else {
+               REQUIRE(result.result() == 16);
+               REQUIRE(::std::string_view(buf, 16) == known_text);
+            }
+         }
+      }
+      WHEN("pwritev2 is used with an offset of -1 and dsync.") {
+         const_iovec const iov[] = {{"!", 1}};
+         REQUIRE(::posixpp::pwritev2(foo, iov, -1, rwflags::dsync).result() == 1);
+         THEN("It writes at the file position.") {
+            char buf[17];
+            REQUIRE(::posixpp::pread(foo, buf, 17, 0).result() == 17);
+            REQUIRE(buf[16] == '!');
+         }
+      }
+      WHEN("readv is used after rewinding with a fresh descriptor.") {
+         auto again{
+              ::posixpp::open(fooname.native().c_str(), fdf::rdonly).result()
+         };
+         char a[5], b[5];
+         iovec const riov[] = {{a, 5}, {b, 5}};
+         REQUIRE(::posixpp::readv(again, riov).result() == 10);
+         THEN("Both buffers are filled from the start of the file.") {
+            REQUIRE(::std::string_view(a, 5) == "01234");
+            REQUIRE(::std::string_view(b, 5) == "56789");
+         }
+      }
+   }
+}
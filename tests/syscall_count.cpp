@@ -0,0 +1,110 @@
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+// How many system calls things make is as much a part of their contract as
+// what they do, so these check the exact sequence.
+
+#include <posixpp/buffered_writer.h>
+#include <posixpp/fd.h>
+#include <posixpp/simpleio.h>
+#include <posixpp/thread.h>
+#include <posixpp/auxv.h>
+#include <posixpp/transfer.h>
+#include "syscall_trace.h"
+#include <catch2/catch.hpp>
+#include <algorithm>
+#include <vector>
+
+using ::syscalls::linux::call_id;
+using call_ids = ::std::vector<call_id>;
+
+extern "C" char **environ;
+
+SCENARIO("The tracer sees exactly the system calls made.", "[syscall_count]")
+{
+   GIVEN("A function that makes no system calls.") {
+      THEN("Nothing is traced.") {
+         REQUIRE(traced_syscall_ids([] {}).empty());
+      }
+   }
+   GIVEN("/dev/null open for reading.") {
+      auto const devnull{
+           ::posixpp::open("/dev/null", ::posixpp::fdflags::rdonly).result()
+      };
+      THEN("A read is one read system call, with its result.") {
+         auto const calls = trace_syscalls([&devnull] {
+            char buf[16];
+            (void)::posixpp::read(devnull, buf, sizeof(buf));
+         });
+         REQUIRE(calls == ::std::vector<traced_syscall>{{call_id::read, 0}});
+      }
+   }
+}
+
+SCENARIO("fd operations make one system call each.", "[syscall_count]")
+{
+   GIVEN("Two open file descriptors.") {
+      auto const devnull{
+           ::posixpp::open("/dev/null", ::posixpp::fdflags::rdonly).result()
+      };
+      auto other{devnull.dup().result()};
+      THEN("dup2 with cloexec is one dup3, and no fcntl.") {
+         auto const ids = traced_syscall_ids([&devnull, &other] {
+            (void)devnull.dup2(other, true);
+         });
+         REQUIRE(ids == call_ids{call_id::dup3});
+      }
+      THEN("dup2 without cloexec is one dup2.") {
+         auto const ids = traced_syscall_ids([&devnull, &other] {
+            (void)devnull.dup2(other);
+         });
+         REQUIRE(ids == call_ids{call_id::dup2});
+      }
+      THEN("Destroying an fd is one close.") {
+         auto const ids = traced_syscall_ids([&other] {
+            ::posixpp::fd gone{::std::move(other)};
+         });
+         REQUIRE(ids == call_ids{call_id::close});
+      }
+   }
+}
+
+SCENARIO("A buffered_writer flush is one writev.", "[syscall_count]")
+{
+   GIVEN("A buffered writer on a pipe with some pieces added.") {
+      auto p{::posixpp::pipe().result()};
+      auto writer{::posixpp::buffered_writer::create(p.write_end).result()};
+      static char const big[32 * 1024] = {};
+      THEN("Writing pieces makes no system calls, and flushing makes one.") {
+         auto const ids = traced_syscall_ids([&writer] {
+            (void)writer.write("Hello ");
+            (void)writer.write_ref("world");
+            (void)writer.write("!\n");
+            (void)writer.write_ref(big, sizeof(big));
+            (void)writer.flush();
+         });
+         REQUIRE(ids == call_ids{call_id::writev});
+      }
+   }
+}
+
+SCENARIO("Starting a thread on a cached stack is one clone3.", "[syscall_count]")
+{
+   ::posixpp::init_auxv(environ);
+   GIVEN("A stack pool that has already run a thread.") {
+      ::posixpp::stack_pool pool;
+      {
+         auto warm{::posixpp::thread::create([]() noexcept {}, pool).result()};
+      }
+      THEN("Starting another makes clone3 and nothing else before it.") {
+         auto const ids = traced_syscall_ids([&pool] {
+            auto t{::posixpp::thread::create([]() noexcept {}, pool).result()};
+            static_cast<void>(t.join());
+         });
+         REQUIRE_FALSE(ids.empty());
+         REQUIRE(ids.front() == call_id::clone3);
+         REQUIRE(::std::count(ids.begin(), ids.end(), call_id::arch_prctl)
+                 == 0);
+      }
+   }
+}
@@ -0,0 +1,73 @@
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+// Built as its own program, with POSIXPP_SYSCALL_STATS defined, since the
+// macro has to be the same for every file in a program.
+
+#define CATCH_CONFIG_MAIN
+#include <posixpp/syscall_stats.h>
+#include <posixpp/simpleio.h>
+#include <posixpp/transfer.h>
+#include <catch2/catch.hpp>
+#include <cerrno>
+#include <cstdint>
+#include <string>
+
+static_assert(::posixpp::syscall_stats::enabled,
+              "This test must be built with POSIXPP_SYSCALL_STATS defined.");
+
+SCENARIO("System calls are counted.", "[syscall_stats]")
+{
+   namespace stats = ::posixpp::syscall_stats;
+   using ::syscalls::linux::call_id;
+   GIVEN("/dev/null, an invalid fd, and counters that start at zero.") {
+      auto const devnull{
+           ::posixpp::open("/dev/null", ::posixpp::fdflags::rdonly).result()
+      };
+      ::posixpp::fd const invalid;
+      stats::reset();
+      WHEN("There are 5 good reads and 2 that fail with EBADF.") {
+         char buf[16];
+         for (int i = 0; i < 5; ++i) {
+            REQUIRE(::posixpp::read(devnull, buf, sizeof(buf)).result() == 0);
+         }
+         for (int i = 0; i < 2; ++i) {
+            REQUIRE(::posixpp::read(invalid, buf, sizeof(buf)).error() == EBADF);
+         }
+         auto const counts = stats::snapshot(call_id::read);
+         THEN("All 7 reads, and the 2 errors, are counted.") {
+            REQUIRE(counts.calls == 7);
+            REQUIRE(counts.errors == 2);
+            REQUIRE(counts.errno_counts[EBADF] == 2);
+            ::std::uint64_t histogram_total = 0;
+            for (auto const n : counts.latency) {
+               histogram_total += n;
+            }
+            REQUIRE(histogram_total == 7);
+         }
+         AND_WHEN("The counters are taken with a reset.") {
+            (void)stats::snapshot(call_id::read, true);
+            THEN("They start over at zero.") {
+               REQUIRE(stats::snapshot(call_id::read).calls == 0);
+            }
+         }
+         AND_WHEN("The counters are dumped to a pipe.") {
+            auto p{::posixpp::pipe().result()};
+            REQUIRE_FALSE(stats::dump(p.write_end).has_error());
+            REQUIRE_FALSE(p.write_end.close().has_error());
+            ::std::string text;
+            char chunk[4096];
+            for (::std::size_t n;
+                 (n = ::posixpp::read(p.read_end, chunk, sizeof(chunk))
+                           .result()) > 0; )
+            {
+               text.append(chunk, n);
+            }
+            THEN("The line for read has the counts.") {
+               REQUIRE(text.starts_with("0 calls=7 errors=2 errno.9=2 "));
+               REQUIRE(text.find(" cycles.lt.2**") != ::std::string::npos);
+            }
+         }
+      }
+   }
+}
@@ -0,0 +1,133 @@
+#pragma once  // -*- c++ -*-
+
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+#include <syscalls/linux/syscall.h>
+#include <sys/ptrace.h>
+#include <sys/types.h>
+#include <sys/user.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+//! One system call seen by `trace_syscalls`.
+struct traced_syscall {
+   ::syscalls::linux::call_id id;
+   //! What the system call returned, negative errno values for errors.
+   ::std::int64_t result;
+
+   bool operator ==(traced_syscall const &) const = default;
+};
+
+/**
+ * \brief Run `func` in a child process and return every system call it made,
+ * in order.
+ *
+ * The child is traced with `PTRACE_SYSCALL`. It stops itself before calling
+ * `func` and exits right after it, so only what `func` does is reported.
+ * Since it's a separate process, `func` should only do the work being
+ * measured and not use Catch's assertions, and anything it changes in memory
+ * is lost. Throws if `func` throws or if the tracing fails.
+ */
+inline ::std::vector<traced_syscall>
+trace_syscalls(::std::function<void()> const &func)
+{
+   auto check = [](long result, char const *what) {
+      if (result < 0) {
+         throw ::std::system_error(errno, ::std::system_category(), what);
+      }
+      return result;
+   };
+   ::pid_t const child = ::fork();
+   check(child, "fork");
+   if (child == 0) {
+      if (::ptrace(PTRACE_TRACEME, 0, nullptr, nullptr) < 0) {
+         ::_exit(2);
+      }
+      ::raise(SIGSTOP);
+      try {
+         func();
+      } catch (...) {
+         ::_exit(1);
+      }
+      ::_exit(0);
+   }
+
+   int status;
+   check(::waitpid(child, &status, 0), "waitpid");
+   if (!WIFSTOPPED(status) || WSTOPSIG(status) != SIGSTOP) {
+      throw ::std::runtime_error("traced child didn't stop itself");
+   }
+   check(::ptrace(PTRACE_SETOPTIONS, child, nullptr,
+                  PTRACE_O_TRACESYSGOOD | PTRACE_O_EXITKILL),
+         "ptrace(PTRACE_SETOPTIONS)");
+
+   ::std::vector<traced_syscall> calls;
+   bool entering = true;
+   int deliver = 0;
+   for (;;) {
+      check(::ptrace(PTRACE_SYSCALL, child, nullptr, deliver),
+            "ptrace(PTRACE_SYSCALL)");
+      deliver = 0;
+      check(::waitpid(child, &status, 0), "waitpid");
+      if (WIFEXITED(status) || WIFSIGNALED(status)) {
+         break;
+      } else if (WSTOPSIG(status) != (SIGTRAP | 0x80)) {
+         // A signal for the child, pass it along.
+         deliver = WSTOPSIG(status);
+         continue;
+      }
+      ::user_regs_struct regs;
+      check(::ptrace(PTRACE_GETREGS, child, nullptr, &regs),
+            "ptrace(PTRACE_GETREGS)");
+      if (entering) {
+         using id_t = ::std::underlying_type_t<::syscalls::linux::call_id>;
+         calls.push_back({
+              static_cast<::syscalls::linux::call_id>(
+                   static_cast<id_t>(regs.orig_rax)
+              ),
+              0
+         });
+      } else {
+         calls.back().result = static_cast<::std::int64_t>(regs.rax);
+      }
+      entering = !entering;
+   }
+   if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      throw ::std::runtime_error("traced function failed");
+   }
+   // The last one is the exit_group from _exit.
+   if (!calls.empty()
+       && calls.back().id == ::syscalls::linux::call_id::exit_group)
+   {
+      calls.pop_back();
+   }
+   return calls;
+}
+
+//! Just the system call numbers from a trace.
+inline ::std::vector<::syscalls::linux::call_id>
+syscall_ids(::std::vector<traced_syscall> const &calls)
+{
+   ::std::vector<::syscalls::linux::call_id> ids;
+   ids.reserve(calls.size());
+   for (auto const &call : calls) {
+      ids.push_back(call.id);
+   }
+   return ids;
+}
+
+//! Run `func` and return the numbers of the system calls it made, in order.
+inline ::std::vector<::syscalls::linux::call_id>
+traced_syscall_ids(::std::function<void()> const &func)
+{
+   return syscall_ids(trace_syscalls(func));
+}
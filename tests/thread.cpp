@@ -0,0 +1,96 @@
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+#include <posixpp/thread.h>
+#include <posixpp/auxv.h>
+#include <catch2/catch.hpp>
+#include <atomic>
+#include <utility>
+
+extern "C" char **environ;
+
+namespace {
+thread_local int tls_counter = 42;
+}
+
+SCENARIO("A posixpp::thread runs a function and can be joined.", "[thread]")
+{
+   ::posixpp::init_auxv(environ);
+   GIVEN("A stack pool.") {
+      ::posixpp::stack_pool pool{64 * 1024, 2};
+      WHEN("A thread is started and joined.") {
+         ::std::atomic<int> ran = 0;
+         auto thr = ::posixpp::thread::create([&ran]() noexcept {
+            ran.fetch_add(1);
+         }, pool);
+         REQUIRE_FALSE(thr.has_error());
+         auto t = ::std::move(thr).result();
+         REQUIRE(t.joinable());
+         REQUIRE_FALSE(t.join().has_error());
+         THEN("The function ran exactly once, and the stack was cached.") {
+            REQUIRE(ran.load() == 1);
+            REQUIRE_FALSE(t.joinable());
+            REQUIRE(pool.cached() == 1);
+         }
+         THEN("The next thread reuses the stack.") {
+            auto second = ::posixpp::thread::create([&ran]() noexcept {
+               ran.fetch_add(1);
+            }, pool);
+            REQUIRE_FALSE(second.has_error());
+            REQUIRE(pool.cached() == 0);
+            REQUIRE_FALSE(second.result().join().has_error());
+            REQUIRE(ran.load() == 2);
+            REQUIRE(pool.cached() == 1);
+         }
+      }
+      WHEN("More threads finish than the pool will cache.") {
+         {
+            auto a = ::posixpp::thread::create([]() noexcept {}, pool);
+            auto b = ::posixpp::thread::create([]() noexcept {}, pool);
+            auto c = ::posixpp::thread::create([]() noexcept {}, pool);
+            REQUIRE_FALSE(a.has_error());
+            REQUIRE_FALSE(b.has_error());
+            REQUIRE_FALSE(c.has_error());
+         }
+         THEN("The extra stacks are unmapped.") {
+            REQUIRE(pool.cached() == 2);
+            pool.trim();
+            REQUIRE(pool.cached() == 0);
+         }
+      }
+      WHEN("A thread is moved before it's joined.") {
+         ::std::atomic<int> ran = 0;
+         auto thr = ::posixpp::thread::create([&ran]() noexcept {
+            ran.store(1);
+         }, pool);
+         REQUIRE_FALSE(thr.has_error());
+         ::posixpp::thread moved{::std::move(thr).result()};
+         THEN("The moved to thread owns it.") {
+            REQUIRE(moved.joinable());
+            REQUIRE_FALSE(moved.join().has_error());
+            REQUIRE(ran.load() == 1);
+         }
+      }
+      WHEN("Threads use a thread_local variable.") {
+         int seen[2] = {0, 0};
+         {
+            auto a = ::posixpp::thread::create([&seen]() noexcept {
+               seen[0] = tls_counter;
+               tls_counter = 7;
+            }, pool);
+            auto b = ::posixpp::thread::create([&seen]() noexcept {
+               seen[1] = tls_counter;
+               tls_counter = 9;
+            }, pool);
+            REQUIRE_FALSE(a.has_error());
+            REQUIRE_FALSE(b.has_error());
+         }
+         THEN("Each sees its own initialized copy.") {
+            REQUIRE(seen[0] == 42);
+            REQUIRE(seen[1] == 42);
+            REQUIRE(tls_counter == 42);
+         }
+      }
+      pool.trim();
+   }
+}
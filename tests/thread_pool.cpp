@@ -0,0 +1,137 @@
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+#include <posixpp/thread_pool.h>
+#include <posixpp/auxv.h>
+#include <catch2/catch.hpp>
+#include <atomic>
+#include <utility>
+
+extern "C" char **environ;
+
+namespace {
+
+long fib(long n)
+{
+   if (n < 2) {
+      return n;
+   }
+   long x, y;
+   ::posixpp::thread_pool::fork_join([&x, n] { x = fib(n - 1); },
+                                     [&y, n] { y = fib(n - 2); });
+   return x + y;
+}
+
+} // namespace
+
+SCENARIO("A thread pool runs submitted jobs.", "[thread_pool]")
+{
+   ::posixpp::init_auxv(environ);
+   GIVEN("A pool with 4 workers.") {
+      auto pool{::posixpp::thread_pool::create(4).result()};
+      REQUIRE(pool.size() == 4);
+      WHEN("Lots of jobs are submitted and waited for.") {
+         ::std::atomic<int> ran = 0;
+         for (int i = 0; i < 10000; ++i) {
+            REQUIRE_FALSE(pool.submit([&ran]() noexcept {
+               ran.fetch_add(1, ::std::memory_order_relaxed);
+            }).has_error());
+         }
+         REQUIRE_FALSE(pool.wait().has_error());
+         THEN("Every one ran exactly once.") {
+            REQUIRE(ran.load() == 10000);
+         }
+      }
+      WHEN("Jobs submit more jobs.") {
+         ::std::atomic<int> ran = 0;
+         for (int i = 0; i < 100; ++i) {
+            REQUIRE_FALSE(pool.submit([&pool, &ran]() noexcept {
+               for (int j = 0; j < 100; ++j) {
+                  static_cast<void>(pool.submit([&ran]() noexcept {
+                     ran.fetch_add(1, ::std::memory_order_relaxed);
+                  }));
+               }
+            }).has_error());
+         }
+         REQUIRE_FALSE(pool.wait().has_error());
+         THEN("Waiting waits for those too.") {
+            REQUIRE(ran.load() == 10000);
+         }
+      }
+      WHEN("A recursive fork-join computation is submitted.") {
+         long result = 0;
+         REQUIRE_FALSE(pool.submit([&result]() noexcept {
+            result = fib(25);
+         }).has_error());
+         REQUIRE_FALSE(pool.wait().has_error());
+         THEN("It gets the right answer.") {
+            REQUIRE(result == 75025);
+         }
+      }
+      WHEN("The pool is destroyed with jobs still queued.") {
+         ::std::atomic<int> ran = 0;
+         {
+            auto doomed = ::std::move(pool);
+            for (int i = 0; i < 1000; ++i) {
+               static_cast<void>(doomed.submit([&ran]() noexcept {
+                  ran.fetch_add(1, ::std::memory_order_relaxed);
+               }));
+            }
+         }
+         THEN("They all still ran.") {
+            REQUIRE(ran.load() == 1000);
+         }
+      }
+   }
+   GIVEN("A pool with 1 worker.") {
+      auto pool{::posixpp::thread_pool::create(1).result()};
+      WHEN("The first half of a fork_join submits a job.") {
+         ::std::atomic<int> ran = 0;
+         REQUIRE_FALSE(pool.submit([&pool, &ran]() noexcept {
+            ::posixpp::thread_pool::fork_join(
+                 [&pool, &ran] {
+                    static_cast<void>(pool.submit([&ran]() noexcept {
+                       ran.fetch_add(1, ::std::memory_order_relaxed);
+                    }));
+                 },
+                 [&ran] { ran.fetch_add(10, ::std::memory_order_relaxed); }
+            );
+         }).has_error());
+         REQUIRE_FALSE(pool.wait().has_error());
+         THEN("The job it left on the deque still runs.") {
+            REQUIRE(ran.load() == 11);
+         }
+      }
+      WHEN("Nested fork_joins also submit jobs.") {
+         ::std::atomic<int> ran = 0;
+         REQUIRE_FALSE(pool.submit([&pool, &ran]() noexcept {
+            auto leaf = [&pool, &ran] {
+               static_cast<void>(pool.submit([&ran]() noexcept {
+                  ran.fetch_add(1, ::std::memory_order_relaxed);
+               }));
+               ::posixpp::thread_pool::fork_join(
+                    [&ran] { ran.fetch_add(1, ::std::memory_order_relaxed); },
+                    [&ran] { ran.fetch_add(1, ::std::memory_order_relaxed); }
+               );
+            };
+            ::posixpp::thread_pool::fork_join(leaf, leaf);
+         }).has_error());
+         REQUIRE_FALSE(pool.wait().has_error());
+         THEN("Everything ran exactly once.") {
+            REQUIRE(ran.load() == 6);
+         }
+      }
+   }
+   GIVEN("No pool at all.") {
+      THEN("fork_join just calls both functions.") {
+         REQUIRE(fib(15) == 610);
+      }
+   }
+   GIVEN("A request for no workers.") {
+      auto pool = ::posixpp::thread_pool::create(0);
+      THEN("It fails with EINVAL.") {
+         REQUIRE(pool.has_error());
+         REQUIRE(pool.error() == static_cast<int>(::std::errc::invalid_argument));
+      }
+   }
+}
@@ -0,0 +1,230 @@
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+#include <posixpp/timer_wheel.h>
+#include <posixpp/clock.h>
+#include <posixpp/timerfd.h>
+#include <posixpp/reactor.h>
+#include <catch2/catch.hpp>
+#include <cerrno>
+#include <cstdint>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+
+//! Remembers when it went off, and whether that was on time.
+class recording_timer final : public ::posixpp::timer {
+ public:
+   void on_expire() noexcept override {
+      ++fired;
+      fired_at = wheel->now();
+      on_time = on_time && fired_at == deadline();
+      if (repeat > 0) {
+         --repeat;
+         static_cast<void>(wheel->schedule(*this, period));
+      }
+      if (stop != nullptr) {
+         stop->stop();
+      }
+   }
+
+   ::posixpp::timer_wheel *wheel = nullptr;
+   unsigned fired = 0;
+   ::std::uint64_t fired_at = 0;
+   bool on_time = true;
+   unsigned repeat = 0;
+   ::std::uint64_t period = 0;
+   ::posixpp::reactor *stop = nullptr;
+};
+
+} // namespace
+
+SCENARIO("A timerfd goes off at the time it's set for.", "[timerfd]")
+{
+   using ::posixpp::timerfdflags;
+   GIVEN("A non-blocking timerfd that hasn't been set.") {
+      auto tfd{::posixpp::timerfd_create(
+           ::posixpp::clockid::monotonic,
+           timerfdflags::nonblock | timerfdflags::cloexec
+      ).result()};
+      THEN("It isn't armed, and reading it fails with EAGAIN.") {
+         auto const curr = ::posixpp::timerfd_gettime(tfd).result();
+         REQUIRE(curr.it_value.tv_sec == 0);
+         REQUIRE(curr.it_value.tv_nsec == 0);
+         auto const result = ::posixpp::timerfd_read(tfd);
+         REQUIRE(result.has_error());
+         REQUIRE(result.error() == EAGAIN);
+      }
+      WHEN("It's set for an hour from now.") {
+         ::posixpp::itimerspec when{};
+         when.it_value.tv_sec = 3600;
+         auto const old = ::posixpp::timerfd_settime(tfd, when).result();
+         THEN("It was disarmed before, and is now armed for most of an hour.") {
+            REQUIRE(old.it_value.tv_sec == 0);
+            REQUIRE(old.it_value.tv_nsec == 0);
+            REQUIRE(::posixpp::timerfd_gettime(tfd).result().it_value.tv_sec
+                    > 3500);
+         }
+      }
+   }
+   GIVEN("A blocking timerfd set for a millisecond from now.") {
+      auto tfd{::posixpp::timerfd_create(::posixpp::clockid::monotonic,
+                                         timerfdflags::cloexec).result()};
+      ::posixpp::itimerspec when{};
+      when.it_value.tv_nsec = 1'000'000;
+      REQUIRE_FALSE(::posixpp::timerfd_settime(tfd, when).has_error());
+      THEN("Reading it waits for it to go off once.") {
+         REQUIRE(::posixpp::timerfd_read(tfd).result() == 1);
+      }
+   }
+}
+
+SCENARIO("A posixpp::timer_wheel fires timers at their deadlines.",
+         "[timer_wheel]")
+{
+   GIVEN("A wheel with 1s ticks that's advanced by hand.") {
+      // Long ticks, so the clock doesn't get past tick 0 during the test.
+      auto wheel{::posixpp::timer_wheel::create(1'000'000'000).result()};
+      REQUIRE(wheel.now() == 0);
+      REQUIRE(wheel.size() == 0);
+      THEN("A timeout of 0 ticks is made 1, and the one before is moved.") {
+         recording_timer t;
+         t.wheel = &wheel;
+         REQUIRE_FALSE(wheel.schedule(t, 50).has_error());
+         REQUIRE_FALSE(wheel.schedule(t, 0).has_error());
+         REQUIRE(wheel.size() == 1);
+         REQUIRE(t.deadline() == 1);
+         REQUIRE(wheel.advance(100) == 1);
+         REQUIRE(t.fired == 1);
+         REQUIRE(t.fired_at == 1);
+         REQUIRE_FALSE(t.is_scheduled());
+      }
+      WHEN("Lots of timers are scheduled across every level, and a third "
+           "are cancelled.")
+      {
+         constexpr unsigned count = 20000;
+         ::std::vector<::std::unique_ptr<recording_timer>> timers;
+         ::std::mt19937_64 rng{12345};
+         for (unsigned i = 0; i < count; ++i) {
+            timers.push_back(::std::make_unique<recording_timer>());
+            timers.back()->wheel = &wheel;
+            // Spread out over powers of 2 to get some on every level.
+            ::std::uint64_t const span = ::std::uint64_t{1} << (rng() % 33);
+            REQUIRE_FALSE(
+                 wheel.schedule(*timers.back(), 1 + rng() % span).has_error()
+            );
+         }
+         for (unsigned i = 0; i < count; i += 3) {
+            timers[i]->cancel();
+         }
+         REQUIRE(wheel.size() == count - (count + 2) / 3);
+         AND_WHEN("The wheel is advanced in uneven steps past them all.") {
+            ::std::uint64_t const end = ::std::uint64_t{1} << 33;
+            unsigned fired = 0;
+            while (wheel.now() < end) {
+               ::std::uint64_t const step = 1 + rng() % (wheel.now() + 1000);
+               fired += wheel.advance(wheel.now() + step);
+            }
+            THEN("Each one still scheduled fired once, right on time.") {
+               REQUIRE(fired == count - (count + 2) / 3);
+               REQUIRE(wheel.size() == 0);
+               bool all_right = true;
+               for (unsigned i = 0; i < count; ++i) {
+                  auto const &t = *timers[i];
+                  all_right = all_right
+                              && t.fired == (i % 3 == 0 ? 0U : 1U)
+                              && t.on_time;
+               }
+               REQUIRE(all_right);
+            }
+         }
+      }
+      WHEN("A timer reschedules itself every 100 ticks.") {
+         recording_timer t;
+         t.wheel = &wheel;
+         t.repeat = 9;
+         t.period = 100;
+         REQUIRE_FALSE(wheel.schedule(t, 100).has_error());
+         THEN("It goes off 10 times in 1000 ticks, all on time.") {
+            REQUIRE(wheel.advance(999) == 9);
+            REQUIRE(wheel.advance(1000) == 1);
+            REQUIRE(t.fired == 10);
+            REQUIRE(t.on_time);
+            REQUIRE(wheel.size() == 0);
+         }
+      }
+      WHEN("A timer is destroyed while it's scheduled.") {
+         {
+            recording_timer t;
+            REQUIRE_FALSE(wheel.schedule(t, 10).has_error());
+            REQUIRE(wheel.size() == 1);
+         }
+         THEN("The wheel forgets about it.") {
+            REQUIRE(wheel.size() == 0);
+            REQUIRE(wheel.advance(20) == 0);
+         }
+      }
+   }
+   GIVEN("A wheel with 1ms ticks in a reactor.") {
+      auto r{::posixpp::reactor::create().result()};
+      auto wheel{::posixpp::timer_wheel::create(1'000'000).result()};
+      REQUIRE_FALSE(
+           r.add(wheel.get_fd(), wheel, ::posixpp::epollevents::in).has_error()
+      );
+      THEN("Polling with nothing scheduled calls nobody.") {
+         REQUIRE(r.poll(0).result() == 0);
+      }
+      WHEN("Timers are scheduled 2, 5 and 10 ms out, and the reactor runs "
+           "until the last one.")
+      {
+         recording_timer soon, later, last;
+         for (auto *t : {&soon, &later, &last}) {
+            t->wheel = &wheel;
+         }
+         last.stop = &r;
+         REQUIRE_FALSE(wheel.schedule(last, 10).has_error());
+         REQUIRE_FALSE(wheel.schedule(later, 5).has_error());
+         REQUIRE_FALSE(wheel.schedule(soon, 2).has_error());
+         REQUIRE_FALSE(r.run().has_error());
+         THEN("They all went off, in order.") {
+            REQUIRE(soon.fired == 1);
+            REQUIRE(later.fired == 1);
+            REQUIRE(last.fired == 1);
+            REQUIRE(soon.fired_at <= later.fired_at);
+            REQUIRE(later.fired_at <= last.fired_at);
+            REQUIRE(last.fired_at >= 10);
+            REQUIRE(wheel.size() == 0);
+         }
+      }
+      WHEN("A timer is scheduled 100ms out after the wheel sat idle for "
+           "200ms.")
+      {
+         auto const ms_now = []() {
+            auto const ts = ::posixpp::clock_gettime(
+                 ::posixpp::clockid::monotonic
+            ).result();
+            return ts.tv_sec * 1000 + ts.tv_nsec / 1'000'000;
+         };
+         ::std::this_thread::sleep_for(::std::chrono::milliseconds{200});
+         recording_timer t;
+         t.wheel = &wheel;
+         auto const start = ms_now();
+         REQUIRE_FALSE(wheel.schedule(t, 100).has_error());
+         REQUIRE(wheel.now() == 0);
+         REQUIRE(t.deadline() >= 300);
+         t.stop = &r;
+         REQUIRE_FALSE(r.run().has_error());
+         THEN("It's 100ms from when it was scheduled, not from the last "
+              "time the wheel moved.")
+         {
+            REQUIRE(t.fired == 1);
+            // Less a tick, for scheduling partway through one.
+            REQUIRE(ms_now() - start >= 99);
+         }
+      }
+   }
+}
@@ -0,0 +1,165 @@
+// Copyright 2021 by Eric Hopper
+// Can be distributed under the terms of the LGPL v3.
+
+#include <posixpp/transfer.h>
+#include <posixpp/simpleio.h>
+#include "tempdir.h"
+#include <catch2/catch.hpp>
+#include <cerrno>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace {
+
+::std::string read_all(::posixpp::fd const &file)
+{
+   ::std::string result;
+   char buf[4096];
+   for (::std::size_t n;
+        (n = ::posixpp::read(file, buf, sizeof(buf)).result()) > 0; )
+   {
+      result.append(buf, n);
+   }
+   return result;
+}
+
+} // namespace
+
+SCENARIO("Data can be moved between file descriptors in the kernel.",
+         "[transfer]")
+{
+   GIVEN("A source file with known contents and an empty destination file.") {
+      tempdir testdir;
+      using of = ::posixpp::openflags;
+      using fdf = ::posixpp::fdflags;
+      using ::posixpp::modeflags;
+      auto const srcname = testdir.get_name() / "src";
+      auto const dstname = testdir.get_name() / "dst";
+      ::std::string contents;
+      for (unsigned i = 0; i < 20000; ++i) {
+         contents += ::std::to_string(i);
+         contents += '\n';
+      }
+      {
+         auto src{::posixpp::open(srcname.native().c_str(),
+                                  of::creat | fdf::wronly,
+                                  modeflags::irwall).result()};
+         REQUIRE(::posixpp::write(src, contents.data(), contents.size())
+                 .result() == contents.size());
+      }
+      auto src{::posixpp::open(srcname.native().c_str(), fdf::rdonly).result()};
+      auto dst{::posixpp::open(dstname.native().c_str(),
+                               of::creat | fdf::rdwr,
+                               modeflags::irwall).result()};
+      auto const dst_contents = [&dstname]() {
+         auto again{::posixpp::open(dstname.native().c_str(),
+                                    ::posixpp::fdflags::rdonly).result()};
+         return read_all(again);
+      };
+
+      WHEN("It's copied with transfer, asking for more than there is.") {
+         auto const copied = ::posixpp::transfer(src, dst, contents.size() * 2);
+         THEN("All of it is copied, and no more.") {
+            REQUIRE(copied.result() == contents.size());
+            REQUIRE(dst_contents() == contents);
+         }
+      }
+      WHEN("Part of it is copied with transfer.") {
+         auto const copied = ::posixpp::transfer(src, dst, 1000);
+         THEN("Exactly that much is copied, and the file positions moved.") {
+            REQUIRE(copied.result() == 1000);
+            REQUIRE(dst_contents() == contents.substr(0, 1000));
+            REQUIRE(read_all(src) == contents.substr(1000));
+         }
+      }
+      WHEN("A range is copied with copy_file_range and explicit offsets.") {
+         ::std::int64_t in_off = 10;
+         ::std::int64_t out_off = 0;
+         auto const copied =
+              ::posixpp::copy_file_range(src, &in_off, dst, &out_off, 20);
+         THEN("The offsets move and the file positions don't.") {
+            REQUIRE(copied.result() == 20);
+            REQUIRE(in_off == 30);
+            REQUIRE(out_off == 20);
+            REQUIRE(dst_contents() == contents.substr(10, 20));
+            REQUIRE(read_all(src) == contents);
+         }
+      }
+      WHEN("It's sent to the destination with sendfile from an offset.") {
+         ::std::int64_t off = 5;
+         auto const sent = ::posixpp::sendfile(dst, src, 100, &off);
+         THEN("That part lands in the destination.") {
+            REQUIRE(sent.result() == 100);
+            REQUIRE(off == 105);
+            REQUIRE(dst_contents() == contents.substr(5, 100));
+         }
+      }
+      AND_GIVEN("A pipe.") {
+         auto p{::posixpp::pipe(::posixpp::fdflags::cloexec).result()};
+         REQUIRE(p.read_end.is_valid());
+         REQUIRE(p.write_end.is_valid());
+         WHEN("Part of the file is spliced into it, and out to the destination.") {
+            ::std::int64_t off = 0;
+            REQUIRE(::posixpp::splice(src, &off, p.write_end, nullptr, 4096)
+                    .result() == 4096);
+            REQUIRE(::posixpp::transfer(p.read_end, dst, 4096).result()
+                    == 4096);
+            THEN("The destination gets exactly that part.") {
+               REQUIRE(dst_contents() == contents.substr(0, 4096));
+            }
+         }
+         WHEN("The file is copied into it with transfer.") {
+            REQUIRE(::posixpp::transfer(src, p.write_end, 100).result() == 100);
+            THEN("It can be read from the other end.") {
+               char buf[100];
+               REQUIRE(::posixpp::read(p.read_end, buf, 100).result() == 100);
+               REQUIRE(::std::string_view(buf, 100) == contents.substr(0, 100));
+            }
+         }
+         WHEN("Memory is put into it with vmsplice, then duplicated with tee.") {
+            ::posixpp::const_iovec const iov[] = {{"abc", 3}, {"def", 3}};
+            REQUIRE(::posixpp::vmsplice(p.write_end, iov).result() == 6);
+            auto p2{::posixpp::pipe().result()};
+            REQUIRE(::posixpp::tee(p.read_end, p2.write_end, 6).result() == 6);
+            THEN("Both pipes have the data.") {
+               char buf1[6], buf2[6];
+               REQUIRE(::posixpp::read(p.read_end, buf1, 6).result() == 6);
+               REQUIRE(::posixpp::read(p2.read_end, buf2, 6).result() == 6);
+               REQUIRE(::std::string_view(buf1, 6) == "abcdef");
+               REQUIRE(::std::string_view(buf2, 6) == "abcdef");
+            }
+         }
+      }
+   }
+   GIVEN("A file in /proc, which says it's empty, and an empty file.") {
+      tempdir testdir;
+      using of = ::posixpp::openflags;
+      using fdf = ::posixpp::fdflags;
+      auto const dstname = testdir.get_name() / "dst";
+      auto src{::posixpp::open("/proc/self/status", fdf::rdonly).result()};
+      auto dst{::posixpp::open(dstname.native().c_str(),
+                               of::creat | fdf::rdwr,
+                               ::posixpp::modeflags::irwall).result()};
+      WHEN("It's copied with transfer.") {
+         auto const copied = ::posixpp::transfer(src, dst, 1 << 20);
+         THEN("Something was copied, starting where the file does.") {
+            REQUIRE(copied.result() > 0);
+            auto again{::posixpp::open(dstname.native().c_str(),
+                                       fdf::rdonly).result()};
+            auto const got = read_all(again);
+            REQUIRE(got.size() == copied.result());
+            REQUIRE(got.substr(0, 5) == "Name:");
+         }
+      }
+   }
+   GIVEN("A file descriptor that isn't open.") {
+      ::posixpp::fd const bad{};
+      auto p{::posixpp::pipe().result()};
+      THEN("transfer reports the error.") {
+         auto const copied = ::posixpp::transfer(bad, p.write_end, 10);
+         REQUIRE(copied.has_error());
+         REQUIRE(copied.error() == EBADF);
+      }
+   }
+}